@@ -0,0 +1,541 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "markdown.h"
+#include "template.h"
+#include "arena.h"
+#include "utils.h"
+
+// Markdown throughput and conformance benchmark
+//
+// Converts a set of generated documents, ordinary and pathological, reporting
+// throughput and allocations per MB of input, then runs the conformance
+// examples of a spec file and reports how many of them match.
+
+// Default time spent converting each document
+#define BENCH_MIN_TIME_MS 200
+
+// Build type the benchmark was compiled with, set by the build
+#ifndef XO_BENCH_BUILD_TYPE
+#define XO_BENCH_BUILD_TYPE ""
+#endif
+
+// Allocations made since the counter was last read. The build wraps the
+// allocator at link time where the linker supports it, elsewhere allocations
+// are not counted.
+static size_t allocation_count = 0;
+
+#ifdef XO_BENCH_COUNT_ALLOCS
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t count, size_t size);
+void *__real_realloc(void *ptr, size_t size);
+
+void *__wrap_malloc(size_t size) {
+    allocation_count++;
+    return __real_malloc(size);
+}
+
+void *__wrap_calloc(size_t count, size_t size) {
+    allocation_count++;
+    return __real_calloc(count, size);
+}
+
+void *__wrap_realloc(void *ptr, size_t size) {
+    allocation_count++;
+    return __real_realloc(ptr, size);
+}
+#endif
+
+// Growable buffer holding a generated document
+typedef struct {
+    char *data;
+    size_t length;
+    size_t capacity;
+} bench_buffer_t;
+
+static void buffer_append(bench_buffer_t *buffer, const char *data, size_t length) {
+    if (buffer->length + length + 1 > buffer->capacity) {
+        size_t new_capacity = buffer->capacity == 0 ? 4096 : buffer->capacity;
+        while (buffer->length + length + 1 > new_capacity) {
+            new_capacity *= 2;
+        }
+    
+        char *new_data = realloc(buffer->data, new_capacity);
+        if (!new_data) {
+            fprintf(stderr, "Out of memory generating the corpus\n");
+            exit(1);
+        }
+    
+        buffer->data = new_data;
+        buffer->capacity = new_capacity;
+    }
+    
+    memcpy(buffer->data + buffer->length, data, length);
+    buffer->length += length;
+    buffer->data[buffer->length] = '\0';
+}
+
+static void buffer_append_str(bench_buffer_t *buffer, const char *str) {
+    buffer_append(buffer, str, strlen(str));
+}
+
+static void buffer_repeat(bench_buffer_t *buffer, const char *str, size_t count) {
+    size_t length = strlen(str);
+    for (size_t i = 0; i < count; i++) {
+        buffer_append(buffer, str, length);
+    }
+}
+
+// Deterministic generator so every run converts the same documents
+static uint64_t random_state = 0x9E3779B97F4A7C15ull;
+
+static uint32_t random_next(void) {
+    random_state ^= random_state << 13;
+    random_state ^= random_state >> 7;
+    random_state ^= random_state << 17;
+    return (uint32_t)(random_state >> 32);
+}
+
+static const char *pick(const char *const *items, size_t count) {
+    return items[random_next() % count];
+}
+
+#define COUNT_OF(items) (sizeof(items) / sizeof((items)[0]))
+
+// A line of prose with the inline markup pages commonly use
+static void generate_inline_line(bench_buffer_t *buffer) {
+    static const char *const words[] = {
+        "the", "static", "site", "generator", "renders", "every", "page", "from", "markdown",
+        "into", "its", "layout", "while", "partials", "are", "shared", "between", "pages", "and",
+        "builds", "skip", "files", "whose", "content", "did", "not", "change"
+    };
+    static const char *const markup[] = {
+        "*emphasis*", "**strong text**", "`inline code`", "[a link](/docs/page.html)",
+        "[titled link](https://example.com \"Example\")", "![an image](/img/photo.png)",
+        "_underscored_", "***both***", "\\*escaped\\*", "<kbd>Ctrl</kbd>", "&amp;"
+    };
+    
+    size_t words_in_line = 8 + random_next() % 16;
+    for (size_t i = 0; i < words_in_line; i++) {
+        if (i > 0) {
+            buffer_append_str(buffer, " ");
+        }
+        buffer_append_str(buffer, random_next() % 6 == 0 ? pick(markup, COUNT_OF(markup)) : pick(words, COUNT_OF(words)));
+    }
+    buffer_append_str(buffer, "\n");
+}
+
+// Large document mixing every block type the converter knows
+static void generate_document(bench_buffer_t *buffer, size_t target) {
+    while (buffer->length < target) {
+        unsigned kind = random_next() % 10;
+    
+        if (kind == 0) {
+            static const char *const headers[] = { "# ", "## ", "### ", "#### " };
+            buffer_append_str(buffer, pick(headers, COUNT_OF(headers)));
+            generate_inline_line(buffer);
+        } else if (kind <= 2) {
+            size_t items = 2 + random_next() % 6;
+            for (size_t i = 0; i < items; i++) {
+                buffer_append_str(buffer, i % 2 ? "* " : "- ");
+                generate_inline_line(buffer);
+            }
+        } else if (kind == 3) {
+            buffer_append_str(buffer, "```c\n");
+            size_t lines = 3 + random_next() % 12;
+            for (size_t i = 0; i < lines; i++) {
+                buffer_append_str(buffer, "    if (ptr[i] < limit && *ptr != '\\0') { count++; }\n");
+            }
+            buffer_append_str(buffer, "```\n");
+        } else {
+            size_t lines = 1 + random_next() % 4;
+            for (size_t i = 0; i < lines; i++) {
+                generate_inline_line(buffer);
+            }
+        }
+    
+        buffer_append_str(buffer, "\n");
+    }
+}
+
+// Documents converted by the benchmark
+typedef struct {
+    const char *name;
+    bench_buffer_t text;
+} bench_case_t;
+
+#define BENCH_MAX_CASES 16
+
+static bench_case_t cases[BENCH_MAX_CASES];
+static size_t case_count = 0;
+
+static bench_buffer_t *add_case(const char *name) {
+    bench_case_t *bench_case = &cases[case_count++];
+    bench_case->name = name;
+    memset(&bench_case->text, 0, sizeof(bench_case->text));
+    return &bench_case->text;
+}
+
+static void generate_cases(void) {
+    bench_buffer_t *text;
+    
+    // Ordinary pages
+    generate_document(add_case("generated document"), 8 * 1024 * 1024);
+    
+    text = add_case("short lines");
+    buffer_repeat(text, "a\n", 2 * 1024 * 1024);
+    
+    // Single lines much longer than any page has
+    text = add_case("very long line");
+    while (text->length < 8 * 1024 * 1024) {
+        generate_inline_line(text);
+        text->length--;  // Join the lines into one
+        buffer_append_str(text, " ");
+    }
+    buffer_append_str(text, "\n");
+    
+    text = add_case("huge code fence");
+    buffer_append_str(text, "```\n");
+    buffer_repeat(text, "for (int i = 0; i < n; i++) { *out++ = in[i] * 2; } // [x](y) `z`\n", 128 * 1024);
+    buffer_append_str(text, "```\n");
+    
+    text = add_case("large table");
+    buffer_append_str(text, "| id | name | value | note |\n|---:|:---|:---:|---|\n");
+    for (size_t i = 0; i < 64 * 1024; i++) {
+        char row[96];
+        snprintf(row, sizeof(row), "| %zu | item *%zu* | %zu.5 | `code` \\| [link](/%zu) |\n", i, i, i * 3, i);
+        buffer_append_str(text, row);
+    }
+    
+    // Inputs that make naive inline parsers quadratic or recurse deeply
+    text = add_case("nested emphasis");
+    buffer_repeat(text, "*a ", 64 * 1024);
+    buffer_append_str(text, "b");
+    buffer_repeat(text, " a*", 64 * 1024);
+    buffer_append_str(text, "\n");
+    
+    text = add_case("unmatched delimiters");
+    buffer_repeat(text, "*a _b ", 128 * 1024);
+    buffer_append_str(text, "\n");
+    
+    text = add_case("nested brackets");
+    buffer_repeat(text, "[", 128 * 1024);
+    buffer_append_str(text, "a");
+    buffer_repeat(text, "](b)", 128 * 1024);
+    buffer_append_str(text, "\n");
+    
+    text = add_case("unclosed brackets");
+    buffer_repeat(text, "[a ![b ", 128 * 1024);
+    buffer_append_str(text, "\n");
+    
+    text = add_case("links after images");
+    buffer_repeat(text, "![[a](b) ", 80 * 1024);
+    buffer_append_str(text, "\n");
+    
+    text = add_case("nested parentheses");
+    buffer_append_str(text, "[a](");
+    buffer_repeat(text, "(", 256 * 1024);
+    buffer_repeat(text, ")", 256 * 1024);
+    buffer_append_str(text, ")\n");
+    
+    text = add_case("unclosed link titles");
+    buffer_repeat(text, "[a](b \"c ", 64 * 1024);
+    buffer_append_str(text, "\n");
+    
+    text = add_case("backtick runs");
+    for (size_t run = 1; run <= 2048; run++) {
+        for (size_t i = 0; i < run; i++) {
+            buffer_append_str(text, "`");
+        }
+        buffer_append_str(text, "a");
+    }
+    buffer_append_str(text, "\n");
+}
+
+// Convert a document once, returning false on failure
+static bool convert(const bench_buffer_t *text) {
+    xo_markdown_t md;
+    xo_markdown_init(&md);
+    md.content.data = text->data;
+    md.content.length = text->length;
+    
+    char *html;
+    if (xo_markdown_to_html(&md, &html) != XO_SUCCESS) {
+        return false;
+    }
+    
+    free(html);
+    return true;
+}
+
+static void run_throughput(uint64_t min_time_ns) {
+    printf("%-24s %10s %10s %12s\n", "document", "size", "MB/s", "allocs/MB");
+    
+    for (size_t i = 0; i < case_count; i++) {
+        const bench_buffer_t *text = &cases[i].text;
+        double megabytes = (double)text->length / (1024.0 * 1024.0);
+    
+        // One counted run, then as many timed runs as fit in the time budget
+        allocation_count = 0;
+        if (!convert(text)) {
+            printf("%-24s %9.2fM %10s\n", cases[i].name, megabytes, "failed");
+            continue;
+        }
+        size_t allocations = allocation_count;
+    
+        size_t runs = 0;
+        uint64_t start = xo_utils_time_ns();
+        uint64_t elapsed;
+        do {
+            convert(text);
+            runs++;
+            elapsed = xo_utils_time_ns() - start;
+        } while (elapsed < min_time_ns);
+    
+        double seconds = (double)elapsed / 1e9;
+        printf("%-24s %9.2fM %10.1f", cases[i].name, megabytes, megabytes * (double)runs / seconds);
+#ifdef XO_BENCH_COUNT_ALLOCS
+        printf(" %12.1f\n", (double)allocations / megabytes);
+#else
+        (void)allocations;
+        printf(" %12s\n", "n/a");
+#endif
+    }
+}
+
+// Compare HTML ignoring the formatting differences renderers are free to
+// choose: whitespace between tags, trailing whitespace and " />" endings
+static char *normalize_html(const char *html) {
+    size_t length = strlen(html);
+    char *out = malloc(length + 1);
+    if (!out) {
+        return NULL;
+    }
+    
+    size_t n = 0;
+    for (size_t i = 0; i < length; i++) {
+        char c = html[i];
+    
+        // Drop whitespace between a tag's end and the next tag
+        if ((c == ' ' || c == '\n') && n > 0 && out[n - 1] == '>') {
+            size_t j = i;
+            while (j < length && (html[j] == ' ' || html[j] == '\n')) {
+                j++;
+            }
+            if (j == length || html[j] == '<') {
+                i = j - 1;
+                continue;
+            }
+        }
+    
+        // " />" and ">" end a void tag alike
+        if (c == ' ' && html[i + 1] == '/' && html[i + 2] == '>') {
+            i++;
+            continue;
+        }
+    
+        out[n++] = c;
+    }
+    
+    while (n > 0 && (out[n - 1] == ' ' || out[n - 1] == '\n')) {
+        n--;
+    }
+    out[n] = '\0';
+    
+    return out;
+}
+
+// Render the body of a template example with a pages list of two pages,
+// as a page listing the site's pages would be
+static char *render_template_example(const char *body) {
+    xo_arena_t arena;
+    if (xo_arena_init(&arena, 0) != XO_SUCCESS) {
+        return NULL;
+    }
+    
+    static const char *const pages[][2] = { { "One", "/one/" }, { "Two", "/two/" } };
+    xo_template_context_t maps[2];
+    xo_template_list_t list;
+    xo_template_context_t ctx;
+    xo_template_list_init(&list, &arena);
+    for (size_t i = 0; i < 2; i++) {
+        xo_template_context_init_arena(&maps[i], &arena);
+        xo_template_context_add_string(&maps[i], "title", pages[i][0]);
+        xo_template_context_add_string(&maps[i], "url", pages[i][1]);
+        xo_template_list_add_map(&list, &maps[i]);
+    }
+    xo_template_context_init_arena(&ctx, &arena);
+    xo_template_context_add_list(&ctx, "pages", &list);
+    
+    char *rendered = NULL;
+    char *result = NULL;
+    if (xo_template_render(body, &ctx, NULL, &rendered) == XO_SUCCESS) {
+        result = xo_utils_strdup(rendered);
+    }
+    
+    xo_arena_free(&arena);
+    
+    return result;
+}
+
+// Check one example, printing it when it fails and verbose is set. The
+// markdown of a template example is rendered as a template first.
+static bool run_example(const char *markdown, const char *expected, size_t number, const char *section,
+                        bool templated, bool verbose) {
+    char *body = templated ? render_template_example(markdown) : NULL;
+    if (templated && !body) {
+        if (verbose) {
+            printf("\nExample %zu (%s) failed\n--- template\n%s(rendering failed)\n", number, section, markdown);
+        }
+        return false;
+    }
+    
+    bench_buffer_t text = { 0 };
+    buffer_append_str(&text, body ? body : markdown);
+    free(body);
+    
+    xo_markdown_t md;
+    xo_markdown_init(&md);
+    md.content.data = text.data ? text.data : "";
+    md.content.length = text.length;
+    
+    char *html = NULL;
+    bool passed = false;
+    if (xo_markdown_to_html(&md, &html) == XO_SUCCESS) {
+        char *got = normalize_html(html);
+        char *want = normalize_html(expected);
+        passed = got && want && strcmp(got, want) == 0;
+        free(got);
+        free(want);
+    }
+    
+    if (!passed && verbose) {
+        printf("\nExample %zu (%s) failed\n--- markdown\n%s--- expected\n%s--- got\n%s", number, section, markdown,
+               expected, html ? html : "(conversion failed)\n");
+    }
+    
+    free(html);
+    free(text.data);
+    
+    return passed;
+}
+
+// Run the examples of a spec file, in the format of the CommonMark spec
+static int run_conformance(const char *spec_path, bool verbose) {
+    char *spec = xo_utils_read_file(spec_path);
+    if (!spec) {
+        fprintf(stderr, "Cannot read spec file: %s\n", spec_path);
+        return 1;
+    }
+    
+    static const char fence[] = "```````````````````````````````` example";
+    static const char fence_end[] = "````````````````````````````````";
+    
+    bench_buffer_t markdown = { 0 };
+    bench_buffer_t expected = { 0 };
+    char section[128] = "";
+    size_t total = 0;
+    size_t passed = 0;
+    size_t section_total = 0;
+    size_t section_passed = 0;
+    int state = 0;  // 0 outside an example, 1 in its markdown, 2 in its HTML
+    
+    printf("\n%-36s %8s\n", "conformance", "passed");
+    
+    char *line = spec;
+    while (line && *line) {
+        char *newline = strchr(line, '\n');
+        size_t length = newline ? (size_t)(newline - line) : strlen(line);
+    
+        if (state == 0 && strncmp(line, "## ", 3) == 0) {
+            if (section_total > 0) {
+                printf("%-36s %4zu/%-4zu\n", section, section_passed, section_total);
+            }
+            snprintf(section, sizeof(section), "%.*s", (int)(length - 3), line + 3);
+            section_total = 0;
+            section_passed = 0;
+        } else if (state == 0 && length == sizeof(fence) - 1 && strncmp(line, fence, length) == 0) {
+            markdown.length = 0;
+            expected.length = 0;
+            buffer_append(&markdown, "", 0);
+            buffer_append(&expected, "", 0);
+            state = 1;
+        } else if (state == 1 && length == 1 && line[0] == '.') {
+            state = 2;
+        } else if (state == 2 && length == sizeof(fence_end) - 1 && strncmp(line, fence_end, length) == 0) {
+            total++;
+            section_total++;
+            bool templated = strncmp(section, "Template", 8) == 0;
+            if (run_example(markdown.data, expected.data, total, section, templated, verbose)) {
+                passed++;
+                section_passed++;
+            }
+            state = 0;
+        } else if (state != 0) {
+            // The spec shows tabs as arrows
+            bench_buffer_t *target = state == 1 ? &markdown : &expected;
+            for (size_t i = 0; i < length; i++) {
+                if (i + 2 < length && memcmp(line + i, "\xe2\x86\x92", 3) == 0) {
+                    buffer_append(target, "\t", 1);
+                    i += 2;
+                } else {
+                    buffer_append(target, line + i, 1);
+                }
+            }
+            buffer_append(target, "\n", 1);
+        }
+    
+        line = newline ? newline + 1 : NULL;
+    }
+    
+    if (section_total > 0) {
+        printf("%-36s %4zu/%-4zu\n", section, section_passed, section_total);
+    }
+    printf("%-36s %4zu/%-4zu %.1f%%\n", "total", passed, total, total ? 100.0 * (double)passed / (double)total : 0.0);
+    
+    free(markdown.data);
+    free(expected.data);
+    free(spec);
+    
+    return 0;
+}
+
+static void print_usage(void) {
+    printf("Usage: xo-bench [--min-time MS] [--verbose] [SPEC_FILE]\n\n");
+    printf("  --min-time MS  Time spent converting each document (default: %d)\n", BENCH_MIN_TIME_MS);
+    printf("  --verbose      Print the conformance examples that fail\n");
+    printf("  SPEC_FILE      Conformance examples in CommonMark spec format\n");
+}
+
+int main(int argc, char *argv[]) {
+    uint64_t min_time_ms = BENCH_MIN_TIME_MS;
+    bool verbose = false;
+    const char *spec_path = NULL;
+    
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--min-time") == 0 && i + 1 < argc) {
+            min_time_ms = (uint64_t)atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--verbose") == 0) {
+            verbose = true;
+        } else if (strcmp(argv[i], "--help") == 0) {
+            print_usage();
+            return 0;
+        } else {
+            spec_path = argv[i];
+        }
+    }
+    
+    // Throughput only means something for an optimized build
+    const char *build_type = XO_BENCH_BUILD_TYPE[0] != '\0' ? XO_BENCH_BUILD_TYPE : "unspecified";
+    printf("build type: %s\n\n", build_type);
+    
+    generate_cases();
+    run_throughput(min_time_ms * 1000000);
+    
+    for (size_t i = 0; i < case_count; i++) {
+        free(cases[i].text.data);
+    }
+    
+    return spec_path ? run_conformance(spec_path, verbose) : 0;
+}
@@ -0,0 +1,35 @@
+#ifndef XO_ARENA_H
+#define XO_ARENA_H
+
+#include "xo.h"
+
+// Default size of an arena block, larger allocations get a block of their own
+#define XO_ARENA_BLOCK_SIZE (64 * 1024)
+
+// Block of arena memory
+typedef struct xo_arena_block {
+    struct xo_arena_block *next;
+    size_t size;
+    size_t used;
+} xo_arena_block_t;
+
+// Bump allocator. Allocations are released all at once by resetting or
+// freeing the arena, a reset keeps the blocks for reuse.
+typedef struct {
+    xo_arena_block_t *head;
+    xo_arena_block_t *current;   // Block allocations are bumped from
+    size_t block_size;
+    void *last;                  // Most recent allocation, can grow in place
+} xo_arena_t;
+
+// Function declarations
+int xo_arena_init(xo_arena_t *arena, size_t block_size);
+void xo_arena_free(xo_arena_t *arena);
+void xo_arena_reset(xo_arena_t *arena);
+void *xo_arena_alloc(xo_arena_t *arena, size_t size);
+void *xo_arena_realloc(xo_arena_t *arena, void *ptr, size_t old_size, size_t new_size);
+char *xo_arena_strdup(xo_arena_t *arena, const char *str);
+char *xo_arena_strndup(xo_arena_t *arena, const char *str, size_t n);
+size_t xo_arena_used(const xo_arena_t *arena);
+
+#endif /* XO_ARENA_H */
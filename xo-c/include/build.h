@@ -2,11 +2,26 @@
 #define XO_BUILD_H
 
 #include "xo.h"
+#include "template.h"
+#include "markdown.h"
+#include "arena.h"
+#include "utils.h"
+#include <stdint.h>
+
+// Directory inside the content directory holding partials
+#define XO_PARTIALS_DIR "_partials"
+
+// Key of the site's page list in every page's template context
+#define XO_SITE_PAGES_KEY "pages"
+
+// Name of the build cache file inside the cache directory
+#define XO_BUILD_CACHE_FILE "build-cache"
 
 // Build cache entry
 typedef struct {
     char *filepath;
     char *hash;
+    bool used;            // Looked up or updated by the current build
 } xo_build_cache_entry_t;
 
 // Build cache
@@ -14,34 +29,111 @@ typedef struct {
     xo_build_cache_entry_t *entries;
     size_t count;
     size_t capacity;
+    size_t *index;        // Open-addressed slots holding entry index + 1
+    size_t index_capacity;
+    void *lock;           // Platform mutex, cache is shared across build workers
 } xo_build_cache_t;
 
-// Dependency tracking
+// Context shapes a layout keeps bindings for, pages of other shapes bind as they render
+#define XO_LAYOUT_MAX_BINDINGS 16
+
+// Compiled layout held by the layout cache
 typedef struct {
-    char *filepath;
-    char **dependencies;
-    size_t dep_count;
-    size_t dep_capacity;
-} xo_dependency_entry_t;
+    char *path;
+    xo_template_t *tpl;   // Immutable once cached
+    unsigned generation;  // Build in which the source was last checked
+    xo_template_binding_t *bindings[XO_LAYOUT_MAX_BINDINGS];  // Bindings of tpl, one per context shape
+    size_t binding_count;
+} xo_layout_cache_entry_t;
+
+// Layouts compiled once and shared read-only by every page of a build.
+// An entry is revalidated against the file's content hash once per build,
+// so a dev server can keep the cache across rebuilds.
+typedef struct {
+    xo_layout_cache_entry_t *entries;
+    size_t count;
+    size_t capacity;
+    xo_template_t **retired;  // Replaced templates, freed when the next build begins as pages may still use them
+    size_t retired_count;
+    size_t retired_capacity;
+    xo_template_binding_t **retired_bindings;  // Bindings of replaced templates or reloaded partials, freed alike
+    size_t retired_binding_count;
+    size_t retired_binding_capacity;
+    unsigned generation;
+    void *lock;           // Platform mutex, cache is shared across build workers
+} xo_layout_cache_t;
+
+// Block AST of a page kept by the markdown cache
+typedef struct {
+    char *path;
+    xo_arena_t arenas[2];    // The AST lives in one, the next version is built in the other
+    int current;             // Arena owning the AST
+    xo_markdown_ast_t ast;
+    bool busy;               // Being re-rendered by a build worker
+} xo_markdown_cache_entry_t;
 
-// Dependency tracker
+// Block ASTs of the pages a dev server rebuilt, so the next rebuild of a page
+// only converts the blocks an edit changed
 typedef struct {
-    xo_dependency_entry_t *entries;
+    xo_markdown_cache_entry_t **entries;
     size_t count;
     size_t capacity;
+    size_t *index;           // Open-addressed slots holding entry index + 1
+    size_t index_capacity;
+    void *lock;              // Platform mutex, cache is shared across build workers
+} xo_markdown_cache_t;
+
+// Name of the dependency graph file inside the cache directory
+#define XO_DEPENDENCY_FILE "dependencies"
+
+// List of interned path IDs
+typedef struct {
+    uint32_t *ids;
+    size_t count;
+    size_t capacity;
+} xo_dependency_list_t;
+
+// Dependency tracker, a graph over interned paths
+typedef struct {
+    char **paths;                    // Interned paths, indexed by ID
+    xo_dependency_list_t *forward;   // forward[id]: files paths[id] depends on
+    xo_dependency_list_t *reverse;   // reverse[id]: files depending on paths[id]
+    size_t count;
+    size_t capacity;
+    uint32_t *index;                 // Open-addressed slots holding ID + 1
+    size_t index_capacity;
+    void *lock;                      // Platform mutex, tracker is shared across build workers
 } xo_dependency_tracker_t;
 
 // Function declarations
 int xo_build_cache_init(xo_build_cache_t *cache);
 void xo_build_cache_free(xo_build_cache_t *cache);
 int xo_build_cache_add(xo_build_cache_t *cache, const char *filepath, const char *hash);
-const char *xo_build_cache_get(const xo_build_cache_t *cache, const char *filepath);
+bool xo_build_cache_get(const xo_build_cache_t *cache, const char *filepath, char out[XO_HASH_HEX_LEN + 1]);
+void xo_build_cache_touch(xo_build_cache_t *cache, const char *filepath);
 int xo_build_cache_save(const xo_build_cache_t *cache, const char *cache_path);
 int xo_build_cache_load(xo_build_cache_t *cache, const char *cache_path);
 
+int xo_layout_cache_init(xo_layout_cache_t *cache);
+void xo_layout_cache_free(xo_layout_cache_t *cache);
+void xo_layout_cache_begin_build(xo_layout_cache_t *cache);
+const xo_template_t *xo_layout_cache_get(xo_layout_cache_t *cache, const char *layout_path);
+void xo_layout_cache_invalidate(xo_layout_cache_t *cache, const char *layout_path);
+const xo_template_binding_t *xo_layout_cache_bind(xo_layout_cache_t *cache, const xo_template_t *layout,
+                                                  const xo_template_context_t *ctx,
+                                                  const xo_template_partials_t *partials);
+void xo_layout_cache_drop_bindings(xo_layout_cache_t *cache);
+
+int xo_markdown_cache_init(xo_markdown_cache_t *cache);
+void xo_markdown_cache_free(xo_markdown_cache_t *cache);
+int xo_markdown_cache_to_html(xo_markdown_cache_t *cache, const char *filepath, const xo_markdown_t *md,
+                              char **html_output);
+void xo_markdown_cache_remove(xo_markdown_cache_t *cache, const char *filepath);
+
 int xo_dependency_tracker_init(xo_dependency_tracker_t *tracker);
 void xo_dependency_tracker_free(xo_dependency_tracker_t *tracker);
 int xo_dependency_tracker_add(xo_dependency_tracker_t *tracker, const char *filepath, const char *dependency);
+void xo_dependency_tracker_remove(xo_dependency_tracker_t *tracker, const char *filepath);
 char **xo_dependency_tracker_get_reverse(const xo_dependency_tracker_t *tracker, const char *dependency, size_t *count);
 int xo_dependency_tracker_save(const xo_dependency_tracker_t *tracker, const char *filepath);
 int xo_dependency_tracker_load(xo_dependency_tracker_t *tracker, const char *filepath);
@@ -49,6 +141,12 @@ int xo_dependency_tracker_load(xo_dependency_tracker_t *tracker, const char *fil
 int xo_build_file(const xo_config_t *config, const char *filepath, xo_dependency_tracker_t *tracker);
 int xo_build_directory(const xo_config_t *config, const char *dirpath, xo_dependency_tracker_t *tracker);
 int xo_compute_file_hash(const char *filepath, char **hash);
-bool xo_should_rebuild(const xo_build_cache_t *cache, const char *filepath);
+bool xo_should_rebuild(const xo_build_cache_t *cache, const xo_dependency_tracker_t *dependencies,
+                       const char *content_dir, const char *filepath);
+int xo_build_dependents(const xo_config_t *config, const char *dependency);
+int xo_build_save_cache(const xo_config_t *config);
+bool xo_build_frontmatter_changed(const xo_config_t *config, const char *filepath);
+int xo_build_session_open(xo_config_t *config);
+void xo_build_session_close(xo_config_t *config);
 
 #endif /* XO_BUILD_H */ 
\ No newline at end of file
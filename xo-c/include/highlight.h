@@ -0,0 +1,65 @@
+#ifndef XO_HIGHLIGHT_H
+#define XO_HIGHLIGHT_H
+
+#include "xo.h"
+#include "writer.h"
+#include <stdint.h>
+
+// Name of the highlight cache file inside the cache directory
+#define XO_HIGHLIGHT_CACHE_FILE "highlight-cache"
+
+// Lexer description of a language. The lexer is shared, languages differ only
+// in these tables.
+typedef struct {
+    const char *name;                 // Canonical name
+    const char *const *aliases;       // Other fence info names, NULL-terminated
+    const char *const *keywords;      // Sorted
+    size_t keyword_count;
+    const char *const *types;         // Builtin types and constants, sorted
+    size_t type_count;
+    const char *line_comment;         // Starts a comment running to the end of the line, NULL for none
+    const char *block_comment_open;   // NULL for none
+    const char *block_comment_close;
+    const char *quotes;               // Characters opening a string closed by the same character
+    const char *multiline_quotes;     // Quotes whose strings may span lines
+    bool triple_quotes;               // """ and ''' open strings closed the same way
+    char meta;                        // Starts a preprocessor line (#) or decorator (@), 0 for none
+    bool meta_line;                   // The meta token runs to the end of the line
+    bool comment_at_word;             // The line comment only starts at the start of a word
+} xo_highlight_language_t;
+
+// Highlighted snippet held by the highlight cache
+typedef struct {
+    uint64_t key[2];      // Hash of the language and the code, under two seeds
+    const char *html;
+    size_t length;
+    bool owned;           // html was allocated by the cache, not loaded with the file
+    bool used;            // Looked up or added since the cache was loaded
+} xo_highlight_entry_t;
+
+// Highlighted HTML of code snippets keyed by language and code, so unchanged
+// snippets are not tokenized again. Shared by the build workers and saved in
+// the cache directory between builds.
+typedef struct {
+    xo_highlight_entry_t *entries;
+    size_t count;
+    size_t capacity;
+    size_t *index;        // Open-addressed slots holding entry index + 1
+    size_t index_capacity;
+    char *data;           // Loaded cache file, the HTML of loaded entries points into it
+    bool dirty;           // Entries were added since the cache was loaded
+    void *lock;           // Platform mutex, cache is shared across build workers
+} xo_highlight_cache_t;
+
+// Function declarations
+const xo_highlight_language_t *xo_highlight_find_language(const char *name, size_t length);
+int xo_highlight_tokenize(const xo_highlight_language_t *language, const char *code, size_t length, xo_writer_t *out);
+int xo_highlight_to_html(xo_highlight_cache_t *cache, const char *language, size_t language_len, const char *code,
+                         size_t length, xo_writer_t *out);
+
+int xo_highlight_cache_init(xo_highlight_cache_t *cache);
+void xo_highlight_cache_free(xo_highlight_cache_t *cache);
+int xo_highlight_cache_load(xo_highlight_cache_t *cache, const char *cache_path);
+int xo_highlight_cache_save(xo_highlight_cache_t *cache, const char *cache_path, bool prune);
+
+#endif /* XO_HIGHLIGHT_H */
@@ -2,11 +2,15 @@
 #define XO_MARKDOWN_H
 
 #include "xo.h"
+#include "arena.h"
+#include "writer.h"
+#include "highlight.h"
+#include <stdint.h>
 
-// Frontmatter key-value pair
+// Frontmatter key-value pair, both spans into the document source
 typedef struct {
-    char *key;
-    char *value;
+    xo_span_t key;
+    xo_span_t value;
 } xo_frontmatter_item_t;
 
 // Frontmatter structure
@@ -16,17 +20,82 @@ typedef struct {
     size_t capacity;
 } xo_frontmatter_t;
 
-// Markdown document structure
+// Sources at least this large are mapped read-only instead of read into memory,
+// except by xo_markdown_parse_file_unmapped
+#define XO_MARKDOWN_MAP_THRESHOLD (1024 * 1024)
+
+// Markdown document structure. Frontmatter and content point into the source,
+// which stays alive as long as the document does. Only mapped sources lack a
+// NUL terminator, everything reading them goes by the span lengths.
 typedef struct {
     xo_frontmatter_t frontmatter;
-    char *content;
+    xo_span_t content;    // Body, NUL-terminated at content.data + content.length unless mapped
+    const char *source;   // Whole file, never modified
+    size_t source_length;
+    bool mapped;          // Source is a read-only file mapping, unmapped by xo_markdown_free
+    xo_arena_t *arena;    // Owns the document's memory when set
+    xo_highlight_cache_t *highlights;  // Highlighted code blocks, NULL to highlight without caching
 } xo_markdown_t;
 
+// Kinds of block in a markdown document
+typedef enum {
+    XO_MD_BLOCK_BLANK,
+    XO_MD_BLOCK_HEADER,
+    XO_MD_BLOCK_LIST_ITEM,
+    XO_MD_BLOCK_CODE,
+    XO_MD_BLOCK_TABLE,
+    XO_MD_BLOCK_PARAGRAPH
+} xo_markdown_block_type_t;
+
+// Block of a document, a single line except for fenced code and tables
+typedef struct {
+    xo_markdown_block_type_t type;
+    int level;            // Header level
+    xo_span_t source;     // Lines of the block, valid as long as the parsed content
+    xo_span_t text;       // Inline text, the code of a code block or the rows of a table
+    xo_span_t info;       // Info string after the opening fence of a code block
+    uint64_t hash;        // Hash of type and source, blocks with equal hashes render the same
+    size_t html_offset;   // Rendered block in the AST's html buffer
+    size_t html_length;
+} xo_markdown_block_t;
+
+// Block-level AST of a document and the HTML of each block. List markup
+// depends on neighbouring blocks and is only added when writing the page.
+typedef struct {
+    xo_markdown_block_t *blocks;
+    size_t count;
+    size_t capacity;
+    char *html;           // HTML of every block back to back
+    size_t html_length;
+    xo_arena_t *arena;    // Owns the AST's memory
+    xo_highlight_cache_t *highlights;  // Highlighted code blocks, NULL to highlight without caching
+} xo_markdown_ast_t;
+
+// Scratch memory of the inline parser, reused across the lines of a document
+typedef struct {
+    void *items;
+    size_t item_capacity;
+    void *tags;
+    size_t tag_capacity;
+    void *runs;
+    size_t run_capacity;
+} xo_markdown_inline_t;
+
 // Function declarations
 int xo_markdown_init(xo_markdown_t *md);
 void xo_markdown_free(xo_markdown_t *md);
 int xo_markdown_parse_file(const char *filepath, xo_markdown_t *md);
+int xo_markdown_parse_file_arena(const char *filepath, xo_arena_t *arena, xo_markdown_t *md);
+int xo_markdown_parse_file_unmapped(const char *filepath, xo_arena_t *arena, xo_markdown_t *md);
+int xo_markdown_parse_frontmatter_file(const char *filepath, xo_arena_t *arena, xo_markdown_t *md);
 int xo_markdown_to_html(const xo_markdown_t *md, char **html_output);
-const char *xo_markdown_get_frontmatter(const xo_markdown_t *md, const char *key);
+const xo_span_t *xo_markdown_get_frontmatter(const xo_markdown_t *md, const char *key);
+int xo_markdown_ast_init(xo_markdown_ast_t *ast, xo_arena_t *arena);
+int xo_markdown_ast_parse(xo_markdown_ast_t *ast, const char *content, size_t length);
+int xo_markdown_ast_render(xo_markdown_ast_t *ast, const xo_markdown_ast_t *previous, size_t *rendered);
+int xo_markdown_ast_to_html(const xo_markdown_ast_t *ast, xo_arena_t *arena, char **html_output);
+void xo_markdown_inline_init(xo_markdown_inline_t *state);
+void xo_markdown_inline_free(xo_markdown_inline_t *state);
+int xo_markdown_inline_to_html(xo_markdown_inline_t *state, const char *text, size_t length, xo_writer_t *out);
 
 #endif /* XO_MARKDOWN_H */ 
\ No newline at end of file
@@ -0,0 +1,26 @@
+#ifndef XO_MUTEX_H
+#define XO_MUTEX_H
+
+// Platform mutex used by the caches and reports shared across build workers
+
+#ifdef _WIN32
+    #include <windows.h>
+    
+    // Windows mutexes
+    typedef CRITICAL_SECTION mutex_t;
+    #define mutex_init(m) InitializeCriticalSection(m)
+    #define mutex_destroy(m) DeleteCriticalSection(m)
+    #define mutex_lock(m) EnterCriticalSection(m)
+    #define mutex_unlock(m) LeaveCriticalSection(m)
+#else
+    #include <pthread.h>
+    
+    // POSIX mutexes
+    typedef pthread_mutex_t mutex_t;
+    #define mutex_init(m) pthread_mutex_init((m), NULL)
+    #define mutex_destroy(m) pthread_mutex_destroy(m)
+    #define mutex_lock(m) pthread_mutex_lock(m)
+    #define mutex_unlock(m) pthread_mutex_unlock(m)
+#endif
+
+#endif /* XO_MUTEX_H */
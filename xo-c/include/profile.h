@@ -0,0 +1,46 @@
+#ifndef XO_PROFILE_H
+#define XO_PROFILE_H
+
+#include "xo.h"
+#include <stdint.h>
+
+// Number of slowest pages printed by default
+#define XO_PROFILE_TOP_PAGES 10
+
+// Timed stages of building a page
+typedef enum {
+    XO_PROFILE_PARSE,
+    XO_PROFILE_TO_HTML,
+    XO_PROFILE_RENDER,
+    XO_PROFILE_MKDIR,
+    XO_PROFILE_WRITE,
+    XO_PROFILE_STAGE_COUNT
+} xo_profile_stage_t;
+
+// Timings of one built page
+typedef struct {
+    char *filepath;
+    uint64_t stage_ns[XO_PROFILE_STAGE_COUNT];
+    uint64_t total_ns;
+} xo_profile_page_t;
+
+// Timings collected over a build
+typedef struct {
+    xo_profile_page_t *pages;
+    size_t count;
+    size_t capacity;
+    uint64_t start_ns;
+    uint64_t wall_ns;     // Build duration, set by xo_profile_finish
+    void *lock;           // Platform mutex, pages are added by build workers
+} xo_profile_t;
+
+// Function declarations
+int xo_profile_init(xo_profile_t *profile);
+void xo_profile_free(xo_profile_t *profile);
+int xo_profile_add_page(xo_profile_t *profile, const char *filepath, const uint64_t stage_ns[XO_PROFILE_STAGE_COUNT]);
+void xo_profile_finish(xo_profile_t *profile);
+void xo_profile_print(xo_profile_t *profile, size_t top_pages);
+int xo_profile_write_json(xo_profile_t *profile, const char *filepath);
+const char *xo_profile_stage_name(xo_profile_stage_t stage);
+
+#endif /* XO_PROFILE_H */
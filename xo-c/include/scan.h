@@ -0,0 +1,17 @@
+#ifndef XO_SCAN_H
+#define XO_SCAN_H
+
+#include "xo.h"
+
+// Byte scanners used by the markdown parser and HTML escaping. They look at 16 bytes at a time
+// with SSE2, or 32 with AVX2 when the CPU supports it, and fall back to a
+// byte loop elsewhere. Each returns end when nothing is found.
+
+// Function declarations
+const char *xo_scan_byte(const char *p, const char *end, char c);
+const char *xo_scan_special(const char *p, const char *end);
+const char *xo_scan_html(const char *p, const char *end);
+bool xo_scan_is_special(unsigned char c);
+const char *xo_scan_impl(void);
+
+#endif /* XO_SCAN_H */
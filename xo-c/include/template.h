@@ -3,56 +3,182 @@
 
 #include "xo.h"
 #include "markdown.h"
+#include <stdint.h>
 
 // Template context value types
 typedef enum {
     XO_TPLVAL_STRING,
     XO_TPLVAL_INT,
-    XO_TPLVAL_BOOL
+    XO_TPLVAL_BOOL,
+    XO_TPLVAL_LIST,
+    XO_TPLVAL_MAP
 } xo_template_value_type_t;
 
-// Template context value
+struct xo_template_list;
+struct xo_template_context;
+
+// Template context value. Lists and maps are held by reference, so one
+// collection can be shared by many contexts without being copied.
 typedef struct {
     xo_template_value_type_t type;
     union {
         char *string_val;
         int int_val;
         bool bool_val;
+        const struct xo_template_list *list_val;
+        const struct xo_template_context *map_val;
     } value;
 } xo_template_value_t;
 
-// Template context
+// List of values in one contiguous array allocated from an arena. Sections
+// render once for each item, with the item's keys in scope when it is a map.
+typedef struct xo_template_list {
+    xo_template_value_t *items;
+    size_t count;
+    size_t capacity;
+    xo_arena_t *arena;    // Owns the items and their strings
+} xo_template_list_t;
+
+// Context key, hashed once when it is added
 typedef struct {
-    char **keys;
+    char *name;
+    size_t length;
+    uint64_t hash;
+} xo_template_key_t;
+
+// Template context. Each key is stored once and found through a hash index.
+// A context added to another context or a list as a value is a map.
+typedef struct xo_template_context {
+    xo_template_key_t *keys;
     xo_template_value_t *values;
     size_t count;
     size_t capacity;
+    size_t *index;        // Open-addressed slots holding entry index + 1
+    size_t index_capacity;
+    uint64_t shape;       // Hash of the key sequence, contexts of one shape bind alike
+    xo_arena_t *arena;    // Owns the context's memory and render output when set
 } xo_template_context_t;
 
-// Template partials
+// Template op types
+typedef enum {
+    XO_TPLOP_LITERAL,     // Text copied as is
+    XO_TPLOP_VAR,         // {{name}}, HTML-escaped
+    XO_TPLOP_UNESCAPED,   // {{{name}}} or {{& name}}
+    XO_TPLOP_PARTIAL,     // {{> name}}
+    XO_TPLOP_SECTION,     // {{#name}}, the ops up to its end render when name is set, once per item of a list
+    XO_TPLOP_INVERTED,    // {{^name}}, the ops up to its end render when name is not set
+    XO_TPLOP_END          // {{/name}}
+} xo_template_op_type_t;
+
+// Template op, the literal text or tag name is a span of the template source
+typedef struct {
+    xo_template_op_type_t type;
+    size_t offset;
+    size_t length;
+    size_t var;           // Variable of a var or section op in the template's vars, partial of a partial op
+    size_t jump;          // Op after the matching end of a section, the section of an end
+} xo_template_op_t;
+
+// Distinct variable used by a template, hashed when compiling
+typedef struct {
+    size_t offset;        // Name in the template source
+    size_t length;
+    uint64_t hash;
+} xo_template_var_t;
+
+// Template loaded once and rendered many times. Compiling splits the source
+// into a flat op array, rendering walks the ops without looking at the source
+// again. Immutable after compiling, so one template can be rendered by
+// several threads at once.
+typedef struct {
+    char *source;
+    size_t length;
+    uint64_t hash;        // Content hash of the source
+    xo_template_op_t *ops;
+    size_t op_count;
+    xo_template_var_t *vars;
+    size_t var_count;
+    xo_template_var_t *partials;  // Distinct partials the template includes
+    size_t partial_count;
+} xo_template_t;
+
+// Variables of a template and the partials it includes resolved against a
+// context. Slots stay valid for every context of the same shape, so rendering
+// looks a variable up by index.
+typedef struct {
+    size_t *slots;        // Context entry + 1 of each template variable, 0 when missing
+    size_t count;
+    const xo_template_t **partials;  // Partials bound with the template
+    size_t **partial_slots;          // Slots of each of them
+    size_t partial_count;
+    uint64_t shape;       // Shape of the contexts the slots are valid for
+} xo_template_binding_t;
+
+// Template partials, a registry loaded once and shared by every page of a build
 typedef struct {
     char **names;
-    char **contents;
+    xo_template_t **templates;  // Compiled partials, their source is the partial's content
+    char **paths;         // Source file of each partial, NULL when added directly
     size_t count;
     size_t capacity;
+    size_t *index;        // Open-addressed slots holding partial index + 1
+    size_t index_capacity;
+    xo_template_t **retired;  // Partials replaced by a reload or removed, freed with the registry
+    size_t retired_count;
+    size_t retired_capacity;
 } xo_template_partials_t;
 
+// Nesting limit for partials including partials
+#define XO_TEMPLATE_MAX_PARTIAL_DEPTH 16
+
+// Nesting limit for sections within one template
+#define XO_TEMPLATE_MAX_SECTION_DEPTH 16
+
 // Function declarations
 int xo_template_context_init(xo_template_context_t *ctx);
+int xo_template_context_init_arena(xo_template_context_t *ctx, xo_arena_t *arena);
 void xo_template_context_free(xo_template_context_t *ctx);
 int xo_template_context_add_string(xo_template_context_t *ctx, const char *key, const char *value);
+int xo_template_context_add_string_n(xo_template_context_t *ctx, const char *key, size_t key_len,
+                                     const char *value, size_t value_len);
 int xo_template_context_add_int(xo_template_context_t *ctx, const char *key, int value);
 int xo_template_context_add_bool(xo_template_context_t *ctx, const char *key, bool value);
+int xo_template_context_add_list(xo_template_context_t *ctx, const char *key, const xo_template_list_t *list);
+int xo_template_context_add_map(xo_template_context_t *ctx, const char *key, const xo_template_context_t *map);
 int xo_template_context_from_frontmatter(xo_template_context_t *ctx, const xo_frontmatter_t *frontmatter);
 
+int xo_template_list_init(xo_template_list_t *list, xo_arena_t *arena);
+int xo_template_list_add_string(xo_template_list_t *list, const char *value);
+int xo_template_list_add_map(xo_template_list_t *list, const xo_template_context_t *map);
+
 int xo_template_partials_init(xo_template_partials_t *partials);
 void xo_template_partials_free(xo_template_partials_t *partials);
 int xo_template_partials_add(xo_template_partials_t *partials, const char *name, const char *content);
 int xo_template_partials_load_dir(xo_template_partials_t *partials, const char *dir_path);
+int xo_template_partials_load_file(xo_template_partials_t *partials, const char *dir_path, const char *filepath);
+int xo_template_partials_remove_file(xo_template_partials_t *partials, const char *dir_path, const char *filepath);
+const char *xo_template_partials_get(const xo_template_partials_t *partials, const char *name, size_t name_len);
+const char *xo_template_partials_get_path(const xo_template_partials_t *partials, const char *name, size_t name_len);
+const xo_template_t *xo_template_partials_get_template(const xo_template_partials_t *partials, const char *name,
+                                                       size_t name_len);
 
 int xo_template_render(const char *template_str, const xo_template_context_t *ctx, 
                       const xo_template_partials_t *partials, char **output);
 int xo_template_render_file(const char *template_path, const xo_template_context_t *ctx, 
                            const xo_template_partials_t *partials, char **output);
 
+int xo_template_compile(const char *source, size_t length, xo_template_t *tpl);
+int xo_template_compile_file(const char *template_path, xo_template_t *tpl);
+void xo_template_free(xo_template_t *tpl);
+bool xo_template_uses_var(const xo_template_t *tpl, const char *name);
+int xo_template_render_compiled(const xo_template_t *tpl, const xo_template_context_t *ctx,
+                                const xo_template_partials_t *partials, char **output);
+
+int xo_template_bind(const xo_template_t *tpl, const xo_template_context_t *ctx,
+                     const xo_template_partials_t *partials, xo_template_binding_t *binding);
+void xo_template_binding_free(xo_template_binding_t *binding);
+int xo_template_render_bound(const xo_template_t *tpl, const xo_template_binding_t *binding,
+                             const xo_template_context_t *ctx, const xo_template_partials_t *partials,
+                             char **output);
+
 #endif /* XO_TEMPLATE_H */ 
\ No newline at end of file
@@ -2,6 +2,7 @@
 #define XO_UTILS_H
 
 #include "xo.h"
+#include <stdint.h>
 
 #ifdef _WIN32
     #include <windows.h>
@@ -34,12 +35,16 @@ void xo_utils_str_split_free(char **parts, size_t count);
 
 // File utilities
 char *xo_utils_read_file(const char *path);
+char *xo_utils_read_file_length(const char *path, size_t *length);
 int xo_utils_write_file(const char *path, const char *content);
 int xo_utils_copy_file(const char *src, const char *dest);
 char **xo_utils_list_files(const char *path, const char *ext, size_t *count);
 void xo_utils_list_files_free(char **files, size_t count);
 
 // Hash utilities
+#define XO_HASH_HEX_LEN 16
+uint64_t xo_utils_hash64(const void *data, size_t length, uint64_t seed);
+void xo_utils_hash_to_hex(uint64_t hash, char hex[XO_HASH_HEX_LEN + 1]);
 char *xo_utils_hash_string(const char *str);
 char *xo_utils_hash_file(const char *path);
 
@@ -49,6 +54,10 @@ void xo_utils_console_success(const char *fmt, ...);
 void xo_utils_console_warning(const char *fmt, ...);
 void xo_utils_console_error(const char *fmt, ...);
 
+// System utilities
+int xo_utils_cpu_count(void);
+uint64_t xo_utils_time_ns(void);
+
 // Directory utilities
 int xo_utils_traverse_directory(const char *dirpath, xo_file_callback_t callback, void *user_data);
 
@@ -0,0 +1,48 @@
+#ifndef XO_WRITER_H
+#define XO_WRITER_H
+
+#include <string.h>
+#include "xo.h"
+#include "arena.h"
+
+// Growable output buffer with a tracked length, so appending never rescans
+// what was already written. The buffer always has room for a terminating NUL.
+typedef struct {
+    char *data;
+    size_t length;
+    size_t capacity;
+    xo_arena_t *arena;    // Owns data when set
+    bool failed;          // An allocation failed, later appends are dropped
+} xo_writer_t;
+
+// Function declarations
+int xo_writer_init(xo_writer_t *writer, xo_arena_t *arena, size_t capacity);
+void xo_writer_free(xo_writer_t *writer);
+int xo_writer_reserve(xo_writer_t *writer, size_t extra);
+char *xo_writer_finish(xo_writer_t *writer, size_t *length);
+int xo_writer_append_escaped(xo_writer_t *writer, const char *data, size_t length, bool apostrophe);
+int xo_writer_append_int(xo_writer_t *writer, long long value);
+
+// Append bytes, growing the buffer when they don't fit
+static inline int xo_writer_append(xo_writer_t *writer, const char *data, size_t length) {
+    if (writer->capacity - writer->length <= length && xo_writer_reserve(writer, length) != XO_SUCCESS) {
+        return XO_ERROR_MEMORY_ALLOCATION;
+    }
+    
+    memcpy(writer->data + writer->length, data, length);
+    writer->length += length;
+    
+    return XO_SUCCESS;
+}
+
+// Append a NUL-terminated string
+static inline int xo_writer_append_str(xo_writer_t *writer, const char *str) {
+    return xo_writer_append(writer, str, strlen(str));
+}
+
+// Append a single character
+static inline int xo_writer_putc(xo_writer_t *writer, char c) {
+    return xo_writer_append(writer, &c, 1);
+}
+
+#endif /* XO_WRITER_H */
@@ -29,6 +29,12 @@
 // Maximum path length
 #define XO_MAX_PATH 1024
 
+// Length-delimited slice of a larger buffer, not NUL-terminated
+typedef struct {
+    const char *data;
+    size_t length;
+} xo_span_t;
+
 // Command types
 typedef enum {
     XO_CMD_DEV,
@@ -43,10 +49,25 @@ typedef struct {
     char content_dir[XO_MAX_PATH];
     char layouts_dir[XO_MAX_PATH];
     char output_dir[XO_MAX_PATH];
+    char cache_dir[XO_MAX_PATH];
     int server_port;
+    int jobs;             // Number of build workers, 0 picks one per CPU
+    int queue_depth;      // Pages buffered between build stages, 0 picks twice the workers
+    int max_inflight_mb;  // Memory budget for pages between build stages, 0 for unlimited
     bool clean_build;
+    bool always_write;    // Rewrite outputs even when their bytes are unchanged
+    bool profile;         // Time the build stages of every page and print a report
+    int profile_top;      // Slowest pages listed in the profile report
+    char profile_path[XO_MAX_PATH];  // JSON profile report, empty for none
     bool running;         // Flag for controlling the dev server
     void *user_data;      // User data for callbacks
+    void *layout_cache;   // Layout cache kept by the dev server across rebuilds
+    void *partials;       // Partial registry kept by the dev server across rebuilds
+    void *markdown_cache; // Block ASTs of rebuilt pages kept by the dev server
+    void *highlight_cache; // Highlighted code snippets kept by the dev server
+    void *dependencies;   // Dependency graph kept by the dev server, updated by every rebuild
+    void *build_cache;    // Page keys and output hashes kept by the dev server
+    void *frontmatter_hashes; // Hash of each listed page's frontmatter kept by the dev server
 } xo_config_t;
 
 // Function declarations
@@ -0,0 +1,188 @@
+#include <stdlib.h>
+#include <string.h>
+#include "arena.h"
+
+// Alignment of arena allocations
+#define XO_ARENA_ALIGN 16
+
+static size_t align_up(size_t size) {
+    return (size + XO_ARENA_ALIGN - 1) & ~(size_t)(XO_ARENA_ALIGN - 1);
+}
+
+// Start of the usable memory of a block
+static char *block_data(xo_arena_block_t *block) {
+    return (char *)block + align_up(sizeof(xo_arena_block_t));
+}
+
+static xo_arena_block_t *block_create(size_t size) {
+    xo_arena_block_t *block = malloc(align_up(sizeof(xo_arena_block_t)) + size);
+    if (!block) {
+        return NULL;
+    }
+    
+    block->next = NULL;
+    block->size = size;
+    block->used = 0;
+    
+    return block;
+}
+
+// Initialize an arena, a block size of 0 picks the default
+int xo_arena_init(xo_arena_t *arena, size_t block_size) {
+    if (!arena) {
+        return XO_ERROR_MEMORY_ALLOCATION;
+    }
+    
+    arena->head = NULL;
+    arena->current = NULL;
+    arena->block_size = block_size > 0 ? block_size : XO_ARENA_BLOCK_SIZE;
+    arena->last = NULL;
+    
+    return XO_SUCCESS;
+}
+
+// Free every block of an arena
+void xo_arena_free(xo_arena_t *arena) {
+    if (!arena) {
+        return;
+    }
+    
+    xo_arena_block_t *block = arena->head;
+    while (block) {
+        xo_arena_block_t *next = block->next;
+        free(block);
+        block = next;
+    }
+    
+    arena->head = NULL;
+    arena->current = NULL;
+    arena->last = NULL;
+}
+
+// Release every allocation at once, keeping the blocks for reuse
+void xo_arena_reset(xo_arena_t *arena) {
+    if (!arena) {
+        return;
+    }
+    
+    for (xo_arena_block_t *block = arena->head; block; block = block->next) {
+        block->used = 0;
+    }
+    
+    arena->current = arena->head;
+    arena->last = NULL;
+}
+
+// Allocate memory from the arena
+void *xo_arena_alloc(xo_arena_t *arena, size_t size) {
+    if (!arena) {
+        return NULL;
+    }
+    
+    size = align_up(size > 0 ? size : 1);
+    
+    // Bump from the current block, moving on to blocks kept by a reset
+    xo_arena_block_t *block = arena->current;
+    while (block && block->size - block->used < size) {
+        block = block->next;
+    }
+    
+    if (!block) {
+        block = block_create(size > arena->block_size ? size : arena->block_size);
+        if (!block) {
+            return NULL;
+        }
+        
+        // Insert the new block after the current one so reused blocks stay reachable
+        if (arena->current) {
+            block->next = arena->current->next;
+            arena->current->next = block;
+        } else {
+            block->next = arena->head;
+            arena->head = block;
+        }
+    }
+    
+    void *ptr = block_data(block) + block->used;
+    block->used += size;
+    arena->current = block;
+    arena->last = ptr;
+    
+    return ptr;
+}
+
+// Grow an allocation. The most recent allocation grows in place when its
+// block has room, anything else is copied to a new allocation.
+void *xo_arena_realloc(xo_arena_t *arena, void *ptr, size_t old_size, size_t new_size) {
+    if (!arena) {
+        return NULL;
+    }
+    
+    if (!ptr) {
+        return xo_arena_alloc(arena, new_size);
+    }
+    
+    if (new_size <= old_size) {
+        return ptr;
+    }
+    
+    if (ptr == arena->last) {
+        xo_arena_block_t *block = arena->current;
+        size_t offset = (size_t)((char *)ptr - block_data(block));
+        size_t size = align_up(new_size);
+        
+        if (offset + size <= block->size) {
+            block->used = offset + size;
+            return ptr;
+        }
+    }
+    
+    void *new_ptr = xo_arena_alloc(arena, new_size);
+    if (!new_ptr) {
+        return NULL;
+    }
+    
+    memcpy(new_ptr, ptr, old_size);
+    
+    return new_ptr;
+}
+
+// Duplicate a string into the arena
+char *xo_arena_strdup(xo_arena_t *arena, const char *str) {
+    if (!str) {
+        return NULL;
+    }
+    
+    return xo_arena_strndup(arena, str, strlen(str));
+}
+
+// Duplicate at most n characters of a string into the arena
+char *xo_arena_strndup(xo_arena_t *arena, const char *str, size_t n) {
+    if (!str) {
+        return NULL;
+    }
+    
+    size_t len = strnlen(str, n);
+    char *copy = xo_arena_alloc(arena, len + 1);
+    if (!copy) {
+        return NULL;
+    }
+    
+    memcpy(copy, str, len);
+    copy[len] = '\0';
+    
+    return copy;
+}
+
+// Number of bytes currently allocated from the arena
+size_t xo_arena_used(const xo_arena_t *arena) {
+    size_t used = 0;
+    
+    if (arena) {
+        for (xo_arena_block_t *block = arena->head; block; block = block->next) {
+            used += block->used;
+        }
+    }
+    
+    return used;
+}
@@ -1,6 +1,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <ctype.h>
 #include <stdbool.h>
 #include <time.h>
 #include <sys/stat.h>
@@ -15,6 +16,14 @@
     typedef DWORD WINAPI thread_func_t(LPVOID);
     #define thread_create(handle, func, arg) (((*(handle)) = CreateThread(NULL, 0, (func), (arg), 0, NULL)) == NULL)
     #define thread_join(handle) WaitForSingleObject((handle), INFINITE); CloseHandle((handle))
+    
+    // Windows condition variables
+    typedef CONDITION_VARIABLE cond_t;
+    #define cond_init(c) InitializeConditionVariable(c)
+    #define cond_destroy(c) ((void)(c))
+    #define cond_wait(c, m) SleepConditionVariableCS((c), (m), INFINITE)
+    #define cond_signal(c) WakeConditionVariable(c)
+    #define cond_broadcast(c) WakeAllConditionVariable(c)
 #else
     #include <unistd.h>
     #include <pthread.h>
@@ -25,14 +34,26 @@
     typedef void *(*thread_func_t)(void *);
     #define thread_create(handle, func, arg) pthread_create((handle), NULL, (func), (arg))
     #define thread_join(handle) pthread_join((handle), NULL)
+    
+    // POSIX condition variables
+    typedef pthread_cond_t cond_t;
+    #define cond_init(c) pthread_cond_init((c), NULL)
+    #define cond_destroy(c) pthread_cond_destroy(c)
+    #define cond_wait(c, m) pthread_cond_wait((c), (m))
+    #define cond_signal(c) pthread_cond_signal(c)
+    #define cond_broadcast(c) pthread_cond_broadcast(c)
 #endif
 
 #include "build.h"
 #include "utils.h"
+#include "mutex.h"
 #include "server.h"
 #include "watcher.h"
+#include "arena.h"
+#include "profile.h"
 #include "markdown.h"
 #include "template.h"
+#include "scan.h"
 
 // Sample content for init command
 static const char *SAMPLE_INDEX_MD = 
@@ -69,7 +90,7 @@ static const char *SAMPLE_LAYOUT =
 static const char *SAMPLE_PARTIAL =
 "## This is a partial\n"
 "\n"
-"You can include this in other markdown files using the `{{> partial}}` syntax.\n";
+"You can include this in other markdown files by its name, `partial`, in a partial tag.\n";
 
 // Initialize a build cache
 int xo_build_cache_init(xo_build_cache_t *cache) {
@@ -80,6 +101,17 @@ int xo_build_cache_init(xo_build_cache_t *cache) {
     cache->entries = NULL;
     cache->count = 0;
     cache->capacity = 0;
+    cache->index = NULL;
+    cache->index_capacity = 0;
+    
+    // The cache is consulted and updated by all build workers
+    mutex_t *lock = malloc(sizeof(mutex_t));
+    if (!lock) {
+        cache->lock = NULL;
+        return XO_ERROR_MEMORY_ALLOCATION;
+    }
+    mutex_init(lock);
+    cache->lock = lock;
     
     return XO_SUCCESS;
 }
@@ -96,18 +128,90 @@ void xo_build_cache_free(xo_build_cache_t *cache) {
     }
     
     free(cache->entries);
+    free(cache->index);
+    
+    if (cache->lock) {
+        mutex_destroy((mutex_t *)cache->lock);
+        free(cache->lock);
+    }
     
     cache->entries = NULL;
     cache->count = 0;
     cache->capacity = 0;
+    cache->index = NULL;
+    cache->index_capacity = 0;
+    cache->lock = NULL;
 }
 
-// Add an entry to the build cache
-int xo_build_cache_add(xo_build_cache_t *cache, const char *filepath, const char *hash) {
-    if (!cache || !filepath || !hash) {
+// Hash a path for the cache index
+static size_t cache_path_hash(const char *filepath) {
+    return (size_t)xo_utils_hash64(filepath, strlen(filepath), 0);
+}
+
+// Find the entry for a path (caller holds the cache lock)
+static xo_build_cache_entry_t *cache_find_locked(const xo_build_cache_t *cache, const char *filepath) {
+    if (cache->index_capacity == 0) {
+        return NULL;
+    }
+    
+    size_t mask = cache->index_capacity - 1;
+    size_t slot = cache_path_hash(filepath) & mask;
+    
+    while (cache->index[slot] != 0) {
+        xo_build_cache_entry_t *entry = &cache->entries[cache->index[slot] - 1];
+        if (strcmp(entry->filepath, filepath) == 0) {
+            return entry;
+        }
+        slot = (slot + 1) & mask;
+    }
+    
+    return NULL;
+}
+
+// Grow the index so it stays at most half full (caller holds the cache lock)
+static int cache_grow_index_locked(xo_build_cache_t *cache) {
+    size_t new_capacity = cache->index_capacity == 0 ? 16 : cache->index_capacity * 2;
+    size_t *new_index = calloc(new_capacity, sizeof(size_t));
+    if (!new_index) {
         return XO_ERROR_MEMORY_ALLOCATION;
     }
     
+    size_t mask = new_capacity - 1;
+    for (size_t i = 0; i < cache->count; i++) {
+        size_t slot = cache_path_hash(cache->entries[i].filepath) & mask;
+        while (new_index[slot] != 0) {
+            slot = (slot + 1) & mask;
+        }
+        new_index[slot] = i + 1;
+    }
+    
+    free(cache->index);
+    cache->index = new_index;
+    cache->index_capacity = new_capacity;
+    
+    return XO_SUCCESS;
+}
+
+// Add or update an entry (caller holds the cache lock)
+static int cache_add_locked(xo_build_cache_t *cache, const char *filepath, const char *hash) {
+    // Update the hash if the file is already in the cache
+    xo_build_cache_entry_t *existing = cache_find_locked(cache, filepath);
+    if (existing) {
+        if (strcmp(existing->hash, hash) == 0) {
+            existing->used = true;
+            return XO_SUCCESS;
+        }
+        
+        char *new_hash = strdup(hash);
+        if (!new_hash) {
+            return XO_ERROR_MEMORY_ALLOCATION;
+        }
+        free(existing->hash);
+        existing->hash = new_hash;
+        existing->used = true;
+        return XO_SUCCESS;
+    }
+    
     // Check if we need to resize the array
     if (cache->count >= cache->capacity) {
         size_t new_capacity = cache->capacity == 0 ? 8 : cache->capacity * 2;
@@ -121,509 +225,2919 @@ int xo_build_cache_add(xo_build_cache_t *cache, const char *filepath, const char
         cache->capacity = new_capacity;
     }
     
-    // Check if the file is already in the cache
-    for (size_t i = 0; i < cache->count; i++) {
-        if (strcmp(cache->entries[i].filepath, filepath) == 0) {
-            // Update the hash
-            free(cache->entries[i].hash);
-            cache->entries[i].hash = strdup(hash);
-            if (!cache->entries[i].hash) {
-                return XO_ERROR_MEMORY_ALLOCATION;
-            }
-            return XO_SUCCESS;
-        }
+    if ((cache->count + 1) * 2 > cache->index_capacity && cache_grow_index_locked(cache) != XO_SUCCESS) {
+        return XO_ERROR_MEMORY_ALLOCATION;
     }
     
     // Add the new entry
-    cache->entries[cache->count].filepath = strdup(filepath);
-    cache->entries[cache->count].hash = strdup(hash);
-    
-    if (!cache->entries[cache->count].filepath || !cache->entries[cache->count].hash) {
-        free(cache->entries[cache->count].filepath);
-        free(cache->entries[cache->count].hash);
+    xo_build_cache_entry_t *entry = &cache->entries[cache->count];
+    entry->filepath = strdup(filepath);
+    entry->hash = strdup(hash);
+    entry->used = true;
+    
+    if (!entry->filepath || !entry->hash) {
+        free(entry->filepath);
+        free(entry->hash);
         return XO_ERROR_MEMORY_ALLOCATION;
     }
     
+    size_t mask = cache->index_capacity - 1;
+    size_t slot = cache_path_hash(filepath) & mask;
+    while (cache->index[slot] != 0) {
+        slot = (slot + 1) & mask;
+    }
+    cache->index[slot] = cache->count + 1;
+    
     cache->count++;
     
     return XO_SUCCESS;
 }
 
-// Get a hash from the build cache
-const char *xo_build_cache_get(const xo_build_cache_t *cache, const char *filepath) {
+// Add an entry to the build cache
+int xo_build_cache_add(xo_build_cache_t *cache, const char *filepath, const char *hash) {
+    if (!cache || !filepath || !hash) {
+        return XO_ERROR_MEMORY_ALLOCATION;
+    }
+    
+    mutex_lock((mutex_t *)cache->lock);
+    int result = cache_add_locked(cache, filepath, hash);
+    mutex_unlock((mutex_t *)cache->lock);
+    
+    return result;
+}
+
+// Copy a hash from the build cache into out. The copy is made under the lock,
+// another worker may replace the entry's hash as soon as it is released.
+// Returns false when the path has no hash.
+bool xo_build_cache_get(const xo_build_cache_t *cache, const char *filepath, char out[XO_HASH_HEX_LEN + 1]) {
+    if (!cache || !filepath || !out) {
+        return false;
+    }
+    
+    mutex_lock((mutex_t *)cache->lock);
+    
+    xo_build_cache_entry_t *entry = cache_find_locked(cache, filepath);
+    bool found = false;
+    if (entry && strlen(entry->hash) <= XO_HASH_HEX_LEN) {
+        // Mark the entry as still in use so it survives the next save
+        entry->used = true;
+        strcpy(out, entry->hash);
+        found = true;
+    }
+    
+    mutex_unlock((mutex_t *)cache->lock);
+    
+    return found;
+}
+
+// Mark an entry as used by this build without reading it, so the next save
+// keeps it
+void xo_build_cache_touch(xo_build_cache_t *cache, const char *filepath) {
     if (!cache || !filepath) {
-        return NULL;
+        return;
     }
     
-    for (size_t i = 0; i < cache->count; i++) {
-        if (strcmp(cache->entries[i].filepath, filepath) == 0) {
-            return cache->entries[i].hash;
+    mutex_lock((mutex_t *)cache->lock);
+    
+    xo_build_cache_entry_t *entry = cache_find_locked(cache, filepath);
+    if (entry) {
+        entry->used = true;
+    }
+    
+    mutex_unlock((mutex_t *)cache->lock);
+}
+
+// qsort comparator ordering cache entries by path
+static int compare_cache_entries(const void *a, const void *b) {
+    const xo_build_cache_entry_t *entry_a = *(const xo_build_cache_entry_t *const *)a;
+    const xo_build_cache_entry_t *entry_b = *(const xo_build_cache_entry_t *const *)b;
+    return strcmp(entry_a->filepath, entry_b->filepath);
+}
+
+// Save the build cache, one "<hash> <path>" line per entry.
+// Entries not used by this build (deleted pages) are dropped.
+int xo_build_cache_save(const xo_build_cache_t *cache, const char *cache_path) {
+    if (!cache || !cache_path) {
+        return XO_ERROR_MEMORY_ALLOCATION;
+    }
+    
+    char *cache_dir = xo_utils_dirname(cache_path);
+    if (!cache_dir) {
+        return XO_ERROR_MEMORY_ALLOCATION;
+    }
+    
+    int mkdir_result = xo_utils_mkdir_p(cache_dir);
+    free(cache_dir);
+    if (mkdir_result != 0) {
+        return XO_ERROR_FILE_NOT_FOUND;
+    }
+    
+    mutex_lock((mutex_t *)cache->lock);
+    
+    // Sort a view of the entries so the file is stable between runs
+    const xo_build_cache_entry_t **sorted = NULL;
+    size_t sorted_count = 0;
+    if (cache->count > 0) {
+        sorted = malloc(cache->count * sizeof(xo_build_cache_entry_t *));
+        if (!sorted) {
+            mutex_unlock((mutex_t *)cache->lock);
+            return XO_ERROR_MEMORY_ALLOCATION;
+        }
+        
+        for (size_t i = 0; i < cache->count; i++) {
+            if (cache->entries[i].used) {
+                sorted[sorted_count++] = &cache->entries[i];
+            }
         }
+        
+        qsort(sorted, sorted_count, sizeof(xo_build_cache_entry_t *), compare_cache_entries);
     }
     
-    return NULL;
+    // Write to a temporary file and rename it so a crash never leaves a torn cache
+    char temp_path[XO_MAX_PATH];
+    snprintf(temp_path, sizeof(temp_path), "%s.tmp", cache_path);
+    
+    FILE *file = fopen(temp_path, "wb");
+    if (!file) {
+        mutex_unlock((mutex_t *)cache->lock);
+        free(sorted);
+        return XO_ERROR_FILE_NOT_FOUND;
+    }
+    
+    bool write_ok = fprintf(file, "xo-build-cache 1\n") > 0;
+    for (size_t i = 0; i < sorted_count && write_ok; i++) {
+        write_ok = fprintf(file, "%s %s\n", sorted[i]->hash, sorted[i]->filepath) > 0;
+    }
+    
+    mutex_unlock((mutex_t *)cache->lock);
+    free(sorted);
+    
+    if (fclose(file) != 0 || !write_ok) {
+        remove(temp_path);
+        return XO_ERROR_FILE_NOT_FOUND;
+    }
+    
+    remove(cache_path);
+    if (rename(temp_path, cache_path) != 0) {
+        remove(temp_path);
+        return XO_ERROR_FILE_NOT_FOUND;
+    }
+    
+    return XO_SUCCESS;
+}
+
+// Load a build cache written by xo_build_cache_save
+int xo_build_cache_load(xo_build_cache_t *cache, const char *cache_path) {
+    if (!cache || !cache_path) {
+        return XO_ERROR_MEMORY_ALLOCATION;
+    }
+    
+    char *content = xo_utils_read_file(cache_path);
+    if (!content) {
+        return XO_ERROR_FILE_NOT_FOUND;
+    }
+    
+    // Reject caches written by an incompatible version
+    const char *header = "xo-build-cache 1\n";
+    if (strncmp(content, header, strlen(header)) != 0) {
+        free(content);
+        return XO_ERROR_INVALID_FORMAT;
+    }
+    
+    mutex_lock((mutex_t *)cache->lock);
+    
+    int result = XO_SUCCESS;
+    char *line = content + strlen(header);
+    while (*line && result == XO_SUCCESS) {
+        char *line_end = strchr(line, '\n');
+        if (line_end) {
+            *line_end = '\0';
+        }
+        
+        char *separator = strchr(line, ' ');
+        if (separator && separator - line == XO_HASH_HEX_LEN) {
+            *separator = '\0';
+            result = cache_add_locked(cache, separator + 1, line);
+        }
+        
+        if (!line_end) {
+            break;
+        }
+        line = line_end + 1;
+    }
+    
+    // Loaded entries only survive the next save if this build uses them
+    for (size_t i = 0; i < cache->count; i++) {
+        cache->entries[i].used = false;
+    }
+    
+    mutex_unlock((mutex_t *)cache->lock);
+    free(content);
+    
+    return result;
 }
 
-// Compute a simple hash for a file
+// Hash the content of a file
 int xo_compute_file_hash(const char *filepath, char **hash) {
     if (!filepath || !hash) {
         return XO_ERROR_MEMORY_ALLOCATION;
     }
     
-    // Get the file modification time
-    struct stat st;
-    if (stat(filepath, &st) != 0) {
+    char *hash_buffer = xo_utils_hash_file(filepath);
+    if (!hash_buffer) {
         return XO_ERROR_FILE_NOT_FOUND;
     }
     
-    // Use the modification time as a simple hash
-    char *hash_buffer = malloc(32);
-    if (!hash_buffer) {
+    *hash = hash_buffer;
+    
+    return XO_SUCCESS;
+}
+
+// Initialize a layout cache
+int xo_layout_cache_init(xo_layout_cache_t *cache) {
+    if (!cache) {
         return XO_ERROR_MEMORY_ALLOCATION;
     }
     
-    sprintf(hash_buffer, "%ld", (long)st.st_mtime);
-    *hash = hash_buffer;
+    cache->entries = NULL;
+    cache->count = 0;
+    cache->capacity = 0;
+    cache->retired = NULL;
+    cache->retired_count = 0;
+    cache->retired_capacity = 0;
+    cache->retired_bindings = NULL;
+    cache->retired_binding_count = 0;
+    cache->retired_binding_capacity = 0;
+    cache->generation = 0;
+    
+    mutex_t *lock = malloc(sizeof(mutex_t));
+    if (!lock) {
+        cache->lock = NULL;
+        return XO_ERROR_MEMORY_ALLOCATION;
+    }
+    mutex_init(lock);
+    cache->lock = lock;
     
     return XO_SUCCESS;
 }
 
-// Check if a file needs to be rebuilt
-bool xo_should_rebuild(const xo_build_cache_t *cache, const char *filepath) {
-    if (!cache || !filepath) {
-        return true;
+static void layout_template_destroy(xo_template_t *tpl) {
+    if (tpl) {
+        xo_template_free(tpl);
+        free(tpl);
+    }
+}
+
+static void layout_binding_destroy(xo_template_binding_t *binding) {
+    if (binding) {
+        xo_template_binding_free(binding);
+        free(binding);
+    }
+}
+
+// Free resources used by a layout cache
+void xo_layout_cache_free(xo_layout_cache_t *cache) {
+    if (!cache) {
+        return;
     }
     
-    // Get the current hash
-    char *current_hash;
-    if (xo_compute_file_hash(filepath, &current_hash) != XO_SUCCESS) {
-        return true;
+    for (size_t i = 0; i < cache->count; i++) {
+        free(cache->entries[i].path);
+        layout_template_destroy(cache->entries[i].tpl);
+        for (size_t b = 0; b < cache->entries[i].binding_count; b++) {
+            layout_binding_destroy(cache->entries[i].bindings[b]);
+        }
     }
     
-    // Get the cached hash
-    const char *cached_hash = xo_build_cache_get(cache, filepath);
-    if (!cached_hash) {
-        free(current_hash);
-        return true;
+    for (size_t i = 0; i < cache->retired_count; i++) {
+        layout_template_destroy(cache->retired[i]);
     }
     
-    // Compare the hashes
-    bool should_rebuild = strcmp(current_hash, cached_hash) != 0;
+    for (size_t i = 0; i < cache->retired_binding_count; i++) {
+        layout_binding_destroy(cache->retired_bindings[i]);
+    }
+    
+    free(cache->entries);
+    free(cache->retired);
+    free(cache->retired_bindings);
     
-    free(current_hash);
+    if (cache->lock) {
+        mutex_destroy((mutex_t *)cache->lock);
+        free(cache->lock);
+    }
     
-    return should_rebuild;
+    cache->entries = NULL;
+    cache->count = 0;
+    cache->capacity = 0;
+    cache->retired = NULL;
+    cache->retired_count = 0;
+    cache->retired_capacity = 0;
+    cache->retired_bindings = NULL;
+    cache->retired_binding_count = 0;
+    cache->retired_binding_capacity = 0;
+    cache->lock = NULL;
 }
 
-// Initialize a dependency tracker
-int xo_dependency_tracker_init(xo_dependency_tracker_t *tracker) {
-    if (!tracker) {
+// Start a new build, each layout is checked against its file again on first use.
+// Builds don't overlap, so no page still renders a layout retired by an earlier one.
+void xo_layout_cache_begin_build(xo_layout_cache_t *cache) {
+    if (!cache) {
+        return;
+    }
+    
+    mutex_lock((mutex_t *)cache->lock);
+    cache->generation++;
+    
+    for (size_t i = 0; i < cache->retired_count; i++) {
+        layout_template_destroy(cache->retired[i]);
+    }
+    cache->retired_count = 0;
+    
+    for (size_t i = 0; i < cache->retired_binding_count; i++) {
+        layout_binding_destroy(cache->retired_bindings[i]);
+    }
+    cache->retired_binding_count = 0;
+    
+    mutex_unlock((mutex_t *)cache->lock);
+}
+
+static xo_layout_cache_entry_t *layout_cache_find_locked(xo_layout_cache_t *cache, const char *layout_path) {
+    for (size_t i = 0; i < cache->count; i++) {
+        if (strcmp(cache->entries[i].path, layout_path) == 0) {
+            return &cache->entries[i];
+        }
+    }
+    
+    return NULL;
+}
+
+// Take a template out of use without freeing it, other pages may still be rendering it
+static int layout_cache_retire_locked(xo_layout_cache_t *cache, xo_template_t *tpl) {
+    if (cache->retired_count >= cache->retired_capacity) {
+        size_t new_capacity = cache->retired_capacity == 0 ? 8 : cache->retired_capacity * 2;
+        xo_template_t **new_retired = realloc(cache->retired, new_capacity * sizeof(xo_template_t *));
+        
+        if (!new_retired) {
+            return XO_ERROR_MEMORY_ALLOCATION;
+        }
+        
+        cache->retired = new_retired;
+        cache->retired_capacity = new_capacity;
+    }
+    
+    cache->retired[cache->retired_count++] = tpl;
+    
+    return XO_SUCCESS;
+}
+
+// Make room to retire count more bindings, so retiring them can't fail halfway
+static int layout_cache_reserve_bindings_locked(xo_layout_cache_t *cache, size_t count) {
+    if (cache->retired_binding_count + count <= cache->retired_binding_capacity) {
+        return XO_SUCCESS;
+    }
+    
+    size_t new_capacity = cache->retired_binding_capacity == 0 ? 8 : cache->retired_binding_capacity * 2;
+    while (new_capacity < cache->retired_binding_count + count) {
+        new_capacity *= 2;
+    }
+    
+    xo_template_binding_t **new_retired = realloc(cache->retired_bindings, new_capacity * sizeof(xo_template_binding_t *));
+    if (!new_retired) {
         return XO_ERROR_MEMORY_ALLOCATION;
     }
     
-    tracker->entries = NULL;
-    tracker->count = 0;
-    tracker->capacity = 0;
+    cache->retired_bindings = new_retired;
+    cache->retired_binding_capacity = new_capacity;
+    
+    return XO_SUCCESS;
+}
+
+// Take an entry's bindings out of use, room for them must be reserved
+static void layout_cache_retire_bindings_locked(xo_layout_cache_t *cache, xo_layout_cache_entry_t *entry) {
+    for (size_t i = 0; i < entry->binding_count; i++) {
+        cache->retired_bindings[cache->retired_binding_count++] = entry->bindings[i];
+    }
+    entry->binding_count = 0;
+}
+
+// Store a freshly compiled layout, retiring the one it replaces
+static int layout_cache_insert_locked(xo_layout_cache_t *cache, xo_layout_cache_entry_t *entry,
+                                      const char *layout_path, xo_template_t *tpl) {
+    if (!entry) {
+        if (cache->count >= cache->capacity) {
+            size_t new_capacity = cache->capacity == 0 ? 8 : cache->capacity * 2;
+            xo_layout_cache_entry_t *new_entries = realloc(cache->entries, new_capacity * sizeof(xo_layout_cache_entry_t));
+            
+            if (!new_entries) {
+                return XO_ERROR_MEMORY_ALLOCATION;
+            }
+            
+            cache->entries = new_entries;
+            cache->capacity = new_capacity;
+        }
+        
+        entry = &cache->entries[cache->count];
+        entry->path = xo_utils_strdup(layout_path);
+        entry->tpl = NULL;
+        entry->binding_count = 0;
+        
+        if (!entry->path) {
+            return XO_ERROR_MEMORY_ALLOCATION;
+        }
+        
+        cache->count++;
+    } else if (entry->tpl && (layout_cache_reserve_bindings_locked(cache, entry->binding_count) != XO_SUCCESS ||
+                              layout_cache_retire_locked(cache, entry->tpl) != XO_SUCCESS)) {
+        return XO_ERROR_MEMORY_ALLOCATION;
+    }
+    
+    layout_cache_retire_bindings_locked(cache, entry);
+    entry->tpl = tpl;
+    entry->generation = cache->generation;
+    
+    return XO_SUCCESS;
+}
+
+// Get the compiled layout for a path. The first use in a build reads the file
+// and recompiles only when its content hash changed; later uses are a lookup.
+// Reading and compiling happen outside the lock, when two pages load the same
+// layout at once the first to finish is kept.
+const xo_template_t *xo_layout_cache_get(xo_layout_cache_t *cache, const char *layout_path) {
+    if (!cache || !layout_path) {
+        return NULL;
+    }
+    
+    for (;;) {
+        mutex_lock((mutex_t *)cache->lock);
+        
+        xo_layout_cache_entry_t *entry = layout_cache_find_locked(cache, layout_path);
+        if (entry && entry->tpl && entry->generation == cache->generation) {
+            const xo_template_t *tpl = entry->tpl;
+            mutex_unlock((mutex_t *)cache->lock);
+            return tpl;
+        }
+        
+        bool has_cached = entry && entry->tpl;
+        uint64_t cached_hash = has_cached ? entry->tpl->hash : 0;
+        size_t cached_length = has_cached ? entry->tpl->length : 0;
+        
+        mutex_unlock((mutex_t *)cache->lock);
+        
+        char *source = xo_utils_read_file(layout_path);
+        if (!source) {
+            return NULL;
+        }
+        
+        size_t length = strlen(source);
+        uint64_t hash = xo_utils_hash64(source, length, 0);
+        bool unchanged = has_cached && cached_hash == hash && cached_length == length;
+        
+        // An unchanged layout only needs its entry marked as checked
+        xo_template_t *tpl = NULL;
+        if (!unchanged) {
+            tpl = malloc(sizeof(xo_template_t));
+            if (!tpl || xo_template_compile(source, length, tpl) != XO_SUCCESS) {
+                free(tpl);
+                free(source);
+                return NULL;
+            }
+        }
+        
+        free(source);
+        
+        mutex_lock((mutex_t *)cache->lock);
+        
+        // Another page may have loaded the layout, or the dev server dropped it, meanwhile
+        entry = layout_cache_find_locked(cache, layout_path);
+        const xo_template_t *result = NULL;
+        if (entry && entry->tpl && entry->generation == cache->generation) {
+            result = entry->tpl;
+        } else if (entry && entry->tpl && entry->tpl->hash == hash && entry->tpl->length == length) {
+            entry->generation = cache->generation;
+            result = entry->tpl;
+        } else if (tpl) {
+            if (layout_cache_insert_locked(cache, entry, layout_path, tpl) != XO_SUCCESS) {
+                mutex_unlock((mutex_t *)cache->lock);
+                layout_template_destroy(tpl);
+                return NULL;
+            }
+            result = tpl;
+            tpl = NULL;
+        }
+        
+        mutex_unlock((mutex_t *)cache->lock);
+        layout_template_destroy(tpl);
+        
+        // The entry it was checked against went away before it could be marked, load it again
+        if (result) {
+            return result;
+        }
+    }
+}
+
+// Drop a layout after it changed on disk, the next use compiles it again
+void xo_layout_cache_invalidate(xo_layout_cache_t *cache, const char *layout_path) {
+    if (!cache || !layout_path) {
+        return;
+    }
+    
+    mutex_lock((mutex_t *)cache->lock);
+    
+    xo_layout_cache_entry_t *entry = layout_cache_find_locked(cache, layout_path);
+    if (entry && entry->tpl && layout_cache_reserve_bindings_locked(cache, entry->binding_count) == XO_SUCCESS &&
+        layout_cache_retire_locked(cache, entry->tpl) == XO_SUCCESS) {
+        layout_cache_retire_bindings_locked(cache, entry);
+        entry->tpl = NULL;
+    }
+    
+    mutex_unlock((mutex_t *)cache->lock);
+}
+
+static xo_layout_cache_entry_t *layout_cache_find_template_locked(xo_layout_cache_t *cache,
+                                                                  const xo_template_t *layout) {
+    for (size_t i = 0; i < cache->count; i++) {
+        if (cache->entries[i].tpl == layout) {
+            return &cache->entries[i];
+        }
+    }
+    
+    return NULL;
+}
+
+static const xo_template_binding_t *layout_entry_binding(const xo_layout_cache_entry_t *entry, uint64_t shape) {
+    for (size_t i = 0; i < entry->binding_count; i++) {
+        if (entry->bindings[i]->shape == shape) {
+            return entry->bindings[i];
+        }
+    }
+    
+    return NULL;
+}
+
+// Get the binding of a cached layout and the partials it includes for the
+// shape of a context. The first page of each shape binds the variables, later
+// pages of that shape render by slot index. Returns NULL when the layout has
+// been replaced or keeps bindings for too many shapes already, the page then
+// binds as it renders.
+const xo_template_binding_t *xo_layout_cache_bind(xo_layout_cache_t *cache, const xo_template_t *layout,
+                                                  const xo_template_context_t *ctx,
+                                                  const xo_template_partials_t *partials) {
+    if (!cache || !layout || !ctx) {
+        return NULL;
+    }
+    
+    mutex_lock((mutex_t *)cache->lock);
+    
+    xo_layout_cache_entry_t *entry = layout_cache_find_template_locked(cache, layout);
+    const xo_template_binding_t *result = entry ? layout_entry_binding(entry, ctx->shape) : NULL;
+    bool full = !entry || entry->binding_count >= XO_LAYOUT_MAX_BINDINGS;
+    
+    mutex_unlock((mutex_t *)cache->lock);
+    
+    if (result || full) {
+        return result;
+    }
+    
+    // Bind outside the lock, when two pages of one shape bind at once the first is kept
+    xo_template_binding_t *binding = malloc(sizeof(xo_template_binding_t));
+    if (!binding || xo_template_bind(layout, ctx, partials, binding) != XO_SUCCESS) {
+        free(binding);
+        return NULL;
+    }
+    
+    mutex_lock((mutex_t *)cache->lock);
+    
+    entry = layout_cache_find_template_locked(cache, layout);
+    result = entry ? layout_entry_binding(entry, ctx->shape) : NULL;
+    if (!result && entry && entry->binding_count < XO_LAYOUT_MAX_BINDINGS) {
+        entry->bindings[entry->binding_count++] = binding;
+        result = binding;
+        binding = NULL;
+    }
+    
+    mutex_unlock((mutex_t *)cache->lock);
+    layout_binding_destroy(binding);
+    
+    return result;
+}
+
+// Drop every binding after the partials changed, bindings refer to the
+// partials they were made with. Pages bind again on their next render.
+void xo_layout_cache_drop_bindings(xo_layout_cache_t *cache) {
+    if (!cache) {
+        return;
+    }
+    
+    mutex_lock((mutex_t *)cache->lock);
+    
+    size_t count = 0;
+    for (size_t i = 0; i < cache->count; i++) {
+        count += cache->entries[i].binding_count;
+    }
+    
+    if (layout_cache_reserve_bindings_locked(cache, count) == XO_SUCCESS) {
+        for (size_t i = 0; i < cache->count; i++) {
+            layout_cache_retire_bindings_locked(cache, &cache->entries[i]);
+        }
+    }
+    
+    mutex_unlock((mutex_t *)cache->lock);
+}
+
+// Initialize a markdown cache
+int xo_markdown_cache_init(xo_markdown_cache_t *cache) {
+    if (!cache) {
+        return XO_ERROR_MEMORY_ALLOCATION;
+    }
+    
+    cache->entries = NULL;
+    cache->count = 0;
+    cache->capacity = 0;
+    cache->index = NULL;
+    cache->index_capacity = 0;
+    
+    mutex_t *lock = malloc(sizeof(mutex_t));
+    if (!lock) {
+        cache->lock = NULL;
+        return XO_ERROR_MEMORY_ALLOCATION;
+    }
+    mutex_init(lock);
+    cache->lock = lock;
+    
+    return XO_SUCCESS;
+}
+
+// Free resources used by a markdown cache
+void xo_markdown_cache_free(xo_markdown_cache_t *cache) {
+    if (!cache) {
+        return;
+    }
+    
+    for (size_t i = 0; i < cache->count; i++) {
+        free(cache->entries[i]->path);
+        xo_arena_free(&cache->entries[i]->arenas[0]);
+        xo_arena_free(&cache->entries[i]->arenas[1]);
+        free(cache->entries[i]);
+    }
+    
+    free(cache->entries);
+    free(cache->index);
+    
+    if (cache->lock) {
+        mutex_destroy((mutex_t *)cache->lock);
+        free(cache->lock);
+    }
+    
+    cache->entries = NULL;
+    cache->count = 0;
+    cache->capacity = 0;
+    cache->index = NULL;
+    cache->index_capacity = 0;
+    cache->lock = NULL;
+}
+
+// Find the entry for a path (caller holds the cache lock)
+static xo_markdown_cache_entry_t *markdown_cache_find_locked(const xo_markdown_cache_t *cache, const char *filepath) {
+    if (cache->index_capacity == 0) {
+        return NULL;
+    }
+    
+    size_t mask = cache->index_capacity - 1;
+    size_t slot = cache_path_hash(filepath) & mask;
+    
+    while (cache->index[slot] != 0) {
+        xo_markdown_cache_entry_t *entry = cache->entries[cache->index[slot] - 1];
+        if (strcmp(entry->path, filepath) == 0) {
+            return entry;
+        }
+        slot = (slot + 1) & mask;
+    }
+    
+    return NULL;
+}
+
+// Grow the index so it stays at most half full (caller holds the cache lock)
+static int markdown_cache_grow_index_locked(xo_markdown_cache_t *cache) {
+    size_t new_capacity = cache->index_capacity == 0 ? 16 : cache->index_capacity * 2;
+    size_t *new_index = calloc(new_capacity, sizeof(size_t));
+    if (!new_index) {
+        return XO_ERROR_MEMORY_ALLOCATION;
+    }
+    
+    size_t mask = new_capacity - 1;
+    for (size_t i = 0; i < cache->count; i++) {
+        size_t slot = cache_path_hash(cache->entries[i]->path) & mask;
+        while (new_index[slot] != 0) {
+            slot = (slot + 1) & mask;
+        }
+        new_index[slot] = i + 1;
+    }
+    
+    free(cache->index);
+    cache->index = new_index;
+    cache->index_capacity = new_capacity;
+    
+    return XO_SUCCESS;
+}
+
+// Add an empty entry for a path (caller holds the cache lock)
+static xo_markdown_cache_entry_t *markdown_cache_add_locked(xo_markdown_cache_t *cache, const char *filepath) {
+    if (cache->count >= cache->capacity) {
+        size_t new_capacity = cache->capacity == 0 ? 8 : cache->capacity * 2;
+        xo_markdown_cache_entry_t **new_entries = realloc(cache->entries,
+                                                          new_capacity * sizeof(xo_markdown_cache_entry_t *));
+        
+        if (!new_entries) {
+            return NULL;
+        }
+        
+        cache->entries = new_entries;
+        cache->capacity = new_capacity;
+    }
+    
+    if ((cache->count + 1) * 2 > cache->index_capacity && markdown_cache_grow_index_locked(cache) != XO_SUCCESS) {
+        return NULL;
+    }
+    
+    // Entries are allocated one by one so workers can hold them while the array grows
+    xo_markdown_cache_entry_t *entry = malloc(sizeof(xo_markdown_cache_entry_t));
+    if (!entry) {
+        return NULL;
+    }
+    
+    entry->path = strdup(filepath);
+    if (!entry->path) {
+        free(entry);
+        return NULL;
+    }
+    xo_arena_init(&entry->arenas[0], XO_ARENA_BLOCK_SIZE);
+    xo_arena_init(&entry->arenas[1], XO_ARENA_BLOCK_SIZE);
+    entry->current = 0;
+    xo_markdown_ast_init(&entry->ast, &entry->arenas[0]);
+    entry->busy = false;
+    
+    size_t mask = cache->index_capacity - 1;
+    size_t slot = cache_path_hash(filepath) & mask;
+    while (cache->index[slot] != 0) {
+        slot = (slot + 1) & mask;
+    }
+    cache->index[slot] = cache->count + 1;
+    
+    cache->entries[cache->count++] = entry;
+    
+    return entry;
+}
+
+// Convert a page to HTML through its cached block AST. The blocks are split
+// and hashed again, and only the ones that differ from the previous version
+// of the page are converted. The HTML is allocated from the page's arena.
+int xo_markdown_cache_to_html(xo_markdown_cache_t *cache, const char *filepath, const xo_markdown_t *md,
+                              char **html_output) {
+    if (!cache || !filepath || !md || !html_output) {
+        return XO_ERROR_MEMORY_ALLOCATION;
+    }
+    
+    mutex_lock((mutex_t *)cache->lock);
+    xo_markdown_cache_entry_t *entry = markdown_cache_find_locked(cache, filepath);
+    if (!entry) {
+        entry = markdown_cache_add_locked(cache, filepath);
+    }
+    
+    // Without an entry, or while another worker renders the same page, convert it directly
+    if (!entry || entry->busy) {
+        mutex_unlock((mutex_t *)cache->lock);
+        return xo_markdown_to_html(md, html_output);
+    }
+    entry->busy = true;
+    mutex_unlock((mutex_t *)cache->lock);
+    
+    // The new AST is built in the spare arena while the previous one is read,
+    // resetting it keeps its blocks so rebuilds do not fault in fresh memory
+    xo_arena_t *arena = &entry->arenas[1 - entry->current];
+    xo_arena_reset(arena);
+    
+    xo_markdown_ast_t ast;
+    xo_markdown_ast_init(&ast, arena);
+    ast.highlights = md->highlights;
+    
+    size_t rendered = 0;
+    int result = xo_markdown_ast_parse(&ast, md->content.data, md->content.length);
+    if (result == XO_SUCCESS) {
+        result = xo_markdown_ast_render(&ast, &entry->ast, &rendered);
+    }
+    if (result == XO_SUCCESS) {
+        result = xo_markdown_ast_to_html(&ast, md->arena, html_output);
+    }
+    
+    if (result == XO_SUCCESS) {
+        if (entry->ast.html) {
+            xo_utils_console_info("Converted %zu of %zu blocks: %s", rendered, ast.count, filepath);
+        }
+        
+        // Keep the new AST, its block sources point into the page and are not used again
+        entry->ast = ast;
+        entry->current = 1 - entry->current;
+    }
+    
+    mutex_lock((mutex_t *)cache->lock);
+    entry->busy = false;
+    mutex_unlock((mutex_t *)cache->lock);
+    
+    return result;
+}
+
+// Drop the AST of a page that was deleted
+void xo_markdown_cache_remove(xo_markdown_cache_t *cache, const char *filepath) {
+    if (!cache || !filepath) {
+        return;
+    }
+    
+    mutex_lock((mutex_t *)cache->lock);
+    
+    xo_markdown_cache_entry_t *entry = markdown_cache_find_locked(cache, filepath);
+    if (entry && !entry->busy) {
+        xo_arena_free(&entry->arenas[0]);
+        xo_arena_free(&entry->arenas[1]);
+        entry->current = 0;
+        xo_markdown_ast_init(&entry->ast, &entry->arenas[0]);
+    }
+    
+    mutex_unlock((mutex_t *)cache->lock);
+}
+
+// Initialize a dependency tracker
+int xo_dependency_tracker_init(xo_dependency_tracker_t *tracker) {
+    if (!tracker) {
+        return XO_ERROR_MEMORY_ALLOCATION;
+    }
+    
+    tracker->paths = NULL;
+    tracker->forward = NULL;
+    tracker->reverse = NULL;
+    tracker->count = 0;
+    tracker->capacity = 0;
+    tracker->index = NULL;
+    tracker->index_capacity = 0;
+    
+    // The tracker is shared by all build workers, so guard it with a mutex
+    mutex_t *lock = malloc(sizeof(mutex_t));
+    if (!lock) {
+        tracker->lock = NULL;
+        return XO_ERROR_MEMORY_ALLOCATION;
+    }
+    mutex_init(lock);
+    tracker->lock = lock;
+    
+    return XO_SUCCESS;
+}
+
+// Free resources used by a dependency tracker
+void xo_dependency_tracker_free(xo_dependency_tracker_t *tracker) {
+    if (!tracker) {
+        return;
+    }
+    
+    for (size_t i = 0; i < tracker->count; i++) {
+        free(tracker->paths[i]);
+        free(tracker->forward[i].ids);
+        free(tracker->reverse[i].ids);
+    }
+    
+    free(tracker->paths);
+    free(tracker->forward);
+    free(tracker->reverse);
+    free(tracker->index);
+    
+    if (tracker->lock) {
+        mutex_destroy((mutex_t *)tracker->lock);
+        free(tracker->lock);
+    }
+    
+    tracker->paths = NULL;
+    tracker->forward = NULL;
+    tracker->reverse = NULL;
+    tracker->count = 0;
+    tracker->capacity = 0;
+    tracker->index = NULL;
+    tracker->index_capacity = 0;
+    tracker->lock = NULL;
+}
+
+// Append an ID to a dependency list
+static int dependency_list_append(xo_dependency_list_t *list, uint32_t id) {
+    if (list->count >= list->capacity) {
+        size_t new_capacity = list->capacity == 0 ? 4 : list->capacity * 2;
+        uint32_t *new_ids = realloc(list->ids, new_capacity * sizeof(uint32_t));
+        
+        if (!new_ids) {
+            return XO_ERROR_MEMORY_ALLOCATION;
+        }
+        
+        list->ids = new_ids;
+        list->capacity = new_capacity;
+    }
+    
+    list->ids[list->count++] = id;
+    
+    return XO_SUCCESS;
+}
+
+// Find the ID of an interned path (caller holds the tracker lock)
+static bool dependency_tracker_find_locked(const xo_dependency_tracker_t *tracker, const char *path, uint32_t *id) {
+    if (tracker->index_capacity == 0) {
+        return false;
+    }
+    
+    size_t mask = tracker->index_capacity - 1;
+    size_t slot = cache_path_hash(path) & mask;
+    
+    while (tracker->index[slot] != 0) {
+        uint32_t candidate = tracker->index[slot] - 1;
+        if (strcmp(tracker->paths[candidate], path) == 0) {
+            *id = candidate;
+            return true;
+        }
+        slot = (slot + 1) & mask;
+    }
+    
+    return false;
+}
+
+// Insert an ID into the path index (caller holds the tracker lock)
+static void dependency_tracker_index_insert(uint32_t *index, size_t index_capacity, const char *path, uint32_t id) {
+    size_t mask = index_capacity - 1;
+    size_t slot = cache_path_hash(path) & mask;
+    
+    while (index[slot] != 0) {
+        slot = (slot + 1) & mask;
+    }
+    
+    index[slot] = id + 1;
+}
+
+// Intern a path and return its ID (caller holds the tracker lock)
+static int dependency_tracker_intern_locked(xo_dependency_tracker_t *tracker, const char *path, uint32_t *id) {
+    if (dependency_tracker_find_locked(tracker, path, id)) {
+        return XO_SUCCESS;
+    }
+    
+    // Check if we need to resize the arrays
+    if (tracker->count >= tracker->capacity) {
+        size_t new_capacity = tracker->capacity == 0 ? 8 : tracker->capacity * 2;
+        
+        char **new_paths = realloc(tracker->paths, new_capacity * sizeof(char *));
+        if (!new_paths) {
+            return XO_ERROR_MEMORY_ALLOCATION;
+        }
+        tracker->paths = new_paths;
+        
+        xo_dependency_list_t *new_forward = realloc(tracker->forward, new_capacity * sizeof(xo_dependency_list_t));
+        if (!new_forward) {
+            return XO_ERROR_MEMORY_ALLOCATION;
+        }
+        tracker->forward = new_forward;
+        
+        xo_dependency_list_t *new_reverse = realloc(tracker->reverse, new_capacity * sizeof(xo_dependency_list_t));
+        if (!new_reverse) {
+            return XO_ERROR_MEMORY_ALLOCATION;
+        }
+        tracker->reverse = new_reverse;
+        
+        tracker->capacity = new_capacity;
+    }
+    
+    // Keep the index at most half full
+    if ((tracker->count + 1) * 2 > tracker->index_capacity) {
+        size_t new_index_capacity = tracker->index_capacity == 0 ? 16 : tracker->index_capacity * 2;
+        uint32_t *new_index = calloc(new_index_capacity, sizeof(uint32_t));
+        if (!new_index) {
+            return XO_ERROR_MEMORY_ALLOCATION;
+        }
+        
+        for (size_t i = 0; i < tracker->count; i++) {
+            dependency_tracker_index_insert(new_index, new_index_capacity, tracker->paths[i], (uint32_t)i);
+        }
+        
+        free(tracker->index);
+        tracker->index = new_index;
+        tracker->index_capacity = new_index_capacity;
+    }
+    
+    uint32_t new_id = (uint32_t)tracker->count;
+    tracker->paths[new_id] = strdup(path);
+    if (!tracker->paths[new_id]) {
+        return XO_ERROR_MEMORY_ALLOCATION;
+    }
+    
+    memset(&tracker->forward[new_id], 0, sizeof(xo_dependency_list_t));
+    memset(&tracker->reverse[new_id], 0, sizeof(xo_dependency_list_t));
+    dependency_tracker_index_insert(tracker->index, tracker->index_capacity, path, new_id);
+    tracker->count++;
+    
+    *id = new_id;
+    
+    return XO_SUCCESS;
+}
+
+// Add an edge between interned paths (caller holds the tracker lock)
+static int dependency_tracker_link_locked(xo_dependency_tracker_t *tracker, uint32_t file_id, uint32_t dep_id) {
+    // A page has a handful of dependencies, so a scan of its forward list is cheap
+    xo_dependency_list_t *forward = &tracker->forward[file_id];
+    for (size_t i = 0; i < forward->count; i++) {
+        if (forward->ids[i] == dep_id) {
+            return XO_SUCCESS;
+        }
+    }
+    
+    if (dependency_list_append(forward, dep_id) != XO_SUCCESS) {
+        return XO_ERROR_MEMORY_ALLOCATION;
+    }
+    
+    if (dependency_list_append(&tracker->reverse[dep_id], file_id) != XO_SUCCESS) {
+        forward->count--;
+        return XO_ERROR_MEMORY_ALLOCATION;
+    }
+    
+    return XO_SUCCESS;
+}
+
+// Add a dependency to the tracker (caller holds the tracker lock)
+static int dependency_tracker_add_locked(xo_dependency_tracker_t *tracker, const char *filepath, const char *dependency) {
+    uint32_t file_id, dep_id;
+    
+    if (dependency_tracker_intern_locked(tracker, filepath, &file_id) != XO_SUCCESS ||
+        dependency_tracker_intern_locked(tracker, dependency, &dep_id) != XO_SUCCESS) {
+        return XO_ERROR_MEMORY_ALLOCATION;
+    }
+    
+    return dependency_tracker_link_locked(tracker, file_id, dep_id);
+}
+
+// Add a dependency to the tracker
+int xo_dependency_tracker_add(xo_dependency_tracker_t *tracker, const char *filepath, const char *dependency) {
+    if (!tracker || !filepath || !dependency) {
+        return XO_ERROR_MEMORY_ALLOCATION;
+    }
+    
+    mutex_lock((mutex_t *)tracker->lock);
+    int result = dependency_tracker_add_locked(tracker, filepath, dependency);
+    mutex_unlock((mutex_t *)tracker->lock);
+    
+    return result;
+}
+
+// Drop the dependencies recorded for a file, so a rebuild of the file records
+// its current dependencies in place of the old ones
+void xo_dependency_tracker_remove(xo_dependency_tracker_t *tracker, const char *filepath) {
+    if (!tracker || !filepath) {
+        return;
+    }
+    
+    mutex_lock((mutex_t *)tracker->lock);
+    
+    uint32_t file_id;
+    if (dependency_tracker_find_locked(tracker, filepath, &file_id)) {
+        xo_dependency_list_t *forward = &tracker->forward[file_id];
+        
+        for (size_t i = 0; i < forward->count; i++) {
+            xo_dependency_list_t *reverse = &tracker->reverse[forward->ids[i]];
+            for (size_t k = 0; k < reverse->count; k++) {
+                if (reverse->ids[k] == file_id) {
+                    reverse->ids[k] = reverse->ids[--reverse->count];
+                    break;
+                }
+            }
+        }
+        
+        forward->count = 0;
+    }
+    
+    mutex_unlock((mutex_t *)tracker->lock);
+}
+
+// Get files that depend on a specific file
+char **xo_dependency_tracker_get_reverse(const xo_dependency_tracker_t *tracker, const char *dependency, size_t *count) {
+    if (!tracker || !dependency || !count) {
+        if (count) {
+            *count = 0;
+        }
+        return NULL;
+    }
+    
+    *count = 0;
+    
+    mutex_lock((mutex_t *)tracker->lock);
+    
+    uint32_t dep_id;
+    if (!dependency_tracker_find_locked(tracker, dependency, &dep_id) || tracker->reverse[dep_id].count == 0) {
+        mutex_unlock((mutex_t *)tracker->lock);
+        return NULL;
+    }
+    
+    const xo_dependency_list_t *reverse = &tracker->reverse[dep_id];
+    char **result = malloc(reverse->count * sizeof(char *));
+    if (!result) {
+        mutex_unlock((mutex_t *)tracker->lock);
+        return NULL;
+    }
+    
+    for (size_t i = 0; i < reverse->count; i++) {
+        result[i] = strdup(tracker->paths[reverse->ids[i]]);
+        if (!result[i]) {
+            // Clean up on error
+            for (size_t k = 0; k < i; k++) {
+                free(result[k]);
+            }
+            free(result);
+            mutex_unlock((mutex_t *)tracker->lock);
+            return NULL;
+        }
+    }
+    
+    *count = reverse->count;
+    
+    mutex_unlock((mutex_t *)tracker->lock);
+    
+    return result;
+}
+
+// Copy the dependencies recorded for a file in one tracker into another
+static int dependency_tracker_copy_file(xo_dependency_tracker_t *dest, const xo_dependency_tracker_t *src,
+                                        const char *filepath) {
+    uint32_t file_id;
+    if (!dependency_tracker_find_locked(src, filepath, &file_id)) {
+        return XO_SUCCESS;
+    }
+    
+    // The source tracker is read-only during a build, so only the destination is locked
+    const xo_dependency_list_t *forward = &src->forward[file_id];
+    int result = XO_SUCCESS;
+    
+    mutex_lock((mutex_t *)dest->lock);
+    for (size_t i = 0; i < forward->count && result == XO_SUCCESS; i++) {
+        result = dependency_tracker_add_locked(dest, filepath, src->paths[forward->ids[i]]);
+    }
+    mutex_unlock((mutex_t *)dest->lock);
+    
+    return result;
+}
+
+// Interned path paired with its ID, used to write the graph in path order
+typedef struct {
+    const char *path;
+    uint32_t id;
+} xo_dependency_sort_t;
+
+// qsort comparator ordering interned paths
+static int compare_dependency_paths(const void *a, const void *b) {
+    return strcmp(((const xo_dependency_sort_t *)a)->path, ((const xo_dependency_sort_t *)b)->path);
+}
+
+// Save the dependency graph. Paths are written once in sorted order ("p <path>"),
+// followed by one "d <file> <dependency>" line per edge using path numbers.
+int xo_dependency_tracker_save(const xo_dependency_tracker_t *tracker, const char *filepath) {
+    if (!tracker || !filepath) {
+        return XO_ERROR_MEMORY_ALLOCATION;
+    }
+    
+    char *dir = xo_utils_dirname(filepath);
+    if (!dir) {
+        return XO_ERROR_MEMORY_ALLOCATION;
+    }
+    
+    int mkdir_result = xo_utils_mkdir_p(dir);
+    free(dir);
+    if (mkdir_result != 0) {
+        return XO_ERROR_FILE_NOT_FOUND;
+    }
+    
+    mutex_lock((mutex_t *)tracker->lock);
+    
+    // Order IDs by path so the file is stable regardless of build order
+    xo_dependency_sort_t *order = malloc((tracker->count + 1) * sizeof(xo_dependency_sort_t));
+    uint32_t *rank = malloc((tracker->count + 1) * sizeof(uint32_t));
+    if (!order || !rank) {
+        mutex_unlock((mutex_t *)tracker->lock);
+        free(order);
+        free(rank);
+        return XO_ERROR_MEMORY_ALLOCATION;
+    }
+    
+    for (size_t i = 0; i < tracker->count; i++) {
+        order[i].path = tracker->paths[i];
+        order[i].id = (uint32_t)i;
+    }
+    
+    qsort(order, tracker->count, sizeof(xo_dependency_sort_t), compare_dependency_paths);
+    
+    for (size_t i = 0; i < tracker->count; i++) {
+        rank[order[i].id] = (uint32_t)i;
+    }
+    
+    char temp_path[XO_MAX_PATH];
+    snprintf(temp_path, sizeof(temp_path), "%s.tmp", filepath);
+    
+    FILE *file = fopen(temp_path, "wb");
+    if (!file) {
+        mutex_unlock((mutex_t *)tracker->lock);
+        free(order);
+        free(rank);
+        return XO_ERROR_FILE_NOT_FOUND;
+    }
+    
+    bool write_ok = fprintf(file, "xo-dependencies 1\n") > 0;
+    
+    for (size_t i = 0; i < tracker->count && write_ok; i++) {
+        write_ok = fprintf(file, "p %s\n", order[i].path) > 0;
+    }
+    
+    for (size_t i = 0; i < tracker->count && write_ok; i++) {
+        const xo_dependency_list_t *forward = &tracker->forward[order[i].id];
+        for (size_t j = 0; j < forward->count && write_ok; j++) {
+            write_ok = fprintf(file, "d %u %u\n", (unsigned)i, (unsigned)rank[forward->ids[j]]) > 0;
+        }
+    }
+    
+    mutex_unlock((mutex_t *)tracker->lock);
+    free(order);
+    free(rank);
+    
+    if (fclose(file) != 0 || !write_ok) {
+        remove(temp_path);
+        return XO_ERROR_FILE_NOT_FOUND;
+    }
+    
+    remove(filepath);
+    if (rename(temp_path, filepath) != 0) {
+        remove(temp_path);
+        return XO_ERROR_FILE_NOT_FOUND;
+    }
+    
+    return XO_SUCCESS;
+}
+
+// Load a dependency graph written by xo_dependency_tracker_save
+int xo_dependency_tracker_load(xo_dependency_tracker_t *tracker, const char *filepath) {
+    if (!tracker || !filepath) {
+        return XO_ERROR_MEMORY_ALLOCATION;
+    }
+    
+    char *content = xo_utils_read_file(filepath);
+    if (!content) {
+        return XO_ERROR_FILE_NOT_FOUND;
+    }
+    
+    const char *header = "xo-dependencies 1\n";
+    if (strncmp(content, header, strlen(header)) != 0) {
+        free(content);
+        return XO_ERROR_INVALID_FORMAT;
+    }
+    
+    mutex_lock((mutex_t *)tracker->lock);
+    
+    // Path numbers in the file map to IDs in this tracker
+    uint32_t *ids = NULL;
+    size_t id_count = 0;
+    size_t id_capacity = 0;
+    int result = XO_SUCCESS;
+    
+    char *line = content + strlen(header);
+    while (*line && result == XO_SUCCESS) {
+        char *line_end = strchr(line, '\n');
+        if (line_end) {
+            *line_end = '\0';
+        }
+        
+        if (line[0] == 'p' && line[1] == ' ') {
+            if (id_count >= id_capacity) {
+                size_t new_capacity = id_capacity == 0 ? 64 : id_capacity * 2;
+                uint32_t *new_ids = realloc(ids, new_capacity * sizeof(uint32_t));
+                if (!new_ids) {
+                    result = XO_ERROR_MEMORY_ALLOCATION;
+                    break;
+                }
+                ids = new_ids;
+                id_capacity = new_capacity;
+            }
+            
+            result = dependency_tracker_intern_locked(tracker, line + 2, &ids[id_count]);
+            id_count++;
+        } else if (line[0] == 'd' && line[1] == ' ') {
+            unsigned long file_number, dep_number;
+            if (sscanf(line + 2, "%lu %lu", &file_number, &dep_number) != 2 ||
+                file_number >= id_count || dep_number >= id_count) {
+                result = XO_ERROR_INVALID_FORMAT;
+                break;
+            }
+            
+            result = dependency_tracker_link_locked(tracker, ids[file_number], ids[dep_number]);
+        }
+        
+        if (!line_end) {
+            break;
+        }
+        line = line_end + 1;
+    }
+    
+    mutex_unlock((mutex_t *)tracker->lock);
+    free(ids);
+    free(content);
+    
+    return result;
+}
+
+// Get the content hash of a dependency file, memoized in file_hashes when given.
+// Missing files hash to zero so creating them invalidates the pages using them.
+static uint64_t dependency_file_hash(xo_build_cache_t *file_hashes, const char *path) {
+    if (file_hashes) {
+        char hex[XO_HASH_HEX_LEN + 1];
+        if (xo_build_cache_get(file_hashes, path, hex)) {
+            return strtoull(hex, NULL, 16);
+        }
+    }
+    
+    uint64_t hash = 0;
+    size_t length;
+    char *content = xo_utils_read_file_length(path, &length);
+    if (content) {
+        hash = xo_utils_hash64(content, length, 0);
+        free(content);
+    }
+    
+    if (file_hashes) {
+        char hex[XO_HASH_HEX_LEN + 1];
+        xo_utils_hash_to_hex(hash, hex);
+        xo_build_cache_add(file_hashes, path, hex);
+    }
+    
+    return hash;
+}
+
+// Compute the cache key of a page: its content hashed together with the content
+// of the layouts and partials the dependency graph records for it
+static int compute_page_key(const xo_dependency_tracker_t *dependencies, xo_build_cache_t *file_hashes,
+                            const char *filepath, char hash[XO_HASH_HEX_LEN + 1]) {
+    uint64_t seed = 0;
+    
+    // Copy the dependency paths out under the lock, the graph may be growing
+    const char **dep_paths = NULL;
+    size_t dep_count = 0;
+    
+    if (dependencies) {
+        mutex_lock((mutex_t *)dependencies->lock);
+        
+        uint32_t file_id;
+        if (dependency_tracker_find_locked(dependencies, filepath, &file_id)) {
+            const xo_dependency_list_t *forward = &dependencies->forward[file_id];
+            dep_paths = malloc((forward->count + 1) * sizeof(char *));
+            if (!dep_paths) {
+                mutex_unlock((mutex_t *)dependencies->lock);
+                return XO_ERROR_MEMORY_ALLOCATION;
+            }
+            
+            // Interned strings live as long as the tracker
+            for (size_t i = 0; i < forward->count; i++) {
+                dep_paths[dep_count++] = dependencies->paths[forward->ids[i]];
+            }
+        }
+        
+        mutex_unlock((mutex_t *)dependencies->lock);
+    }
+    
+    for (size_t i = 0; i < dep_count; i++) {
+        uint64_t dep_hash = dependency_file_hash(file_hashes, dep_paths[i]);
+        
+        // Fold in the dependency path too, so switching layouts changes the key.
+        // Addition keeps the key independent of the order dependencies were recorded in.
+        seed += xo_utils_hash64(dep_paths[i], strlen(dep_paths[i]), dep_hash);
+    }
+    
+    free(dep_paths);
+    
+    size_t length;
+    char *content = xo_utils_read_file_length(filepath, &length);
+    if (!content) {
+        return XO_ERROR_FILE_NOT_FOUND;
+    }
+    
+    xo_utils_hash_to_hex(xo_utils_hash64(content, length, seed), hash);
+    free(content);
+    
+    return XO_SUCCESS;
+}
+
+// Whether the graph records the content directory as a dependency of a file.
+// It stands for the site's page list, whose hash is only known to a build
+// that collected the list. It is the only directory the graph records, so
+// its ID is compared with the file's dependencies.
+static bool depends_on_content_dir(const xo_dependency_tracker_t *dependencies, const char *content_dir,
+                                   const char *filepath) {
+    if (!dependencies || !content_dir) {
+        return false;
+    }
+    
+    bool found = false;
+    mutex_lock((mutex_t *)dependencies->lock);
+    
+    uint32_t dir_id;
+    uint32_t file_id;
+    if (dependency_tracker_find_locked(dependencies, content_dir, &dir_id) &&
+        dependency_tracker_find_locked(dependencies, filepath, &file_id)) {
+        const xo_dependency_list_t *forward = &dependencies->forward[file_id];
+        for (size_t i = 0; i < forward->count && !found; i++) {
+            found = forward->ids[i] == dir_id;
+        }
+    }
+    
+    mutex_unlock((mutex_t *)dependencies->lock);
+    
+    return found;
+}
+
+// Check if a file needs to be rebuilt. Pages listing the site's pages depend
+// on the content directory, which can't be hashed without collecting every
+// page, so they are always rebuilt.
+bool xo_should_rebuild(const xo_build_cache_t *cache, const xo_dependency_tracker_t *dependencies,
+                       const char *content_dir, const char *filepath) {
+    if (!cache || !filepath || depends_on_content_dir(dependencies, content_dir, filepath)) {
+        return true;
+    }
+    
+    // Get the current hash
+    char current_hash[XO_HASH_HEX_LEN + 1];
+    if (compute_page_key(dependencies, NULL, filepath, current_hash) != XO_SUCCESS) {
+        return true;
+    }
+    
+    // Get the cached hash
+    char cached_hash[XO_HASH_HEX_LEN + 1];
+    if (!xo_build_cache_get(cache, filepath, cached_hash)) {
+        return true;
+    }
+    
+    // Compare the hashes
+    return strcmp(current_hash, cached_hash) != 0;
+}
+
+// Bytes a finished job's arena may keep for reuse, larger arenas are released
+#define XO_BUILD_ARENA_KEEP (1024 * 1024)
+
+// A page moving through the build pipeline
+typedef struct xo_build_job {
+    struct xo_build_job *next;    // Link in the list of reusable jobs
+    char *filepath;
+    xo_markdown_t md;
+    char *html;                   // Rendered output
+    size_t charge;                // Bytes counted against the in-flight budget
+    xo_arena_t arena;             // Every allocation made for the page
+    uint64_t stage_ns[XO_PROFILE_STAGE_COUNT];  // Time spent in each stage when profiling
+} xo_build_job_t;
+
+static void build_job_destroy(xo_build_job_t *job) {
+    xo_arena_free(&job->arena);
+    free(job);
+}
+
+// Resources shared by every page of a build
+typedef struct {
+    const xo_config_t *config;
+    xo_dependency_tracker_t *tracker;
+    xo_build_cache_t *cache;                  // Optional, enables skipping unchanged pages
+    const xo_dependency_tracker_t *previous;  // Graph from the previous build, read-only
+    xo_build_cache_t file_hashes;             // Memoized hashes of dependency files
+    xo_layout_cache_t *layouts;               // Compiled layouts, the dev server's or own_layouts
+    xo_layout_cache_t own_layouts;
+    const xo_template_partials_t *partials;   // Partial registry, the dev server's or own_partials
+    xo_template_partials_t own_partials;
+    xo_markdown_cache_t *markdown_cache;      // Block ASTs kept by the dev server, NULL outside dev mode
+    xo_highlight_cache_t *highlights;         // Highlighted code, the dev server's or own_highlights
+    xo_highlight_cache_t own_highlights;
+    xo_arena_t site_arena;                    // Site-wide template data, lives as long as the build
+    xo_template_list_t pages;                 // Every page's frontmatter and url, shared by all page contexts
+    bool pages_collected;                     // pages is collected when a page first needs it
+    mutex_t pages_lock;
+    size_t discovered_count;
+    size_t built_count;
+    size_t skipped_count;
+    size_t failed_count;
+    size_t writes_skipped;                    // Outputs left untouched because their bytes matched
+    xo_profile_t *profile;                    // Stage timings of built pages, NULL when not profiling
+    size_t inflight_bytes;                    // Page data held by jobs in the pipeline
+    size_t max_inflight_bytes;                // Budget for inflight_bytes, 0 for unlimited
+    xo_build_job_t *free_jobs;                // Finished jobs kept with their arenas for reuse
+    mutex_t lock;                             // Guards the counters, the in-flight budget and free_jobs
+    cond_t inflight_released;
+} xo_build_context_t;
+
+static void get_output_path(const xo_config_t *config, const char *filepath, char output_path[XO_MAX_PATH]);
+static bool is_markdown_page(const char *filepath);
+
+// Paths of the pages found while collecting the site's pages
+typedef struct {
+    char **paths;
+    size_t count;
+    size_t capacity;
+} xo_site_paths_t;
+
+// Directory traversal callback, gathers the paths of markdown pages
+static int collect_page_path_callback(const char *filepath, void *user_data) {
+    xo_site_paths_t *found = (xo_site_paths_t *)user_data;
+    
+    if (!is_markdown_page(filepath)) {
+        return XO_SUCCESS;
+    }
+    
+    if (found->count >= found->capacity) {
+        size_t new_capacity = found->capacity == 0 ? 8 : found->capacity * 2;
+        char **new_paths = realloc(found->paths, new_capacity * sizeof(char *));
+        if (!new_paths) {
+            return XO_ERROR_MEMORY_ALLOCATION;
+        }
+        found->paths = new_paths;
+        found->capacity = new_capacity;
+    }
+    
+    found->paths[found->count] = strdup(filepath);
+    if (!found->paths[found->count]) {
+        return XO_ERROR_MEMORY_ALLOCATION;
+    }
+    found->count++;
+    
+    return XO_SUCCESS;
+}
+
+static int compare_paths(const void *a, const void *b) {
+    return strcmp(*(const char *const *)a, *(const char *const *)b);
+}
+
+// Hash of what the site's page list shows of a page, its path and frontmatter
+static uint64_t page_listing_hash(const char *filepath, const xo_markdown_t *md) {
+    uint64_t hash = xo_utils_hash64(filepath, strlen(filepath), 0);
+    for (size_t i = 0; i < md->frontmatter.count; i++) {
+        const xo_frontmatter_item_t *item = &md->frontmatter.items[i];
+        hash = xo_utils_hash64(item->key.data, item->key.length, hash);
+        hash = xo_utils_hash64(item->value.data, item->value.length, hash);
+    }
+    
+    return hash;
+}
+
+// Add a page to the site's page list as a map of its frontmatter and url,
+// folding its listing hash into the hash of the list
+static int collect_page(xo_build_context_t *ctx, xo_arena_t *scratch, const char *filepath, uint64_t *hash) {
+    xo_markdown_t md;
+    if (xo_markdown_parse_frontmatter_file(filepath, scratch, &md) != XO_SUCCESS) {
+        return XO_ERROR_FILE_NOT_FOUND;
+    }
+    
+    uint64_t page_hash = page_listing_hash(filepath, &md);
+    *hash = xo_utils_hash64(&page_hash, sizeof(page_hash), *hash);
+    
+    // The dev server compares saved pages against these to skip rebuilding the listing pages
+    if (ctx->config->frontmatter_hashes) {
+        char hex[XO_HASH_HEX_LEN + 1];
+        xo_utils_hash_to_hex(page_hash, hex);
+        xo_build_cache_add((xo_build_cache_t *)ctx->config->frontmatter_hashes, filepath, hex);
+    }
+    
+    xo_template_context_t *page = xo_arena_alloc(&ctx->site_arena, sizeof(xo_template_context_t));
+    if (!page) {
+        return XO_ERROR_MEMORY_ALLOCATION;
+    }
+    xo_template_context_init_arena(page, &ctx->site_arena);
+    
+    for (size_t i = 0; i < md.frontmatter.count; i++) {
+        const xo_frontmatter_item_t *item = &md.frontmatter.items[i];
+        if (xo_template_context_add_string_n(page, item->key.data, item->key.length, item->value.data,
+                                             item->value.length) != XO_SUCCESS) {
+            return XO_ERROR_MEMORY_ALLOCATION;
+        }
+    }
+    
+    // The url is the output directory of the page, which holds its index.html
+    char output_path[XO_MAX_PATH];
+    get_output_path(ctx->config, filepath, output_path);
+    size_t output_dir_len = strlen(ctx->config->output_dir);
+    size_t url_len = strlen(output_path) - output_dir_len - strlen("index.html");
+    
+    char *url = xo_arena_strndup(&ctx->site_arena, output_path + output_dir_len, url_len);
+    if (!url || xo_template_context_add_string(page, "url", url) != XO_SUCCESS ||
+        xo_template_list_add_map(&ctx->pages, page) != XO_SUCCESS) {
+        return XO_ERROR_MEMORY_ALLOCATION;
+    }
+    
+    return XO_SUCCESS;
+}
+
+// Collect the frontmatter of every page into the site's page list. Only the
+// frontmatter is read. Pages are listed in path order.
+// Templates using the list depend on the content directory, whose hash is
+// the hash of the list, so they rebuild when any page's frontmatter changes.
+static void collect_site_pages(xo_build_context_t *ctx) {
+    xo_site_paths_t found = { NULL, 0, 0 };
+    xo_utils_traverse_directory(ctx->config->content_dir, collect_page_path_callback, &found);
+    
+    qsort(found.paths, found.count, sizeof(char *), compare_paths);
+    
+    // Each page's source is only needed until it is copied into its map
+    xo_arena_t scratch;
+    xo_arena_init(&scratch, 0);
+    
+    uint64_t hash = 0;
+    for (size_t i = 0; i < found.count; i++) {
+        if (collect_page(ctx, &scratch, found.paths[i], &hash) == XO_ERROR_MEMORY_ALLOCATION) {
+            xo_utils_console_warning("Failed to collect page: %s", found.paths[i]);
+        }
+        xo_arena_reset(&scratch);
+        free(found.paths[i]);
+    }
+    
+    xo_arena_free(&scratch);
+    free(found.paths);
+    
+    char hex[XO_HASH_HEX_LEN + 1];
+    xo_utils_hash_to_hex(hash, hex);
+    xo_build_cache_add(&ctx->file_hashes, ctx->config->content_dir, hex);
+}
+
+// Whether a saved page's frontmatter differs from when the site's pages were
+// last collected, recording the new hash. Without recorded hashes every save
+// counts as a change.
+bool xo_build_frontmatter_changed(const xo_config_t *config, const char *filepath) {
+    if (!config || !filepath || !config->frontmatter_hashes) {
+        return true;
+    }
+    
+    xo_arena_t scratch;
+    xo_arena_init(&scratch, 0);
+    
+    xo_markdown_t md;
+    if (xo_markdown_parse_frontmatter_file(filepath, &scratch, &md) != XO_SUCCESS) {
+        xo_arena_free(&scratch);
+        return true;
+    }
+    
+    char hex[XO_HASH_HEX_LEN + 1];
+    xo_utils_hash_to_hex(page_listing_hash(filepath, &md), hex);
+    xo_arena_free(&scratch);
+    
+    xo_build_cache_t *hashes = (xo_build_cache_t *)config->frontmatter_hashes;
+    char recorded[XO_HASH_HEX_LEN + 1];
+    bool changed = !xo_build_cache_get(hashes, filepath, recorded) || strcmp(recorded, hex) != 0;
+    if (changed) {
+        xo_build_cache_add(hashes, filepath, hex);
+    }
+    
+    return changed;
+}
+
+// The site's page list, collected once per build when a page first needs it
+static const xo_template_list_t *site_pages(xo_build_context_t *ctx) {
+    mutex_lock(&ctx->pages_lock);
+    if (!ctx->pages_collected) {
+        collect_site_pages(ctx);
+        ctx->pages_collected = true;
+    }
+    mutex_unlock(&ctx->pages_lock);
+    
+    return &ctx->pages;
+}
+
+static int build_context_init(xo_build_context_t *ctx, const xo_config_t *config, xo_dependency_tracker_t *tracker,
+                              xo_build_cache_t *cache, const xo_dependency_tracker_t *previous) {
+    ctx->config = config;
+    ctx->tracker = tracker;
+    ctx->cache = cache;
+    ctx->previous = previous;
+    ctx->discovered_count = 0;
+    ctx->built_count = 0;
+    ctx->skipped_count = 0;
+    ctx->failed_count = 0;
+    ctx->writes_skipped = 0;
+    ctx->profile = NULL;
+    ctx->inflight_bytes = 0;
+    ctx->max_inflight_bytes = config->max_inflight_mb > 0 ? (size_t)config->max_inflight_mb * 1024 * 1024 : 0;
+    ctx->free_jobs = NULL;
+    
+    if (xo_build_cache_init(&ctx->file_hashes) != XO_SUCCESS) {
+        return XO_ERROR_MEMORY_ALLOCATION;
+    }
+    
+    // Builds in the dev server share its layout cache across rebuilds
+    ctx->layouts = config->layout_cache ? (xo_layout_cache_t *)config->layout_cache : &ctx->own_layouts;
+    if (xo_layout_cache_init(&ctx->own_layouts) != XO_SUCCESS) {
+        xo_build_cache_free(&ctx->file_hashes);
+        return XO_ERROR_MEMORY_ALLOCATION;
+    }
+    xo_layout_cache_begin_build(ctx->layouts);
+    
+    // Partials are loaded once per build unless the dev server keeps them loaded
+    xo_template_partials_init(&ctx->own_partials);
+    if (config->partials) {
+        ctx->partials = (const xo_template_partials_t *)config->partials;
+    } else {
+        char partials_dir[XO_MAX_PATH];
+        snprintf(partials_dir, sizeof(partials_dir), "%s/%s", config->content_dir, XO_PARTIALS_DIR);
+        xo_template_partials_load_dir(&ctx->own_partials, partials_dir);
+        ctx->partials = &ctx->own_partials;
+    }
+    
+    ctx->markdown_cache = (xo_markdown_cache_t *)config->markdown_cache;
+    
+    // Highlighted code is kept across builds in the cache directory, the dev
+    // server keeps its cache loaded. Snippets only depend on their language
+    // and code, so even clean builds reuse them.
+    xo_highlight_cache_init(&ctx->own_highlights);
+    if (config->highlight_cache) {
+        ctx->highlights = (xo_highlight_cache_t *)config->highlight_cache;
+    } else {
+        char highlight_path[XO_MAX_PATH];
+        snprintf(highlight_path, sizeof(highlight_path), "%s/%s", config->cache_dir, XO_HIGHLIGHT_CACHE_FILE);
+        if (xo_utils_file_exists(highlight_path) &&
+            xo_highlight_cache_load(&ctx->own_highlights, highlight_path) != XO_SUCCESS) {
+            xo_highlight_cache_free(&ctx->own_highlights);
+            xo_highlight_cache_init(&ctx->own_highlights);
+        }
+        ctx->highlights = &ctx->own_highlights;
+    }
+    
+    xo_arena_init(&ctx->site_arena, 0);
+    xo_template_list_init(&ctx->pages, &ctx->site_arena);
+    ctx->pages_collected = false;
+    
+    mutex_init(&ctx->lock);
+    mutex_init(&ctx->pages_lock);
+    cond_init(&ctx->inflight_released);
+    
+    // Keys of pages that listed the site's pages last time hash the list, so
+    // it is needed before checking which pages are unchanged
+    if (previous) {
+        uint32_t id;
+        mutex_lock((mutex_t *)previous->lock);
+        bool listed = dependency_tracker_find_locked(previous, config->content_dir, &id);
+        mutex_unlock((mutex_t *)previous->lock);
+        
+        if (listed) {
+            site_pages(ctx);
+        }
+    }
+    
+    return XO_SUCCESS;
+}
+
+static void build_context_free(xo_build_context_t *ctx) {
+    while (ctx->free_jobs) {
+        xo_build_job_t *job = ctx->free_jobs;
+        ctx->free_jobs = job->next;
+        build_job_destroy(job);
+    }
+    
+    xo_build_cache_free(&ctx->file_hashes);
+    xo_layout_cache_free(&ctx->own_layouts);
+    
+    // Shared layouts must not keep bindings to partials freed with this build
+    if (ctx->layouts != &ctx->own_layouts && ctx->partials == &ctx->own_partials) {
+        xo_layout_cache_drop_bindings(ctx->layouts);
+    }
+    xo_template_partials_free(&ctx->own_partials);
+    
+    // A clean build converted every page, so snippets it did not use are stale
+    if (ctx->highlights == &ctx->own_highlights) {
+        char highlight_path[XO_MAX_PATH];
+        snprintf(highlight_path, sizeof(highlight_path), "%s/%s", ctx->config->cache_dir, XO_HIGHLIGHT_CACHE_FILE);
+        xo_highlight_cache_save(&ctx->own_highlights, highlight_path, ctx->config->clean_build);
+    }
+    xo_highlight_cache_free(&ctx->own_highlights);
+    xo_arena_free(&ctx->site_arena);
+    cond_destroy(&ctx->inflight_released);
+    mutex_destroy(&ctx->pages_lock);
+    mutex_destroy(&ctx->lock);
+}
+
+// Determine the output path of a markdown page
+static void get_output_path(const xo_config_t *config, const char *filepath, char output_path[XO_MAX_PATH]) {
+    // Calculate the relative path from content directory
+    const char *rel_start = filepath;
+    size_t content_dir_len = strlen(config->content_dir);
+    if (strncmp(filepath, config->content_dir, content_dir_len) == 0) {
+        rel_start = filepath + content_dir_len;
+        // Skip leading slash if present
+        if (*rel_start == '/' || *rel_start == '\\') {
+            rel_start++;
+        }
+    }
+    
+    // Work on a copy, the source path may be shared with other build workers
+    char rel_path[XO_MAX_PATH];
+    snprintf(rel_path, sizeof(rel_path), "%s", rel_start);
+    
+    // Replace .md extension with /index.html
+    char *ext = strrchr(rel_path, '.');
+    if (ext && strcmp(ext, ".md") == 0) {
+        *ext = '\0'; // Terminate before the extension
+    }
+    
+    // Special case for index.md files
+    if (strcmp(rel_path, "index") == 0) {
+        snprintf(output_path, XO_MAX_PATH, "%s/index.html", config->output_dir);
+    } else {
+        snprintf(output_path, XO_MAX_PATH, "%s/%s/index.html", config->output_dir, rel_path);
+    }
+}
+
+// Check whether an existing output file already holds exactly these bytes.
+// The output hash recorded by the previous build avoids reading the file back;
+// without one the file is compared byte for byte.
+static bool output_is_unchanged(xo_build_context_t *ctx, const char *output_path, const char *content,
+                                size_t length, const char *content_hash) {
+    struct stat st;
+    if (stat(output_path, &st) != 0 || (size_t)st.st_size != length) {
+        return false;
+    }
+    
+    char cached_hash[XO_HASH_HEX_LEN + 1];
+    if (ctx->cache && xo_build_cache_get(ctx->cache, output_path, cached_hash)) {
+        return strcmp(cached_hash, content_hash) == 0;
+    }
+    
+    char *existing = xo_utils_read_file(output_path);
+    if (!existing) {
+        return false;
+    }
+    
+    bool unchanged = memcmp(existing, content, length) == 0;
+    free(existing);
+    
+    return unchanged;
+}
+
+// Write a rendered page unless the file on disk already has the same bytes,
+// so unchanged outputs keep their mtime and are not re-synced downstream
+static int write_output_file(xo_build_context_t *ctx, xo_build_job_t *job, const char *output_path) {
+    const char *content = job->html;
+    size_t length = strlen(content);
+    char content_hash[XO_HASH_HEX_LEN + 1];
+    xo_utils_hash_to_hex(xo_utils_hash64(content, length, 0), content_hash);
+    
+    if (!ctx->config->always_write && output_is_unchanged(ctx, output_path, content, length, content_hash)) {
+        mutex_lock(&ctx->lock);
+        ctx->writes_skipped++;
+        mutex_unlock(&ctx->lock);
+    } else {
+        // Create directory structure
+        uint64_t start = ctx->profile ? xo_utils_time_ns() : 0;
+        char *output_dir = xo_utils_dirname(output_path);
+        if (!output_dir) {
+            xo_utils_console_error("Failed to get output directory");
+            return XO_ERROR_MEMORY_ALLOCATION;
+        }
+        
+        if (xo_utils_mkdir_p(output_dir) != 0) {
+            xo_utils_console_error("Failed to create output directory: %s", output_dir);
+            free(output_dir);
+            return XO_ERROR_MEMORY_ALLOCATION;
+        }
+        
+        free(output_dir);
+        
+        if (ctx->profile) {
+            uint64_t now = xo_utils_time_ns();
+            job->stage_ns[XO_PROFILE_MKDIR] += now - start;
+            start = now;
+        }
+        
+        // Write the output file
+        if (xo_utils_write_file(output_path, content) != 0) {
+            xo_utils_console_error("Failed to write output file: %s", output_path);
+            return XO_ERROR_MEMORY_ALLOCATION;
+        }
+        
+        if (ctx->profile) {
+            job->stage_ns[XO_PROFILE_WRITE] += xo_utils_time_ns() - start;
+        }
+    }
+    
+    // Remember the output hash so the next build can compare without reading the file
+    if (ctx->cache) {
+        xo_build_cache_add(ctx->cache, output_path, content_hash);
+    }
+    
+    return XO_SUCCESS;
+}
+
+// Start a job for a page, reusing a finished job and its arena when there is one
+static xo_build_job_t *build_job_create(xo_build_context_t *build, const char *filepath) {
+    mutex_lock(&build->lock);
+    xo_build_job_t *job = build->free_jobs;
+    if (job) {
+        build->free_jobs = job->next;
+    }
+    mutex_unlock(&build->lock);
+    
+    if (!job) {
+        job = malloc(sizeof(xo_build_job_t));
+        if (!job) {
+            return NULL;
+        }
+        xo_arena_init(&job->arena, 0);
+    }
+    
+    job->next = NULL;
+    job->html = NULL;
+    job->charge = 0;
+    memset(job->stage_ns, 0, sizeof(job->stage_ns));
+    xo_markdown_init(&job->md);
+    
+    job->filepath = xo_arena_strdup(&job->arena, filepath);
+    if (!job->filepath) {
+        build_job_destroy(job);
+        return NULL;
+    }
+    
+    return job;
+}
+
+// Change the number of bytes a job holds against the in-flight budget
+static void build_job_charge(xo_build_context_t *build, xo_build_job_t *job, size_t bytes) {
+    if (bytes == job->charge) {
+        return;
+    }
+    
+    mutex_lock(&build->lock);
+    build->inflight_bytes = build->inflight_bytes - job->charge + bytes;
+    if (bytes < job->charge) {
+        cond_broadcast(&build->inflight_released);
+    }
+    mutex_unlock(&build->lock);
+    
+    job->charge = bytes;
+}
+
+// Wait until a job of the given size fits in the in-flight budget. A page
+// larger than the whole budget still goes through once nothing else is in flight.
+static void build_job_reserve(xo_build_context_t *build, xo_build_job_t *job, size_t bytes) {
+    mutex_lock(&build->lock);
+    
+    while (build->max_inflight_bytes > 0 && build->inflight_bytes > 0 &&
+           build->inflight_bytes + bytes > build->max_inflight_bytes) {
+        cond_wait(&build->inflight_released, &build->lock);
+    }
+    
+    build->inflight_bytes += bytes;
+    job->charge = bytes;
+    
+    mutex_unlock(&build->lock);
+}
+
+// Finish a job, releasing everything allocated for its page in one go
+static void build_job_release(xo_build_context_t *build, xo_build_job_t *job) {
+    build_job_charge(build, job, 0);
+    xo_markdown_free(&job->md);
+    
+    // Don't let one huge page pin its memory for the rest of the build
+    if (xo_arena_used(&job->arena) > XO_BUILD_ARENA_KEEP) {
+        xo_arena_free(&job->arena);
+    } else {
+        xo_arena_reset(&job->arena);
+    }
+    
+    mutex_lock(&build->lock);
+    job->next = build->free_jobs;
+    build->free_jobs = job;
+    mutex_unlock(&build->lock);
+}
+
+// Add the time since start to one of a job's stages when profiling
+static void job_time_stage(xo_build_context_t *build, xo_build_job_t *job, xo_profile_stage_t stage, uint64_t start) {
+    if (build->profile) {
+        job->stage_ns[stage] += xo_utils_time_ns() - start;
+    }
+}
+
+// Hand a built page's stage timings to the profile
+static void job_profile_page(xo_build_context_t *build, xo_build_job_t *job) {
+    if (build->profile) {
+        xo_profile_add_page(build->profile, job->filepath, job->stage_ns);
+    }
+}
+
+// Read stage: load and parse the page source
+static int read_page(xo_build_context_t *build, xo_build_job_t *job) {
+    xo_utils_console_info("Building file: %s", job->filepath);
+    
+    // The dev server rebuilds pages while they are being saved, which would
+    // truncate a mapped source under the parser
+    uint64_t start = build->profile ? xo_utils_time_ns() : 0;
+    int parsed = build->markdown_cache ? xo_markdown_parse_file_unmapped(job->filepath, &job->arena, &job->md) :
+                                         xo_markdown_parse_file_arena(job->filepath, &job->arena, &job->md);
+    if (parsed != XO_SUCCESS) {
+        xo_utils_console_error("Failed to parse markdown file: %s", job->filepath);
+        return XO_ERROR_FILE_NOT_FOUND;
+    }
+    job_time_stage(build, job, XO_PROFILE_PARSE, start);
+    
+    return XO_SUCCESS;
+}
+
+// Record the partial files a template uses, including partials used by those
+// partials, and the content directory when it lists the site's pages. Both
+// come from the names collected when the template was compiled.
+// Returns whether it or its partials list the site's pages.
+static bool record_template_dependencies(xo_build_context_t *build, const char *filepath, const xo_template_t *tpl,
+                                         int depth) {
+    if (!tpl || depth >= XO_TEMPLATE_MAX_PARTIAL_DEPTH) {
+        return false;
+    }
+    
+    bool lists_pages = xo_template_uses_var(tpl, XO_SITE_PAGES_KEY);
+    if (lists_pages) {
+        xo_dependency_tracker_add(build->tracker, filepath, build->config->content_dir);
+    }
+    
+    for (size_t i = 0; i < tpl->partial_count; i++) {
+        const char *name = tpl->source + tpl->partials[i].offset;
+        size_t name_len = tpl->partials[i].length;
+        const xo_template_t *partial = xo_template_partials_get_template(build->partials, name, name_len);
+        const char *path = xo_template_partials_get_path(build->partials, name, name_len);
+        
+        if (path) {
+            xo_dependency_tracker_add(build->tracker, filepath, path);
+        } else if (!partial) {
+            // A missing partial renders nothing. The file that would add it hashes
+            // to 0 until it exists, so creating it changes the page's key.
+            char missing[XO_MAX_PATH];
+            snprintf(missing, sizeof(missing), "%s/%s/%.*s.md", build->config->content_dir, XO_PARTIALS_DIR,
+                     (int)name_len, name);
+            xo_dependency_tracker_add(build->tracker, filepath, missing);
+        }
+        
+        lists_pages |= record_template_dependencies(build, filepath, partial, depth + 1);
+    }
+    
+    return lists_pages;
+}
+
+// Whether text of the given length contains a template tag
+static bool has_template_tag(const char *text, size_t length) {
+    const char *end = text + length;
+    for (const char *p = text; (p = xo_scan_byte(p, end, '{')) < end - 1; p++) {
+        if (p[1] == '{') {
+            return true;
+        }
+    }
+    
+    return false;
+}
+
+// Render stage: convert the markdown and render it into its layout
+static int render_page(xo_build_context_t *build, xo_build_job_t *job) {
+    const xo_config_t *config = build->config;
+    xo_markdown_t *md = &job->md;
+    
+    // The page records its dependencies again below, replacing those of its last build
+    xo_dependency_tracker_remove(build->tracker, job->filepath);
+    
+    // Get the layout
+    static const xo_span_t default_layout = { "default", 7 };
+    const xo_span_t *layout_name = xo_markdown_get_frontmatter(md, "layout");
+    if (!layout_name) {
+        layout_name = &default_layout;
+    }
+    
+    char layout_path[XO_MAX_PATH];
+    snprintf(layout_path, sizeof(layout_path), "%s/%.*s.html", config->layouts_dir, (int)layout_name->length,
+             layout_name->data);
+    
+    // Add layout as a dependency
+    xo_dependency_tracker_add(build->tracker, job->filepath, layout_path);
+    
+    uint64_t start = build->profile ? xo_utils_time_ns() : 0;
+    
+    // Create template context, everything below is allocated from the job's arena
+    xo_template_context_t ctx;
+    xo_template_context_init_arena(&ctx, &job->arena);
+    
+    // Add frontmatter values to context
+    for (size_t i = 0; i < md->frontmatter.count; i++) {
+        const xo_frontmatter_item_t *item = &md->frontmatter.items[i];
+        xo_template_context_add_string_n(&ctx, item->key.data, item->key.length, item->value.data, item->value.length);
+    }
+    
+    // Add other useful values
+    xo_template_context_add_string(&ctx, "baseUrl", "/");  // Default base URL
+    
+    // The body may use partials and frontmatter values, resolve them before converting
+    if (md->content.data && has_template_tag(md->content.data, md->content.length)) {
+        xo_template_t body_tpl;
+        if (xo_template_compile(md->content.data, md->content.length, &body_tpl) != XO_SUCCESS) {
+            xo_utils_console_error("Failed to render page body: %s", job->filepath);
+            return XO_ERROR_INVALID_FORMAT;
+        }
+        
+        // The site's pages are shared by every page listing them, not copied into each context
+        if (record_template_dependencies(build, job->filepath, &body_tpl, 0)) {
+            xo_template_context_add_list(&ctx, XO_SITE_PAGES_KEY, site_pages(build));
+        }
+        
+        char *body;
+        int rendered = xo_template_render_compiled(&body_tpl, &ctx, build->partials, &body);
+        xo_template_free(&body_tpl);
+        if (rendered != XO_SUCCESS) {
+            xo_utils_console_error("Failed to render page body: %s", job->filepath);
+            return XO_ERROR_INVALID_FORMAT;
+        }
+        md->content.data = body;
+        md->content.length = strlen(body);
+    }
+    
+    job_time_stage(build, job, XO_PROFILE_RENDER, start);
+    start = build->profile ? xo_utils_time_ns() : 0;
+    
+    // Convert markdown to HTML, in dev mode only the blocks changed since the last rebuild
+    md->highlights = build->highlights;
+    char *html_content;
+    int converted;
+    if (build->markdown_cache) {
+        converted = xo_markdown_cache_to_html(build->markdown_cache, job->filepath, md, &html_content);
+    } else {
+        converted = xo_markdown_to_html(md, &html_content);
+    }
+    if (converted != XO_SUCCESS) {
+        xo_utils_console_error("Failed to convert markdown to HTML: %s", job->filepath);
+        return XO_ERROR_INVALID_FORMAT;
+    }
+    
+    job_time_stage(build, job, XO_PROFILE_TO_HTML, start);
+    start = build->profile ? xo_utils_time_ns() : 0;
+    
+    // Add content to context
+    xo_template_context_add_string(&ctx, "content", html_content);
+    
+    // Render the page into its compiled layout
+    const xo_template_t *layout = xo_layout_cache_get(build->layouts, layout_path);
+    if (!layout) {
+        xo_utils_console_error("Failed to load layout: %s", layout_path);
+        return XO_ERROR_FILE_NOT_FOUND;
+    }
+    
+    if (record_template_dependencies(build, job->filepath, layout, 0)) {
+        xo_template_context_add_list(&ctx, XO_SITE_PAGES_KEY, site_pages(build));
+    }
+    
+    // Pages of one frontmatter shape share the layout's binding, a variable is read by slot index
+    const xo_template_binding_t *binding = xo_layout_cache_bind(build->layouts, layout, &ctx, build->partials);
+    int rendered = binding ? xo_template_render_bound(layout, binding, &ctx, build->partials, &job->html) :
+                             xo_template_render_compiled(layout, &ctx, build->partials, &job->html);
+    if (rendered != XO_SUCCESS) {
+        xo_utils_console_error("Failed to render template: %s", layout_path);
+        return XO_ERROR_INVALID_FORMAT;
+    }
+    
+    job_time_stage(build, job, XO_PROFILE_RENDER, start);
+    
+    return XO_SUCCESS;
+}
+
+// Write stage: write the rendered page to the output directory
+static int write_page(xo_build_context_t *build, xo_build_job_t *job) {
+    char output_path[XO_MAX_PATH];
+    get_output_path(build->config, job->filepath, output_path);
+    
+    if (write_output_file(build, job, output_path) != XO_SUCCESS) {
+        return XO_ERROR_MEMORY_ALLOCATION;
+    }
+    
+    xo_utils_console_success("Built: %s -> %s", job->filepath, output_path);
+    
+    return XO_SUCCESS;
+}
+
+// Build a single markdown file with the shared build resources, running the
+// pipeline stages back to back
+static int build_page(xo_build_context_t *build, const char *filepath) {
+    xo_build_job_t *job = build_job_create(build, filepath);
+    if (!job) {
+        return XO_ERROR_MEMORY_ALLOCATION;
+    }
+    
+    int result = read_page(build, job);
+    if (result == XO_SUCCESS) {
+        result = render_page(build, job);
+    }
+    if (result == XO_SUCCESS) {
+        result = write_page(build, job);
+    }
+    if (result == XO_SUCCESS) {
+        job_profile_page(build, job);
+    }
+    
+    build_job_release(build, job);
+    
+    return result;
+}
+
+// Outcome of a page in the build, PENDING while it is still moving through the stages
+typedef enum {
+    XO_BUILD_STATUS_PENDING,
+    XO_BUILD_STATUS_BUILT,
+    XO_BUILD_STATUS_SKIPPED,
+    XO_BUILD_STATUS_FAILED
+} xo_build_status_t;
+
+static void count_page(xo_build_context_t *build, xo_build_status_t status) {
+    mutex_lock(&build->lock);
+    if (status == XO_BUILD_STATUS_BUILT) {
+        build->built_count++;
+    } else if (status == XO_BUILD_STATUS_SKIPPED) {
+        build->skipped_count++;
+    } else {
+        build->failed_count++;
+    }
+    mutex_unlock(&build->lock);
+}
+
+// Check whether the cache shows a page's inputs are unchanged since the last
+// build. An unchanged page carries its dependencies into the new graph.
+static bool page_is_unchanged(xo_build_context_t *build, const char *filepath) {
+    char page_key[XO_HASH_HEX_LEN + 1];
+    
+    // Without a previous graph the pages were picked to be rebuilt
+    if (!build->cache || !build->previous ||
+        compute_page_key(build->previous, &build->file_hashes, filepath, page_key) != XO_SUCCESS) {
+        return false;
+    }
+    
+    char cached_key[XO_HASH_HEX_LEN + 1];
+    if (!xo_build_cache_get(build->cache, filepath, cached_key) || strcmp(cached_key, page_key) != 0) {
+        return false;
+    }
+    
+    // Only skip when the previous output is still in place
+    char output_path[XO_MAX_PATH];
+    get_output_path(build->config, filepath, output_path);
+    if (!xo_utils_file_exists(output_path)) {
+        return false;
+    }
+    
+    // Carry the page's dependencies and output hash over into the new build
+    if (build->previous) {
+        dependency_tracker_copy_file(build->tracker, build->previous, filepath);
+    }
+    xo_build_cache_touch(build->cache, output_path);
+    
+    return true;
+}
+
+// Key a freshly built page by the dependencies it used in this build
+static void record_page_key(xo_build_context_t *build, const char *filepath) {
+    char page_key[XO_HASH_HEX_LEN + 1];
+    
+    if (build->cache && compute_page_key(build->tracker, &build->file_hashes, filepath, page_key) == XO_SUCCESS) {
+        xo_build_cache_add(build->cache, filepath, page_key);
+    }
+}
+
+// Build a page unless the cache shows its inputs are unchanged
+static xo_build_status_t build_cached_file(xo_build_context_t *build, const char *filepath) {
+    if (page_is_unchanged(build, filepath)) {
+        return XO_BUILD_STATUS_SKIPPED;
+    }
+    
+    if (build_page(build, filepath) != XO_SUCCESS) {
+        return XO_BUILD_STATUS_FAILED;
+    }
+    
+    record_page_key(build, filepath);
+    
+    return XO_BUILD_STATUS_BUILT;
+}
+
+// Build a single markdown file. The dev server's page keys are updated too.
+// Layouts, partials and highlighted code come from the open session, without
+// one they are loaded for this build only.
+int xo_build_file(const xo_config_t *config, const char *filepath, xo_dependency_tracker_t *tracker) {
+    if (!config || !filepath || !tracker) {
+        return XO_ERROR_MEMORY_ALLOCATION;
+    }
+    
+    xo_build_context_t build;
+    if (build_context_init(&build, config, tracker, (xo_build_cache_t *)config->build_cache, NULL) != XO_SUCCESS) {
+        return XO_ERROR_MEMORY_ALLOCATION;
+    }
+    
+    int result = build_page(&build, filepath);
+    if (result == XO_SUCCESS) {
+        record_page_key(&build, filepath);
+    }
+    
+    build_context_free(&build);
+    
+    return result;
+}
+
+// Pipeline read stage: skip unchanged pages, then parse within the memory budget
+static xo_build_status_t read_stage(xo_build_context_t *build, xo_build_job_t *job) {
+    if (page_is_unchanged(build, job->filepath)) {
+        return XO_BUILD_STATUS_SKIPPED;
+    }
+    
+    struct stat st;
+    build_job_reserve(build, job, stat(job->filepath, &st) == 0 ? (size_t)st.st_size : 0);
+    
+    if (read_page(build, job) != XO_SUCCESS) {
+        return XO_BUILD_STATUS_FAILED;
+    }
+    
+    return XO_BUILD_STATUS_PENDING;
+}
+
+// Pipeline render stage, the job is charged for everything its arena holds
+static xo_build_status_t render_stage(xo_build_context_t *build, xo_build_job_t *job) {
+    if (render_page(build, job) != XO_SUCCESS) {
+        return XO_BUILD_STATUS_FAILED;
+    }
+    
+    build_job_charge(build, job, xo_arena_used(&job->arena));
+    
+    return XO_BUILD_STATUS_PENDING;
+}
+
+// Pipeline write stage
+static xo_build_status_t write_stage(xo_build_context_t *build, xo_build_job_t *job) {
+    if (write_page(build, job) != XO_SUCCESS) {
+        return XO_BUILD_STATUS_FAILED;
+    }
+    
+    record_page_key(build, job->filepath);
+    job_profile_page(build, job);
+    
+    return XO_BUILD_STATUS_BUILT;
+}
+
+// Bounded queue of jobs between two pipeline stages. Pushing blocks while the
+// queue is full, so a fast stage cannot run arbitrarily far ahead of a slow one.
+typedef struct {
+    xo_build_job_t **items;   // Ring buffer of owned jobs
+    size_t head;
+    size_t count;
+    size_t capacity;
+    bool closed;              // No more jobs will be pushed
+    mutex_t lock;
+    cond_t not_empty;
+    cond_t not_full;
+} xo_build_queue_t;
+
+static int build_queue_init(xo_build_queue_t *queue, size_t capacity) {
+    queue->items = malloc(capacity * sizeof(xo_build_job_t *));
+    if (!queue->items) {
+        return XO_ERROR_MEMORY_ALLOCATION;
+    }
+    
+    queue->head = 0;
+    queue->count = 0;
+    queue->capacity = capacity;
+    queue->closed = false;
+    mutex_init(&queue->lock);
+    cond_init(&queue->not_empty);
+    cond_init(&queue->not_full);
+    
+    return XO_SUCCESS;
+}
+
+static void build_queue_free(xo_build_queue_t *queue, xo_build_context_t *build) {
+    for (size_t i = 0; i < queue->count; i++) {
+        build_job_release(build, queue->items[(queue->head + i) % queue->capacity]);
+    }
+    
+    free(queue->items);
+    cond_destroy(&queue->not_full);
+    cond_destroy(&queue->not_empty);
+    mutex_destroy(&queue->lock);
+    
+    queue->items = NULL;
+    queue->head = 0;
+    queue->count = 0;
+    queue->capacity = 0;
+}
+
+// Push a job onto the queue, blocking while it is full. The queue takes
+// ownership of the job unless it has been closed.
+static int build_queue_push(xo_build_queue_t *queue, xo_build_job_t *job) {
+    mutex_lock(&queue->lock);
+    
+    while (queue->count == queue->capacity && !queue->closed) {
+        cond_wait(&queue->not_full, &queue->lock);
+    }
+    
+    if (queue->closed) {
+        mutex_unlock(&queue->lock);
+        return XO_ERROR_INVALID_FORMAT;
+    }
+    
+    queue->items[(queue->head + queue->count) % queue->capacity] = job;
+    queue->count++;
+    
+    cond_signal(&queue->not_empty);
+    mutex_unlock(&queue->lock);
     
     return XO_SUCCESS;
 }
 
-// Free resources used by a dependency tracker
-void xo_dependency_tracker_free(xo_dependency_tracker_t *tracker) {
-    if (!tracker) {
-        return;
+// Pop the next job, blocking until one is available.
+// Returns NULL once the queue is closed and drained.
+static xo_build_job_t *build_queue_pop(xo_build_queue_t *queue) {
+    mutex_lock(&queue->lock);
+    
+    while (queue->count == 0 && !queue->closed) {
+        cond_wait(&queue->not_empty, &queue->lock);
     }
     
-    for (size_t i = 0; i < tracker->count; i++) {
-        free(tracker->entries[i].filepath);
+    xo_build_job_t *job = NULL;
+    if (queue->count > 0) {
+        job = queue->items[queue->head];
+        queue->head = (queue->head + 1) % queue->capacity;
+        queue->count--;
+        cond_signal(&queue->not_full);
+    }
+    
+    mutex_unlock(&queue->lock);
+    
+    return job;
+}
+
+// Mark the queue as complete and wake every waiting thread
+static void build_queue_close(xo_build_queue_t *queue) {
+    mutex_lock(&queue->lock);
+    queue->closed = true;
+    cond_broadcast(&queue->not_empty);
+    cond_broadcast(&queue->not_full);
+    mutex_unlock(&queue->lock);
+}
+
+// Processing function of a pipeline stage. Returns PENDING to pass the job on
+// to the next stage, or the page's final status when it is done with it.
+typedef xo_build_status_t (*xo_build_stage_fn)(xo_build_context_t *build, xo_build_job_t *job);
+
+// A pipeline stage: its threads take jobs from the input queue, process them
+// and pass them on to the output queue
+typedef struct {
+    xo_build_context_t *build;
+    xo_build_stage_fn process;
+    xo_build_queue_t *input;
+    xo_build_queue_t *output;     // NULL for the last stage
+    thread_handle_t *threads;
+    size_t thread_count;          // Threads started
+    size_t active;                // Threads still running, the last one closes the output queue
+} xo_build_stage_t;
+
+// Number of pipeline stages: read, render and write
+#define XO_BUILD_STAGE_COUNT 3
+
+// Shared state for a pipelined build
+typedef struct {
+    xo_build_context_t build;
+    xo_build_queue_t queues[XO_BUILD_STAGE_COUNT];  // Input queue of each stage
+    xo_build_stage_t stages[XO_BUILD_STAGE_COUNT];
+    bool serial;                  // No pipeline is running, the producer builds pages itself
+} xo_build_pool_t;
+
+// Pipeline stage worker, processes jobs until the input queue is closed and empty
+#ifdef _WIN32
+static DWORD WINAPI xo_build_stage_worker(LPVOID arg) {
+#else
+static void *xo_build_stage_worker(void *arg) {
+#endif
+    xo_build_stage_t *stage = (xo_build_stage_t *)arg;
+    xo_build_context_t *build = stage->build;
+    xo_build_job_t *job;
+    
+    while ((job = build_queue_pop(stage->input)) != NULL) {
+        xo_build_status_t status = stage->process(build, job);
         
-        for (size_t j = 0; j < tracker->entries[i].dep_count; j++) {
-            free(tracker->entries[i].dependencies[j]);
+        if (status == XO_BUILD_STATUS_PENDING) {
+            if (stage->output && build_queue_push(stage->output, job) == XO_SUCCESS) {
+                continue;
+            }
+            status = XO_BUILD_STATUS_FAILED;
         }
         
-        free(tracker->entries[i].dependencies);
+        count_page(build, status);
+        build_job_release(build, job);
     }
     
-    free(tracker->entries);
+    // The last thread out tells the next stage no more jobs are coming
+    mutex_lock(&build->lock);
+    bool last = --stage->active == 0;
+    mutex_unlock(&build->lock);
     
-    tracker->entries = NULL;
-    tracker->count = 0;
-    tracker->capacity = 0;
+    if (last && stage->output) {
+        build_queue_close(stage->output);
+    }
+    
+    return 0;
 }
 
-// Add a dependency to the tracker
-int xo_dependency_tracker_add(xo_dependency_tracker_t *tracker, const char *filepath, const char *dependency) {
-    if (!tracker || !filepath || !dependency) {
+// Hand a discovered page to the build
+static int build_pool_submit(xo_build_pool_t *pool, const char *filepath) {
+    xo_build_context_t *build = &pool->build;
+    
+    build->discovered_count++;
+    
+    if (pool->serial) {
+        count_page(build, build_cached_file(build, filepath));
+        return XO_SUCCESS;
+    }
+    
+    xo_build_job_t *job = build_job_create(build, filepath);
+    if (!job) {
         return XO_ERROR_MEMORY_ALLOCATION;
     }
     
-    // Find the entry for this file
-    size_t entry_index = (size_t)-1;
-    for (size_t i = 0; i < tracker->count; i++) {
-        if (strcmp(tracker->entries[i].filepath, filepath) == 0) {
-            entry_index = i;
-            break;
-        }
+    if (build_queue_push(&pool->queues[0], job) != XO_SUCCESS) {
+        build_job_release(build, job);
+        return XO_ERROR_MEMORY_ALLOCATION;
     }
     
-    // Create a new entry if needed
-    if (entry_index == (size_t)-1) {
-        // Check if we need to resize the array
-        if (tracker->count >= tracker->capacity) {
-            size_t new_capacity = tracker->capacity == 0 ? 8 : tracker->capacity * 2;
-            xo_dependency_entry_t *new_entries = realloc(tracker->entries, new_capacity * sizeof(xo_dependency_entry_t));
-            
-            if (!new_entries) {
-                return XO_ERROR_MEMORY_ALLOCATION;
-            }
-            
-            tracker->entries = new_entries;
-            tracker->capacity = new_capacity;
+    return XO_SUCCESS;
+}
+
+// Start the threads of every stage. Returns false when a stage could not start
+// any thread, leaving the started ones to be shut down by the caller.
+static bool build_pool_start(xo_build_pool_t *pool, size_t render_threads) {
+    // Reading checks each page's key and parses it, which is as much CPU work
+    // as I/O, and a build of unchanged pages does little else, so it runs as
+    // many threads as rendering. Writing is I/O bound and gets half as many.
+    size_t thread_counts[XO_BUILD_STAGE_COUNT] = { render_threads, render_threads, (render_threads + 1) / 2 };
+    
+    for (size_t i = 0; i < XO_BUILD_STAGE_COUNT; i++) {
+        xo_build_stage_t *stage = &pool->stages[i];
+        
+        stage->threads = malloc(thread_counts[i] * sizeof(thread_handle_t));
+        if (!stage->threads) {
+            return false;
         }
         
-        // Initialize the new entry
-        tracker->entries[tracker->count].filepath = strdup(filepath);
-        if (!tracker->entries[tracker->count].filepath) {
-            return XO_ERROR_MEMORY_ALLOCATION;
+        // Count the threads as active up front so an early exit cannot close the output queue
+        stage->active = thread_counts[i];
+        
+        for (size_t t = 0; t < thread_counts[i]; t++) {
+            if (thread_create(&stage->threads[stage->thread_count], xo_build_stage_worker, stage) != 0) {
+                xo_utils_console_warning("Failed to start build worker %zu", t + 1);
+                break;
+            }
+            stage->thread_count++;
         }
         
-        tracker->entries[tracker->count].dependencies = NULL;
-        tracker->entries[tracker->count].dep_count = 0;
-        tracker->entries[tracker->count].dep_capacity = 0;
+        mutex_lock(&pool->build.lock);
+        stage->active -= thread_counts[i] - stage->thread_count;
+        mutex_unlock(&pool->build.lock);
         
-        entry_index = tracker->count;
-        tracker->count++;
-    }
-    
-    // Check if the dependency is already in the list
-    xo_dependency_entry_t *entry = &tracker->entries[entry_index];
-    for (size_t i = 0; i < entry->dep_count; i++) {
-        if (strcmp(entry->dependencies[i], dependency) == 0) {
-            return XO_SUCCESS;
+        if (stage->thread_count == 0) {
+            return false;
         }
     }
     
-    // Add the dependency
-    if (entry->dep_count >= entry->dep_capacity) {
-        size_t new_capacity = entry->dep_capacity == 0 ? 8 : entry->dep_capacity * 2;
-        char **new_deps = realloc(entry->dependencies, new_capacity * sizeof(char *));
+    return true;
+}
+
+// Wait for every stage thread to finish
+static void build_pool_join(xo_build_pool_t *pool) {
+    for (size_t i = 0; i < XO_BUILD_STAGE_COUNT; i++) {
+        xo_build_stage_t *stage = &pool->stages[i];
         
-        if (!new_deps) {
-            return XO_ERROR_MEMORY_ALLOCATION;
+        for (size_t t = 0; t < stage->thread_count; t++) {
+            thread_join(stage->threads[t]);
         }
         
-        entry->dependencies = new_deps;
-        entry->dep_capacity = new_capacity;
+        free(stage->threads);
+        stage->threads = NULL;
+        stage->thread_count = 0;
     }
-    
-    entry->dependencies[entry->dep_count] = strdup(dependency);
-    if (!entry->dependencies[entry->dep_count]) {
+}
+
+// Check whether a path is a buildable markdown page
+static bool is_markdown_page(const char *filepath) {
+    char *ext = xo_utils_get_extension(filepath);
+    bool is_markdown = ext && (strcmp(ext, "md") == 0 || strcmp(ext, "markdown") == 0);
+    free(ext);
+    
+    // Files in the _partials directory are included by pages, not built
+    return is_markdown && strstr(filepath, "_partials") == NULL;
+}
+
+// Directory traversal callback, feeds markdown pages to the build
+static int enqueue_markdown_file_callback(const char *filepath, void *user_data) {
+    if (!filepath || !user_data) {
         return XO_ERROR_MEMORY_ALLOCATION;
     }
     
-    entry->dep_count++;
+    if (!is_markdown_page(filepath)) {
+        return XO_SUCCESS;
+    }
     
-    return XO_SUCCESS;
+    return build_pool_submit((xo_build_pool_t *)user_data, filepath);
 }
 
-// Get files that depend on a specific file
-char **xo_dependency_tracker_get_reverse(const xo_dependency_tracker_t *tracker, const char *dependency, size_t *count) {
-    if (!tracker || !dependency || !count) {
-        *count = 0;
-        return NULL;
+// Resolve the number of render workers to use
+static size_t resolve_job_count(const xo_config_t *config) {
+    size_t jobs = config->jobs > 0 ? (size_t)config->jobs : (size_t)xo_utils_cpu_count();
+    return jobs > 0 ? jobs : 1;
+}
+
+// Producer feeding pages to a running build pool
+typedef int (*xo_build_producer_t)(xo_build_pool_t *pool, void *user_data);
+
+// Run a pipelined build. Pages flow through read, render and write stages
+// connected by bounded queues, so reading and writing one page overlaps with
+// rendering another. The producer queues pages while the stages run.
+// The cache and previous graph are optional.
+static int run_build_pool(const xo_config_t *config, xo_dependency_tracker_t *tracker, xo_build_cache_t *cache,
+                          const xo_dependency_tracker_t *previous, xo_build_producer_t producer, void *producer_data) {
+    xo_build_pool_t pool;
+    if (build_context_init(&pool.build, config, tracker, cache, previous) != XO_SUCCESS) {
+        return XO_ERROR_MEMORY_ALLOCATION;
     }
     
-    // Count the number of files that depend on this file
-    size_t dep_count = 0;
-    for (size_t i = 0; i < tracker->count; i++) {
-        for (size_t j = 0; j < tracker->entries[i].dep_count; j++) {
-            if (strcmp(tracker->entries[i].dependencies[j], dependency) == 0) {
-                dep_count++;
-                break;
-            }
-        }
-    }
+    xo_build_context_t *build = &pool.build;
     
-    if (dep_count == 0) {
-        *count = 0;
-        return NULL;
+    xo_profile_t profile;
+    if (config->profile && xo_profile_init(&profile) == XO_SUCCESS) {
+        build->profile = &profile;
     }
     
-    // Allocate the array
-    char **result = malloc(dep_count * sizeof(char *));
-    if (!result) {
-        *count = 0;
-        return NULL;
-    }
+    size_t render_threads = resolve_job_count(config);
+    size_t queue_depth = config->queue_depth > 0 ? (size_t)config->queue_depth : 2 * render_threads;
     
-    // Fill the array
-    size_t result_count = 0;
-    for (size_t i = 0; i < tracker->count; i++) {
-        for (size_t j = 0; j < tracker->entries[i].dep_count; j++) {
-            if (strcmp(tracker->entries[i].dependencies[j], dependency) == 0) {
-                result[result_count] = strdup(tracker->entries[i].filepath);
-                if (!result[result_count]) {
-                    // Clean up on error
-                    for (size_t k = 0; k < result_count; k++) {
-                        free(result[k]);
-                    }
-                    free(result);
-                    *count = 0;
-                    return NULL;
-                }
-                result_count++;
-                break;
-            }
+    xo_build_stage_fn stage_functions[XO_BUILD_STAGE_COUNT] = { read_stage, render_stage, write_stage };
+    size_t queue_count = 0;
+    
+    for (; queue_count < XO_BUILD_STAGE_COUNT; queue_count++) {
+        if (build_queue_init(&pool.queues[queue_count], queue_depth) != XO_SUCCESS) {
+            break;
         }
     }
     
-    *count = result_count;
-    return result;
-}
-
-// Structure to collect markdown files during traversal
-typedef struct {
-    char **files;
-    size_t count;
-    size_t capacity;
-} xo_file_collector_t;
-
-// Callback for directory traversal to collect markdown files
-static int collect_markdown_files_callback(const char *filepath, void *user_data) {
-    if (!filepath || !user_data) {
-        return XO_ERROR_MEMORY_ALLOCATION;
+    for (size_t i = 0; i < XO_BUILD_STAGE_COUNT; i++) {
+        xo_build_stage_t *stage = &pool.stages[i];
+        stage->build = build;
+        stage->process = stage_functions[i];
+        stage->input = &pool.queues[i];
+        stage->output = i + 1 < XO_BUILD_STAGE_COUNT ? &pool.queues[i + 1] : NULL;
+        stage->threads = NULL;
+        stage->thread_count = 0;
+        stage->active = 0;
+    }
+    
+    // Start the stages first so pages build while the producer is still running.
+    // Without a complete pipeline the calling thread builds every page itself.
+    pool.serial = queue_count < XO_BUILD_STAGE_COUNT || !build_pool_start(&pool, render_threads);
+    if (pool.serial) {
+        for (size_t i = 0; i < queue_count; i++) {
+            build_queue_close(&pool.queues[i]);
+        }
+        build_pool_join(&pool);
     }
     
-    xo_file_collector_t *collector = (xo_file_collector_t *)user_data;
+    int result = producer(&pool, producer_data);
     
-    // Check if the file is a markdown file
-    const char *ext = xo_utils_get_extension(filepath);
-    if (!ext || (strcmp(ext, "md") != 0 && strcmp(ext, "markdown") != 0)) {
-        return XO_SUCCESS;
+    if (!pool.serial) {
+        build_queue_close(&pool.queues[0]);
+        build_pool_join(&pool);
     }
     
-    // Skip files in _partials directory
-    if (strstr(filepath, "_partials") != NULL) {
-        return XO_SUCCESS;
+    for (size_t i = 0; i < queue_count; i++) {
+        build_queue_free(&pool.queues[i], build);
     }
     
-    // Check if we need to resize the array
-    if (collector->count >= collector->capacity) {
-        size_t new_capacity = collector->capacity == 0 ? 8 : collector->capacity * 2;
-        char **new_files = realloc(collector->files, new_capacity * sizeof(char *));
+    if (result == XO_SUCCESS) {
+        if (build->failed_count > 0) {
+            xo_utils_console_warning("%zu of %zu files failed to build", build->failed_count, build->discovered_count);
+        }
         
-        if (!new_files) {
-            return XO_ERROR_MEMORY_ALLOCATION;
+        if (cache) {
+            xo_utils_console_info("%zu pages built, %zu unchanged", build->built_count, build->skipped_count);
         }
         
-        collector->files = new_files;
-        collector->capacity = new_capacity;
+        if (build->writes_skipped > 0) {
+            xo_utils_console_info("%zu output files unchanged, writes skipped", build->writes_skipped);
+        }
     }
     
-    // Add the file to the collector
-    collector->files[collector->count] = strdup(filepath);
-    if (!collector->files[collector->count]) {
-        return XO_ERROR_MEMORY_ALLOCATION;
+    if (build->profile) {
+        xo_profile_finish(build->profile);
+        xo_profile_print(build->profile, config->profile_top > 0 ? (size_t)config->profile_top : 0);
+        
+        if (config->profile_path[0] != '\0') {
+            if (xo_profile_write_json(build->profile, config->profile_path) == XO_SUCCESS) {
+                xo_utils_console_info("Profile written to %s", config->profile_path);
+            } else {
+                xo_utils_console_warning("Failed to write profile: %s", config->profile_path);
+            }
+        }
+        
+        xo_profile_free(build->profile);
     }
     
-    collector->count++;
+    build_context_free(build);
     
-    return XO_SUCCESS;
+    return result;
 }
 
-// Get all markdown files in a directory
-static int get_markdown_files(const char *dir_path, char ***files, size_t *count) {
-    if (!dir_path || !files || !count) {
-        return XO_ERROR_MEMORY_ALLOCATION;
+// Producer walking a directory tree
+static int produce_directory(xo_build_pool_t *pool, void *user_data) {
+    const char *dirpath = (const char *)user_data;
+    
+    if (xo_utils_traverse_directory(dirpath, enqueue_markdown_file_callback, pool) != XO_SUCCESS) {
+        xo_utils_console_error("Failed to get markdown files from directory: %s", dirpath);
+        return XO_ERROR_FILE_NOT_FOUND;
     }
     
-    // Initialize the collector
-    xo_file_collector_t collector;
-    collector.files = NULL;
-    collector.count = 0;
-    collector.capacity = 0;
+    return XO_SUCCESS;
+}
+
+// List of paths handed to a build pool
+typedef struct {
+    char **files;
+    size_t count;
+} xo_build_file_list_t;
+
+// Producer queueing a fixed list of files
+static int produce_file_list(xo_build_pool_t *pool, void *user_data) {
+    xo_build_file_list_t *list = (xo_build_file_list_t *)user_data;
     
-    // Traverse the directory and collect markdown files
-    int result = xo_utils_traverse_directory(dir_path, collect_markdown_files_callback, &collector);
-    if (result != XO_SUCCESS) {
-        for (size_t i = 0; i < collector.count; i++) {
-            free(collector.files[i]);
+    for (size_t i = 0; i < list->count; i++) {
+        if (xo_utils_file_exists(list->files[i])) {
+            enqueue_markdown_file_callback(list->files[i], pool);
         }
-        free(collector.files);
-        return result;
     }
     
-    // Set the output parameters
-    *files = collector.files;
-    *count = collector.count;
-    
     return XO_SUCCESS;
 }
 
-// Build a single markdown file
-int xo_build_file(const xo_config_t *config, const char *filepath, xo_dependency_tracker_t *tracker) {
-    if (!config || !filepath || !tracker) {
+// Build all markdown files in a directory
+int xo_build_directory(const xo_config_t *config, const char *dirpath, xo_dependency_tracker_t *tracker) {
+    if (!config || !dirpath || !tracker) {
         return XO_ERROR_MEMORY_ALLOCATION;
     }
     
-    xo_utils_console_info("Building file: %s", filepath);
-    
-    // Parse the markdown file
-    xo_markdown_t md;
-    if (xo_markdown_parse_file(filepath, &md) != XO_SUCCESS) {
-        xo_utils_console_error("Failed to parse markdown file: %s", filepath);
-        return XO_ERROR_FILE_NOT_FOUND;
-    }
-    
-    // Get the layout
-    const char *layout_name = xo_markdown_get_frontmatter(&md, "layout");
-    if (!layout_name) {
-        layout_name = "default";
+    return run_build_pool(config, tracker, NULL, NULL, produce_directory, (void *)dirpath);
+}
+
+// Rebuild the pages that depend on a layout or partial, using the dev server's
+// dependency graph or the one saved by the last build. Returns
+// XO_ERROR_FILE_NOT_FOUND when the graph is missing or has no pages for the
+// dependency, so callers can fall back to a full rebuild.
+int xo_build_dependents(const xo_config_t *config, const char *dependency) {
+    if (!config || !dependency) {
+        return XO_ERROR_MEMORY_ALLOCATION;
     }
     
-    char layout_path[XO_MAX_PATH];
-    sprintf(layout_path, "%s/%s.html", config->layouts_dir, layout_name);
-    
-    // Add layout as a dependency
-    xo_dependency_tracker_add(tracker, filepath, layout_path);
+    char dependency_path[XO_MAX_PATH];
+    snprintf(dependency_path, sizeof(dependency_path), "%s/%s", config->cache_dir, XO_DEPENDENCY_FILE);
     
-    // Convert markdown to HTML
-    char *html_content;
-    if (xo_markdown_to_html(&md, &html_content) != XO_SUCCESS) {
-        xo_utils_console_error("Failed to convert markdown to HTML: %s", filepath);
-        xo_markdown_free(&md);
-        return XO_ERROR_INVALID_FORMAT;
+    xo_dependency_tracker_t loaded;
+    xo_dependency_tracker_t *tracker = (xo_dependency_tracker_t *)config->dependencies;
+    if (!tracker) {
+        if (xo_dependency_tracker_init(&loaded) != XO_SUCCESS) {
+            return XO_ERROR_MEMORY_ALLOCATION;
+        }
+        
+        if (xo_dependency_tracker_load(&loaded, dependency_path) != XO_SUCCESS) {
+            xo_dependency_tracker_free(&loaded);
+            return XO_ERROR_FILE_NOT_FOUND;
+        }
+        tracker = &loaded;
     }
     
-    // Create template context
-    xo_template_context_t ctx;
-    xo_template_context_init(&ctx);
-    
-    // Add frontmatter values to context
-    for (size_t i = 0; i < md.frontmatter.count; i++) {
-        xo_template_context_add_string(&ctx, md.frontmatter.items[i].key, md.frontmatter.items[i].value);
+    xo_build_file_list_t list;
+    list.files = xo_dependency_tracker_get_reverse(tracker, dependency, &list.count);
+    if (!list.files) {
+        if (tracker == &loaded) {
+            xo_dependency_tracker_free(&loaded);
+        }
+        return XO_ERROR_FILE_NOT_FOUND;
     }
     
-    // Add content to context
-    xo_template_context_add_string(&ctx, "content", html_content);
-    
-    // Add other useful values
-    xo_template_context_add_string(&ctx, "baseUrl", "/");  // Default base URL
-    
-    // Load partials
-    xo_template_partials_t partials;
-    xo_template_partials_init(&partials);
+    xo_utils_console_info("Rebuilding %zu pages that depend on %s", list.count, dependency);
     
-    // TODO: Load partials from content/_partials directory
-    
-    // Render the template
-    char *final_html;
-    if (xo_template_render_file(layout_path, &ctx, &partials, &final_html) != XO_SUCCESS) {
-        xo_utils_console_error("Failed to render template: %s", layout_path);
-        free(html_content);
-        xo_template_context_free(&ctx);
-        xo_template_partials_free(&partials);
-        xo_markdown_free(&md);
-        return XO_ERROR_INVALID_FORMAT;
+    // The rebuilt pages replace their dependencies in the graph. A graph
+    // loaded here is saved back for the next change, the dev server saves
+    // its own with the build cache.
+    int result = run_build_pool(config, tracker, (xo_build_cache_t *)config->build_cache, NULL, produce_file_list,
+                                &list);
+    if (result == XO_SUCCESS && tracker == &loaded) {
+        xo_dependency_tracker_save(&loaded, dependency_path);
     }
     
-    // Determine the output path
-    char output_path[XO_MAX_PATH];
-    
-    // Calculate the relative path from content directory
-    char *rel_path = filepath;
-    size_t content_dir_len = strlen(config->content_dir);
-    if (strncmp(filepath, config->content_dir, content_dir_len) == 0) {
-        rel_path = filepath + content_dir_len;
-        // Skip leading slash if present
-        if (*rel_path == '/' || *rel_path == '\\') {
-            rel_path++;
-        }
+    for (size_t i = 0; i < list.count; i++) {
+        free(list.files[i]);
     }
-    
-    // Replace .md extension with /index.html
-    char *ext = strrchr(rel_path, '.');
-    if (ext && strcmp(ext, ".md") == 0) {
-        *ext = '\0'; // Terminate before the extension
+    free(list.files);
+    if (tracker == &loaded) {
+        xo_dependency_tracker_free(&loaded);
     }
     
-    // Special case for index.md files
-    if (strcmp(rel_path, "index") == 0) {
-        sprintf(output_path, "%s/index.html", config->output_dir);
-    } else {
-        sprintf(output_path, "%s/%s/index.html", config->output_dir, rel_path);
+    return result;
+}
+
+// Save the dependency graph and build cache the dev server keeps, so the next
+// build starts from the state its rebuilds left
+int xo_build_save_cache(const xo_config_t *config) {
+    if (!config || !config->dependencies || !config->build_cache) {
+        return XO_ERROR_MEMORY_ALLOCATION;
     }
     
-    // Create directory structure
-    char *output_dir = xo_utils_dirname(output_path);
-    if (!output_dir) {
-        xo_utils_console_error("Failed to get output directory");
-        free(final_html);
-        free(html_content);
-        xo_template_context_free(&ctx);
-        xo_template_partials_free(&partials);
-        xo_markdown_free(&md);
-        return XO_ERROR_MEMORY_ALLOCATION;
+    char cache_path[XO_MAX_PATH];
+    char dependency_path[XO_MAX_PATH];
+    snprintf(cache_path, sizeof(cache_path), "%s/%s", config->cache_dir, XO_BUILD_CACHE_FILE);
+    snprintf(dependency_path, sizeof(dependency_path), "%s/%s", config->cache_dir, XO_DEPENDENCY_FILE);
+    
+    if (xo_dependency_tracker_save((const xo_dependency_tracker_t *)config->dependencies, dependency_path) != XO_SUCCESS ||
+        xo_build_cache_save((const xo_build_cache_t *)config->build_cache, cache_path) != XO_SUCCESS) {
+        xo_utils_console_warning("Failed to save build cache in %s", config->cache_dir);
+        return XO_ERROR_FILE_NOT_FOUND;
     }
     
-    if (xo_utils_mkdir_p(output_dir) != 0) {
-        xo_utils_console_error("Failed to create output directory: %s", output_dir);
-        free(output_dir);
-        free(final_html);
-        free(html_content);
-        xo_template_context_free(&ctx);
-        xo_template_partials_free(&partials);
-        xo_markdown_free(&md);
+    return XO_SUCCESS;
+}
+
+// Load the compiled layouts, partials and highlighted code into the config,
+// so every build until the session closes shares them instead of loading its
+// own. Layouts are checked against their files by every build, partials are
+// only reloaded through xo_template_partials_load_file.
+int xo_build_session_open(xo_config_t *config) {
+    if (!config) {
         return XO_ERROR_MEMORY_ALLOCATION;
     }
     
-    free(output_dir);
-    
-    // Write the output file
-    if (xo_utils_write_file(output_path, final_html) != 0) {
-        xo_utils_console_error("Failed to write output file: %s", output_path);
-        free(final_html);
-        free(html_content);
-        xo_template_context_free(&ctx);
-        xo_template_partials_free(&partials);
-        xo_markdown_free(&md);
-        return XO_ERROR_MEMORY_ALLOCATION;
+    if (!config->layout_cache) {
+        xo_layout_cache_t *layouts = malloc(sizeof(xo_layout_cache_t));
+        if (!layouts || xo_layout_cache_init(layouts) != XO_SUCCESS) {
+            free(layouts);
+            return XO_ERROR_MEMORY_ALLOCATION;
+        }
+        config->layout_cache = layouts;
     }
     
-    xo_utils_console_success("Built: %s -> %s", filepath, output_path);
+    if (!config->partials) {
+        xo_template_partials_t *partials = malloc(sizeof(xo_template_partials_t));
+        if (!partials) {
+            return XO_ERROR_MEMORY_ALLOCATION;
+        }
+        
+        char partials_dir[XO_MAX_PATH];
+        snprintf(partials_dir, sizeof(partials_dir), "%s/%s", config->content_dir, XO_PARTIALS_DIR);
+        xo_template_partials_init(partials);
+        xo_template_partials_load_dir(partials, partials_dir);
+        config->partials = partials;
+    }
     
-    // Clean up
-    free(final_html);
-    free(html_content);
-    xo_template_context_free(&ctx);
-    xo_template_partials_free(&partials);
-    xo_markdown_free(&md);
+    if (!config->highlight_cache) {
+        xo_highlight_cache_t *highlights = malloc(sizeof(xo_highlight_cache_t));
+        if (!highlights || xo_highlight_cache_init(highlights) != XO_SUCCESS) {
+            free(highlights);
+            return XO_ERROR_MEMORY_ALLOCATION;
+        }
+        
+        char highlight_path[XO_MAX_PATH];
+        snprintf(highlight_path, sizeof(highlight_path), "%s/%s", config->cache_dir, XO_HIGHLIGHT_CACHE_FILE);
+        if (xo_utils_file_exists(highlight_path) && xo_highlight_cache_load(highlights, highlight_path) != XO_SUCCESS) {
+            xo_highlight_cache_free(highlights);
+            xo_highlight_cache_init(highlights);
+        }
+        config->highlight_cache = highlights;
+    }
     
     return XO_SUCCESS;
 }
 
-// Build all markdown files in a directory
-int xo_build_directory(const xo_config_t *config, const char *dirpath, xo_dependency_tracker_t *tracker) {
-    if (!config || !dirpath || !tracker) {
-        return XO_ERROR_MEMORY_ALLOCATION;
+// Save the session's highlighted code and release what the session loaded
+void xo_build_session_close(xo_config_t *config) {
+    if (!config) {
+        return;
     }
     
-    char **files;
-    size_t file_count;
-    
-    if (get_markdown_files(dirpath, &files, &file_count) != XO_SUCCESS) {
-        xo_utils_console_error("Failed to get markdown files from directory: %s", dirpath);
-        return XO_ERROR_FILE_NOT_FOUND;
+    if (config->highlight_cache) {
+        char highlight_path[XO_MAX_PATH];
+        snprintf(highlight_path, sizeof(highlight_path), "%s/%s", config->cache_dir, XO_HIGHLIGHT_CACHE_FILE);
+        xo_highlight_cache_save((xo_highlight_cache_t *)config->highlight_cache, highlight_path, false);
+        xo_highlight_cache_free((xo_highlight_cache_t *)config->highlight_cache);
+        free(config->highlight_cache);
     }
     
-    for (size_t i = 0; i < file_count; i++) {
-        xo_build_file(config, files[i], tracker);
-        free(files[i]);
+    if (config->partials) {
+        xo_template_partials_free((xo_template_partials_t *)config->partials);
+        free(config->partials);
     }
     
-    free(files);
+    if (config->layout_cache) {
+        xo_layout_cache_free((xo_layout_cache_t *)config->layout_cache);
+        free(config->layout_cache);
+    }
     
-    return XO_SUCCESS;
+    config->layout_cache = NULL;
+    config->partials = NULL;
+    config->highlight_cache = NULL;
 }
 
 // Initialize a sample project
@@ -728,22 +3242,68 @@ int xo_build(const xo_config_t *config) {
     xo_dependency_tracker_t tracker;
     xo_dependency_tracker_init(&tracker);
     
-    // Process all markdown files
-    // For now, we'll just process the index.md file
-    char index_path[XO_MAX_PATH];
-    sprintf(index_path, "%s/index.md", config->content_dir);
+    // Load the page hashes and the dependency graph from the previous build
+    xo_build_cache_t cache;
+    xo_dependency_tracker_t previous;
+    if (xo_build_cache_init(&cache) != XO_SUCCESS) {
+        xo_dependency_tracker_free(&tracker);
+        return XO_ERROR_MEMORY_ALLOCATION;
+    }
+    if (xo_dependency_tracker_init(&previous) != XO_SUCCESS) {
+        xo_build_cache_free(&cache);
+        xo_dependency_tracker_free(&tracker);
+        return XO_ERROR_MEMORY_ALLOCATION;
+    }
+    
+    char cache_path[XO_MAX_PATH];
+    char dependency_path[XO_MAX_PATH];
+    snprintf(cache_path, sizeof(cache_path), "%s/%s", config->cache_dir, XO_BUILD_CACHE_FILE);
+    snprintf(dependency_path, sizeof(dependency_path), "%s/%s", config->cache_dir, XO_DEPENDENCY_FILE);
     
-    if (xo_utils_file_exists(index_path)) {
-        xo_build_file(config, index_path, &tracker);
-    } else {
-        xo_utils_console_warning("No index.md file found");
+    if (!config->clean_build && xo_utils_file_exists(cache_path) && xo_utils_file_exists(dependency_path)) {
+        if (xo_build_cache_load(&cache, cache_path) != XO_SUCCESS ||
+            xo_dependency_tracker_load(&previous, dependency_path) != XO_SUCCESS) {
+            xo_utils_console_warning("Ignoring unreadable build cache in %s", config->cache_dir);
+            xo_build_cache_free(&cache);
+            xo_dependency_tracker_free(&previous);
+            xo_build_cache_init(&cache);
+            xo_dependency_tracker_init(&previous);
+        }
     }
     
-    // TODO: Process all markdown files in the content directory
+    // Process all markdown files in the content directory
+    int result = run_build_pool(config, &tracker, &cache, &previous, produce_directory, (void *)config->content_dir);
+    
+    if (result == XO_SUCCESS) {
+        if (xo_dependency_tracker_save(&tracker, dependency_path) != XO_SUCCESS ||
+            xo_build_cache_save(&cache, cache_path) != XO_SUCCESS) {
+            xo_utils_console_warning("Failed to save build cache in %s", config->cache_dir);
+        }
+        
+        // The dev server keeps the graph and page keys of this build for its rebuilds
+        if (config->dependencies && config->build_cache) {
+            xo_dependency_tracker_t *dependencies = (xo_dependency_tracker_t *)config->dependencies;
+            xo_build_cache_t *build_cache = (xo_build_cache_t *)config->build_cache;
+            
+            xo_dependency_tracker_free(dependencies);
+            *dependencies = tracker;
+            xo_dependency_tracker_init(&tracker);
+            
+            xo_build_cache_free(build_cache);
+            *build_cache = cache;
+            xo_build_cache_init(&cache);
+        }
+    }
     
     // Clean up
+    xo_build_cache_free(&cache);
+    xo_dependency_tracker_free(&previous);
     xo_dependency_tracker_free(&tracker);
     
+    if (result != XO_SUCCESS) {
+        return result;
+    }
+    
     xo_utils_console_success("Build completed successfully");
     
     return XO_SUCCESS;
@@ -766,6 +3326,16 @@ static void *xo_dev_server_handler(void *arg) {
     return 0;
 }
 
+// Release the dependency graph, build cache and frontmatter hashes kept by the dev server
+static void dev_server_release_state(xo_config_t *config) {
+    xo_dependency_tracker_free((xo_dependency_tracker_t *)config->dependencies);
+    xo_build_cache_free((xo_build_cache_t *)config->build_cache);
+    xo_build_cache_free((xo_build_cache_t *)config->frontmatter_hashes);
+    config->dependencies = NULL;
+    config->build_cache = NULL;
+    config->frontmatter_hashes = NULL;
+}
+
 // Start the development server
 int xo_dev_server(const xo_config_t *config) {
     if (!config) {
@@ -776,11 +3346,33 @@ int xo_dev_server(const xo_config_t *config) {
     xo_config_t *mutable_config = (xo_config_t *)config;
     mutable_config->running = true;
     
+    // Keep the dependency graph and build cache of the first build, every
+    // rebuild updates them in memory rather than reloading them from disk
+    xo_dependency_tracker_t dependencies;
+    xo_build_cache_t build_cache;
+    xo_build_cache_t frontmatter_hashes;
+    if (xo_dependency_tracker_init(&dependencies) != XO_SUCCESS) {
+        return XO_ERROR_MEMORY_ALLOCATION;
+    }
+    if (xo_build_cache_init(&build_cache) != XO_SUCCESS) {
+        xo_dependency_tracker_free(&dependencies);
+        return XO_ERROR_MEMORY_ALLOCATION;
+    }
+    if (xo_build_cache_init(&frontmatter_hashes) != XO_SUCCESS) {
+        xo_dependency_tracker_free(&dependencies);
+        xo_build_cache_free(&build_cache);
+        return XO_ERROR_MEMORY_ALLOCATION;
+    }
+    mutable_config->dependencies = &dependencies;
+    mutable_config->build_cache = &build_cache;
+    mutable_config->frontmatter_hashes = &frontmatter_hashes;
+    
     // First, build the project
     xo_utils_console_info("Building project...");
     int result = xo_build(config);
     if (result != XO_SUCCESS) {
         xo_utils_console_error("Failed to build project");
+        dev_server_release_state(mutable_config);
         return result;
     }
     
@@ -790,6 +3382,7 @@ int xo_dev_server(const xo_config_t *config) {
     result = xo_server_init(&server, config);
     if (result != XO_SUCCESS) {
         xo_utils_console_error("Failed to initialize server");
+        dev_server_release_state(mutable_config);
         return result;
     }
     
@@ -801,6 +3394,7 @@ int xo_dev_server(const xo_config_t *config) {
     if (result != XO_SUCCESS) {
         xo_utils_console_error("Failed to start server");
         xo_server_free(&server);
+        dev_server_release_state(mutable_config);
         return result;
     }
     
@@ -811,6 +3405,7 @@ int xo_dev_server(const xo_config_t *config) {
         xo_utils_console_error("Failed to initialize file watcher");
         xo_server_stop(&server);
         xo_server_free(&server);
+        dev_server_release_state(mutable_config);
         return result;
     }
     
@@ -821,6 +3416,7 @@ int xo_dev_server(const xo_config_t *config) {
         xo_watcher_free(&watcher);
         xo_server_stop(&server);
         xo_server_free(&server);
+        dev_server_release_state(mutable_config);
         return result;
     }
     
@@ -830,16 +3426,31 @@ int xo_dev_server(const xo_config_t *config) {
         xo_watcher_free(&watcher);
         xo_server_stop(&server);
         xo_server_free(&server);
+        dev_server_release_state(mutable_config);
         return result;
     }
     
+    // Keep the compiled layouts, partials and highlighted code loaded across
+    // rebuilds, the watcher invalidates or reloads the ones that change
+    xo_build_session_open(mutable_config);
+    
+    // Keep the block ASTs of rebuilt pages so edits only convert the changed blocks
+    xo_markdown_cache_t markdown_cache;
+    if (xo_markdown_cache_init(&markdown_cache) == XO_SUCCESS) {
+        mutable_config->markdown_cache = &markdown_cache;
+    }
+    
     // Start the watcher
     result = xo_watcher_start(&watcher, xo_handle_file_event, (void *)mutable_config);
     if (result != XO_SUCCESS) {
         xo_utils_console_error("Failed to start file watcher");
+        mutable_config->markdown_cache = NULL;
+        xo_markdown_cache_free(&markdown_cache);
+        xo_build_session_close(mutable_config);
         xo_watcher_free(&watcher);
         xo_server_stop(&server);
         xo_server_free(&server);
+        dev_server_release_state(mutable_config);
         return result;
     }
     
@@ -849,8 +3460,12 @@ int xo_dev_server(const xo_config_t *config) {
         xo_utils_console_error("Failed to create dev server thread");
         xo_watcher_stop(&watcher);
         xo_watcher_free(&watcher);
+        mutable_config->markdown_cache = NULL;
+        xo_markdown_cache_free(&markdown_cache);
+        xo_build_session_close(mutable_config);
         xo_server_stop(&server);
         xo_server_free(&server);
+        dev_server_release_state(mutable_config);
         return XO_ERROR_SERVER;
     }
     
@@ -869,6 +3484,11 @@ int xo_dev_server(const xo_config_t *config) {
     mutable_config->running = false;
     xo_watcher_stop(&watcher);
     xo_watcher_free(&watcher);
+    mutable_config->markdown_cache = NULL;
+    xo_markdown_cache_free(&markdown_cache);
+    xo_build_session_close(mutable_config);
+    xo_build_save_cache(mutable_config);
+    dev_server_release_state(mutable_config);
     xo_server_stop(&server);
     xo_server_free(&server);
     
@@ -0,0 +1,743 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include "highlight.h"
+#include "utils.h"
+#include "mutex.h"
+
+// Format of the highlight cache file. Bump it when the lexer or the language
+// tables change, so snippets highlighted by an older version are dropped.
+#define HIGHLIGHT_CACHE_HEADER "xo-highlight-cache 1\n"
+
+#define COUNT_OF(table) (sizeof(table) / sizeof((table)[0]))
+
+static const char *const c_keywords[] = {
+    "_Alignas", "_Alignof", "_Atomic", "_Generic", "_Noreturn", "_Static_assert", "_Thread_local", "auto", "break",
+    "case", "const", "continue", "default", "do", "else", "enum", "extern", "for", "goto", "if", "inline",
+    "register", "restrict", "return", "sizeof", "static", "struct", "switch", "typedef", "union", "volatile",
+    "while"
+};
+
+static const char *const c_types[] = {
+    "FILE", "NULL", "_Bool", "bool", "char", "double", "false", "float", "int", "int16_t", "int32_t", "int64_t",
+    "int8_t", "intptr_t", "long", "ptrdiff_t", "short", "signed", "size_t", "ssize_t", "true", "uint16_t",
+    "uint32_t", "uint64_t", "uint8_t", "uintptr_t", "unsigned", "void"
+};
+
+static const char *const cpp_keywords[] = {
+    "alignas", "alignof", "asm", "auto", "break", "case", "catch", "class", "co_await", "co_return", "co_yield",
+    "concept", "const", "const_cast", "consteval", "constexpr", "constinit", "continue", "decltype", "default",
+    "delete", "do", "dynamic_cast", "else", "enum", "explicit", "export", "extern", "for", "friend", "goto", "if",
+    "inline", "mutable", "namespace", "new", "noexcept", "operator", "private", "protected", "public", "register",
+    "reinterpret_cast", "requires", "return", "sizeof", "static", "static_assert", "static_cast", "struct",
+    "switch", "template", "this", "thread_local", "throw", "try", "typedef", "typeid", "typename", "union", "using",
+    "virtual", "volatile", "while"
+};
+
+static const char *const cpp_types[] = {
+    "NULL", "bool", "char", "char16_t", "char32_t", "char8_t", "double", "false", "float", "int", "int16_t",
+    "int32_t", "int64_t", "int8_t", "long", "nullptr", "short", "signed", "size_t", "true", "uint16_t", "uint32_t",
+    "uint64_t", "uint8_t", "unsigned", "void", "wchar_t"
+};
+
+static const char *const go_keywords[] = {
+    "break", "case", "chan", "const", "continue", "default", "defer", "else", "fallthrough", "for", "func", "go",
+    "goto", "if", "import", "interface", "map", "package", "range", "return", "select", "struct", "switch", "type",
+    "var"
+};
+
+static const char *const go_types[] = {
+    "any", "bool", "byte", "complex128", "complex64", "error", "false", "float32", "float64", "int", "int16",
+    "int32", "int64", "int8", "iota", "nil", "rune", "string", "true", "uint", "uint16", "uint32", "uint64",
+    "uint8", "uintptr"
+};
+
+static const char *const js_keywords[] = {
+    "abstract", "as", "async", "await", "break", "case", "catch", "class", "const", "continue", "debugger",
+    "declare", "default", "delete", "do", "else", "enum", "export", "extends", "finally", "for", "from", "function",
+    "get", "if", "implements", "import", "in", "instanceof", "interface", "keyof", "let", "namespace", "new", "of",
+    "private", "protected", "public", "readonly", "return", "set", "static", "super", "switch", "this", "throw",
+    "try", "type", "typeof", "var", "void", "while", "with", "yield"
+};
+
+static const char *const js_types[] = {
+    "Infinity", "NaN", "any", "bigint", "boolean", "false", "never", "null", "number", "object", "string", "symbol",
+    "true", "undefined", "unknown"
+};
+
+static const char *const python_keywords[] = {
+    "and", "as", "assert", "async", "await", "break", "class", "continue", "def", "del", "elif", "else", "except",
+    "finally", "for", "from", "global", "if", "import", "in", "is", "lambda", "nonlocal", "not", "or", "pass",
+    "raise", "return", "try", "while", "with", "yield"
+};
+
+static const char *const python_types[] = {
+    "False", "None", "True", "bool", "bytes", "dict", "float", "int", "list", "object", "set", "str", "tuple"
+};
+
+static const char *const rust_keywords[] = {
+    "as", "async", "await", "break", "const", "continue", "crate", "dyn", "else", "enum", "extern", "fn", "for",
+    "if", "impl", "in", "let", "loop", "match", "mod", "move", "mut", "pub", "ref", "return", "self", "static",
+    "struct", "super", "trait", "type", "unsafe", "use", "where", "while"
+};
+
+static const char *const rust_types[] = {
+    "Box", "Err", "None", "Ok", "Option", "Result", "Self", "Some", "String", "Vec", "bool", "char", "f32", "f64",
+    "false", "i128", "i16", "i32", "i64", "i8", "isize", "str", "true", "u128", "u16", "u32", "u64", "u8", "usize"
+};
+
+static const char *const shell_keywords[] = {
+    "case", "declare", "do", "done", "elif", "else", "esac", "exit", "export", "fi", "for", "function", "if", "in",
+    "local", "readonly", "return", "select", "then", "until", "while"
+};
+
+static const char *const shell_types[] = {
+    "alias", "cd", "echo", "eval", "exec", "false", "printf", "read", "set", "shift", "source", "test", "trap",
+    "true", "unset"
+};
+
+static const char *const c_aliases[] = { "h", NULL };
+static const char *const cpp_aliases[] = { "c++", "cc", "cxx", "hpp", NULL };
+static const char *const go_aliases[] = { "golang", NULL };
+static const char *const js_aliases[] = { "js", "jsx", "ts", "tsx", "typescript", "json", NULL };
+static const char *const python_aliases[] = { "py", "python3", NULL };
+static const char *const rust_aliases[] = { "rs", NULL };
+static const char *const shell_aliases[] = { "sh", "bash", "zsh", "console", NULL };
+
+static const xo_highlight_language_t languages[] = {
+    { "c", c_aliases, c_keywords, COUNT_OF(c_keywords), c_types, COUNT_OF(c_types),
+      "//", "/*", "*/", "\"'", "", false, '#', true, false },
+    { "cpp", cpp_aliases, cpp_keywords, COUNT_OF(cpp_keywords), cpp_types, COUNT_OF(cpp_types),
+      "//", "/*", "*/", "\"'", "", false, '#', true, false },
+    { "go", go_aliases, go_keywords, COUNT_OF(go_keywords), go_types, COUNT_OF(go_types),
+      "//", "/*", "*/", "\"'`", "`", false, 0, false, false },
+    { "javascript", js_aliases, js_keywords, COUNT_OF(js_keywords), js_types, COUNT_OF(js_types),
+      "//", "/*", "*/", "\"'`", "`", false, 0, false, false },
+    { "python", python_aliases, python_keywords, COUNT_OF(python_keywords), python_types, COUNT_OF(python_types),
+      "#", NULL, NULL, "\"'", "", true, '@', false, false },
+    { "rust", rust_aliases, rust_keywords, COUNT_OF(rust_keywords), rust_types, COUNT_OF(rust_types),
+      "//", "/*", "*/", "\"", "\"", false, '#', true, false },
+    { "shell", shell_aliases, shell_keywords, COUNT_OF(shell_keywords), shell_types, COUNT_OF(shell_types),
+      "#", NULL, NULL, "\"'", "\"'", false, 0, false, true }
+};
+
+// Compare a length-delimited name with a NUL-terminated one, ignoring case
+static bool name_matches(const char *name, size_t length, const char *candidate) {
+    for (size_t i = 0; i < length; i++) {
+        if (candidate[i] == '\0' || tolower((unsigned char)name[i]) != candidate[i]) {
+            return false;
+        }
+    }
+    
+    return candidate[length] == '\0';
+}
+
+// Find the language named by a fence info string, NULL when it is not known
+const xo_highlight_language_t *xo_highlight_find_language(const char *name, size_t length) {
+    if (!name || length == 0) {
+        return NULL;
+    }
+    
+    for (size_t i = 0; i < COUNT_OF(languages); i++) {
+        if (name_matches(name, length, languages[i].name)) {
+            return &languages[i];
+        }
+        for (const char *const *alias = languages[i].aliases; *alias; alias++) {
+            if (name_matches(name, length, *alias)) {
+                return &languages[i];
+            }
+        }
+    }
+    
+    return NULL;
+}
+
+// Check whether a word is in a sorted table
+static bool in_table(const char *const *table, size_t count, const char *word, size_t length) {
+    size_t low = 0;
+    size_t high = count;
+    
+    while (low < high) {
+        size_t mid = low + (high - low) / 2;
+        int cmp = strncmp(table[mid], word, length);
+        if (cmp == 0) {
+            if (table[mid][length] == '\0') {
+                return true;
+            }
+            cmp = 1;
+        }
+        if (cmp < 0) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    
+    return false;
+}
+
+static bool is_word_start(char c) {
+    return isalpha((unsigned char)c) || c == '_';
+}
+
+static bool is_word_char(char c) {
+    return isalnum((unsigned char)c) || c == '_';
+}
+
+// Check whether a marker like "//" starts at i
+static bool starts_with(const char *code, size_t i, size_t length, const char *marker) {
+    size_t marker_length = strlen(marker);
+    return length - i >= marker_length && memcmp(code + i, marker, marker_length) == 0;
+}
+
+// End of the line containing i, before its newline
+static size_t line_end(const char *code, size_t i, size_t length) {
+    const char *newline = memchr(code + i, '\n', length - i);
+    return newline ? (size_t)(newline - code) : length;
+}
+
+// End of a string opened by the quote at i. Strings that can't span lines end
+// at the newline when they are not closed.
+static size_t string_end(const char *code, size_t i, size_t length, char quote, bool multiline) {
+    for (i++; i < length && code[i] != quote; i++) {
+        if (code[i] == '\\' && i + 1 < length) {
+            i++;
+        } else if (code[i] == '\n' && !multiline) {
+            return i;
+        }
+    }
+    
+    return i < length ? i + 1 : length;
+}
+
+// End of the token closed by marker after start, the end of the code when it is not closed
+static size_t closed_by(const char *code, size_t start, size_t length, const char *marker) {
+    size_t marker_length = strlen(marker);
+    
+    for (size_t i = start; length - i >= marker_length; i++) {
+        const char *found = memchr(code + i, marker[0], length - i);
+        if (!found) {
+            break;
+        }
+        i = (size_t)(found - code);
+        if (length - i >= marker_length && memcmp(found, marker, marker_length) == 0) {
+            return i + marker_length;
+        }
+    }
+    
+    return length;
+}
+
+// End of a number starting at i, with hex digits, suffixes and exponents
+static size_t number_end(const char *code, size_t i, size_t length) {
+    for (i++; i < length; i++) {
+        char c = code[i];
+        char prev = code[i - 1];
+        bool exponent_sign = (c == '+' || c == '-') && (prev == 'e' || prev == 'E' || prev == 'p' || prev == 'P');
+        if (!is_word_char(c) && c != '.' && !exponent_sign) {
+            break;
+        }
+    }
+    
+    return i;
+}
+
+// Write a token wrapped in a span of its class
+static void write_token(xo_writer_t *out, const char *class_name, const char *text, size_t length) {
+    xo_writer_append(out, "<span class=\"hl-", 16);
+    xo_writer_append_str(out, class_name);
+    xo_writer_append(out, "\">", 2);
+    xo_writer_append_escaped(out, text, length, false);
+    xo_writer_append(out, "</span>", 7);
+}
+
+// Write code as HTML with its comments, strings, numbers, keywords, types
+// and preprocessor lines or decorators in spans of class hl-comment,
+// hl-string, hl-number, hl-keyword, hl-type and hl-meta. Text between tokens
+// is escaped in runs.
+int xo_highlight_tokenize(const xo_highlight_language_t *language, const char *code, size_t length, xo_writer_t *out) {
+    if (!language || !code || !out) {
+        return XO_ERROR_MEMORY_ALLOCATION;
+    }
+    
+    size_t plain = 0;
+    size_t i = 0;
+    bool line_start = true;
+    
+    while (i < length) {
+        char c = code[i];
+        const char *class_name = NULL;
+        size_t end = i + 1;
+        
+        if (c == '\n' || c == ' ' || c == '\t') {
+            line_start = line_start || c == '\n';
+            i++;
+            continue;
+        }
+        
+        if (line_start && language->meta && c == language->meta) {
+            class_name = "meta";
+            if (language->meta_line) {
+                end = line_end(code, i, length);
+            } else {
+                while (end < length && (is_word_char(code[end]) || code[end] == '.')) {
+                    end++;
+                }
+            }
+        } else if (language->block_comment_open && starts_with(code, i, length, language->block_comment_open)) {
+            class_name = "comment";
+            end = closed_by(code, i + strlen(language->block_comment_open), length, language->block_comment_close);
+        } else if (language->line_comment && starts_with(code, i, length, language->line_comment) &&
+                   (!language->comment_at_word || i == 0 || isspace((unsigned char)code[i - 1]))) {
+            class_name = "comment";
+            end = line_end(code, i, length);
+        } else if (language->triple_quotes && (starts_with(code, i, length, "\"\"\"") ||
+                                               starts_with(code, i, length, "'''"))) {
+            class_name = "string";
+            end = closed_by(code, i + 3, length, c == '"' ? "\"\"\"" : "'''");
+        } else if (strchr(language->quotes, c)) {
+            class_name = "string";
+            end = string_end(code, i, length, c, strchr(language->multiline_quotes, c) != NULL);
+        } else if (isdigit((unsigned char)c) || (c == '.' && i + 1 < length && isdigit((unsigned char)code[i + 1]))) {
+            class_name = "number";
+            end = number_end(code, i, length);
+        } else if (is_word_start(c)) {
+            while (end < length && is_word_char(code[end])) {
+                end++;
+            }
+            if (in_table(language->keywords, language->keyword_count, code + i, end - i)) {
+                class_name = "keyword";
+            } else if (in_table(language->types, language->type_count, code + i, end - i)) {
+                class_name = "type";
+            }
+        }
+        
+        line_start = false;
+        
+        if (class_name) {
+            xo_writer_append_escaped(out, code + plain, i - plain, false);
+            write_token(out, class_name, code + i, end - i);
+            plain = end;
+        }
+        i = end;
+    }
+    
+    xo_writer_append_escaped(out, code + plain, length - plain, false);
+    
+    return out->failed ? XO_ERROR_MEMORY_ALLOCATION : XO_SUCCESS;
+}
+
+// Initialize a highlight cache
+int xo_highlight_cache_init(xo_highlight_cache_t *cache) {
+    if (!cache) {
+        return XO_ERROR_MEMORY_ALLOCATION;
+    }
+    
+    cache->entries = NULL;
+    cache->count = 0;
+    cache->capacity = 0;
+    cache->index = NULL;
+    cache->index_capacity = 0;
+    cache->data = NULL;
+    cache->dirty = false;
+    
+    // The cache is consulted and updated by all build workers
+    mutex_t *lock = malloc(sizeof(mutex_t));
+    if (!lock) {
+        cache->lock = NULL;
+        return XO_ERROR_MEMORY_ALLOCATION;
+    }
+    mutex_init(lock);
+    cache->lock = lock;
+    
+    return XO_SUCCESS;
+}
+
+// Free resources used by a highlight cache
+void xo_highlight_cache_free(xo_highlight_cache_t *cache) {
+    if (!cache) {
+        return;
+    }
+    
+    for (size_t i = 0; i < cache->count; i++) {
+        if (cache->entries[i].owned) {
+            free((char *)cache->entries[i].html);
+        }
+    }
+    
+    free(cache->entries);
+    free(cache->index);
+    free(cache->data);
+    
+    if (cache->lock) {
+        mutex_destroy((mutex_t *)cache->lock);
+        free(cache->lock);
+    }
+    
+    cache->entries = NULL;
+    cache->count = 0;
+    cache->capacity = 0;
+    cache->index = NULL;
+    cache->index_capacity = 0;
+    cache->data = NULL;
+    cache->dirty = false;
+    cache->lock = NULL;
+}
+
+// Key of a snippet, the canonical language name keeps aliases on one entry
+static void snippet_key(const xo_highlight_language_t *language, const char *code, size_t length, uint64_t key[2]) {
+    size_t name_length = strlen(language->name);
+    key[0] = xo_utils_hash64(code, length, xo_utils_hash64(language->name, name_length, 0));
+    key[1] = xo_utils_hash64(code, length, xo_utils_hash64(language->name, name_length, 0x9e3779b97f4a7c15ULL));
+}
+
+// Find the entry of a key (caller holds the cache lock)
+static xo_highlight_entry_t *cache_find_locked(const xo_highlight_cache_t *cache, const uint64_t key[2]) {
+    if (cache->index_capacity == 0) {
+        return NULL;
+    }
+    
+    size_t mask = cache->index_capacity - 1;
+    size_t slot = (size_t)key[0] & mask;
+    
+    while (cache->index[slot] != 0) {
+        xo_highlight_entry_t *entry = &cache->entries[cache->index[slot] - 1];
+        if (entry->key[0] == key[0] && entry->key[1] == key[1]) {
+            return entry;
+        }
+        slot = (slot + 1) & mask;
+    }
+    
+    return NULL;
+}
+
+// Grow the index so it stays at most half full (caller holds the cache lock)
+static int cache_grow_index_locked(xo_highlight_cache_t *cache) {
+    size_t new_capacity = cache->index_capacity == 0 ? 16 : cache->index_capacity * 2;
+    size_t *new_index = calloc(new_capacity, sizeof(size_t));
+    if (!new_index) {
+        return XO_ERROR_MEMORY_ALLOCATION;
+    }
+    
+    size_t mask = new_capacity - 1;
+    for (size_t i = 0; i < cache->count; i++) {
+        size_t slot = (size_t)cache->entries[i].key[0] & mask;
+        while (new_index[slot] != 0) {
+            slot = (slot + 1) & mask;
+        }
+        new_index[slot] = i + 1;
+    }
+    
+    free(cache->index);
+    cache->index = new_index;
+    cache->index_capacity = new_capacity;
+    
+    return XO_SUCCESS;
+}
+
+// Add an entry unless the key is already cached (caller holds the cache lock).
+// Returns XO_SUCCESS without taking html when the key was already there.
+static int cache_add_locked(xo_highlight_cache_t *cache, const uint64_t key[2], const char *html, size_t length,
+                            bool owned, bool *taken) {
+    *taken = false;
+    if (cache_find_locked(cache, key)) {
+        return XO_SUCCESS;
+    }
+    
+    // Check if we need to resize the array
+    if (cache->count >= cache->capacity) {
+        size_t new_capacity = cache->capacity == 0 ? 8 : cache->capacity * 2;
+        xo_highlight_entry_t *new_entries = realloc(cache->entries, new_capacity * sizeof(xo_highlight_entry_t));
+        if (!new_entries) {
+            return XO_ERROR_MEMORY_ALLOCATION;
+        }
+        
+        cache->entries = new_entries;
+        cache->capacity = new_capacity;
+    }
+    
+    if ((cache->count + 1) * 2 > cache->index_capacity && cache_grow_index_locked(cache) != XO_SUCCESS) {
+        return XO_ERROR_MEMORY_ALLOCATION;
+    }
+    
+    xo_highlight_entry_t *entry = &cache->entries[cache->count];
+    entry->key[0] = key[0];
+    entry->key[1] = key[1];
+    entry->html = html;
+    entry->length = length;
+    entry->owned = owned;
+    entry->used = owned;
+    
+    size_t mask = cache->index_capacity - 1;
+    size_t slot = (size_t)key[0] & mask;
+    while (cache->index[slot] != 0) {
+        slot = (slot + 1) & mask;
+    }
+    cache->index[slot] = cache->count + 1;
+    
+    cache->count++;
+    *taken = true;
+    
+    return XO_SUCCESS;
+}
+
+// Write code as HTML, highlighted when the language is known and escaped
+// otherwise. With a cache, a snippet seen before is copied from the cache and
+// a new one is tokenized once and added to it.
+int xo_highlight_to_html(xo_highlight_cache_t *cache, const char *language, size_t language_len, const char *code,
+                         size_t length, xo_writer_t *out) {
+    if (!code || !out) {
+        return XO_ERROR_MEMORY_ALLOCATION;
+    }
+    
+    const xo_highlight_language_t *lang = xo_highlight_find_language(language, language_len);
+    if (!lang) {
+        return xo_writer_append_escaped(out, code, length, false);
+    }
+    if (!cache) {
+        return xo_highlight_tokenize(lang, code, length, out);
+    }
+    
+    uint64_t key[2];
+    snippet_key(lang, code, length, key);
+    
+    // Cached HTML is never freed before the cache, so it is copied unlocked
+    const char *html = NULL;
+    size_t html_length = 0;
+    mutex_lock((mutex_t *)cache->lock);
+    xo_highlight_entry_t *entry = cache_find_locked(cache, key);
+    if (entry) {
+        entry->used = true;
+        html = entry->html;
+        html_length = entry->length;
+    }
+    mutex_unlock((mutex_t *)cache->lock);
+    
+    if (html) {
+        return xo_writer_append(out, html, html_length);
+    }
+    
+    // Tokenize straight into the output and keep a copy of what was written
+    size_t start = out->length;
+    int result = xo_highlight_tokenize(lang, code, length, out);
+    if (result != XO_SUCCESS) {
+        return result;
+    }
+    
+    html_length = out->length - start;
+    char *copy = malloc(html_length + 1);
+    if (!copy) {
+        return XO_SUCCESS;
+    }
+    memcpy(copy, out->data + start, html_length);
+    
+    bool taken;
+    mutex_lock((mutex_t *)cache->lock);
+    cache_add_locked(cache, key, copy, html_length, true, &taken);
+    cache->dirty = cache->dirty || taken;
+    mutex_unlock((mutex_t *)cache->lock);
+    
+    if (!taken) {
+        free(copy);
+    }
+    
+    return XO_SUCCESS;
+}
+
+// Read a whole file, which may hold any bytes
+static char *read_binary_file(const char *path, size_t *length) {
+    FILE *file = fopen(path, "rb");
+    if (!file) {
+        return NULL;
+    }
+    
+    fseek(file, 0, SEEK_END);
+    long file_size = ftell(file);
+    rewind(file);
+    
+    char *data = file_size >= 0 ? malloc((size_t)file_size + 1) : NULL;
+    if (!data) {
+        fclose(file);
+        return NULL;
+    }
+    
+    size_t read_size = fread(data, 1, (size_t)file_size, file);
+    fclose(file);
+    
+    if (read_size != (size_t)file_size) {
+        free(data);
+        return NULL;
+    }
+    
+    data[read_size] = '\0';
+    *length = read_size;
+    
+    return data;
+}
+
+// Parse 16 hex digits
+static bool parse_hex64(const char *hex, uint64_t *value) {
+    *value = 0;
+    for (int i = 0; i < 16; i++) {
+        int digit = isdigit((unsigned char)hex[i]) ? hex[i] - '0' :
+                    (hex[i] >= 'a' && hex[i] <= 'f') ? hex[i] - 'a' + 10 : -1;
+        if (digit < 0) {
+            return false;
+        }
+        *value = (*value << 4) | (uint64_t)digit;
+    }
+    
+    return true;
+}
+
+// Load a highlight cache written by xo_highlight_cache_save into an empty
+// cache. The HTML of loaded entries points into the file's data.
+int xo_highlight_cache_load(xo_highlight_cache_t *cache, const char *cache_path) {
+    if (!cache || !cache_path || !cache->lock || cache->data) {
+        return XO_ERROR_MEMORY_ALLOCATION;
+    }
+    
+    size_t length;
+    char *data = read_binary_file(cache_path, &length);
+    if (!data) {
+        return XO_ERROR_FILE_NOT_FOUND;
+    }
+    
+    // Reject caches written by an incompatible version
+    size_t header_length = strlen(HIGHLIGHT_CACHE_HEADER);
+    if (length < header_length || memcmp(data, HIGHLIGHT_CACHE_HEADER, header_length) != 0) {
+        free(data);
+        return XO_ERROR_INVALID_FORMAT;
+    }
+    
+    mutex_lock((mutex_t *)cache->lock);
+    cache->data = data;
+    
+    // Each entry is "<key> <length>\n" followed by the HTML and a newline
+    int result = XO_SUCCESS;
+    size_t pos = header_length;
+    while (pos < length && result == XO_SUCCESS) {
+        uint64_t key[2];
+        char *length_end;
+        if (length - pos < 34 || !parse_hex64(data + pos, &key[0]) || !parse_hex64(data + pos + 16, &key[1]) ||
+            data[pos + 32] != ' ') {
+            result = XO_ERROR_INVALID_FORMAT;
+            break;
+        }
+        
+        unsigned long long html_length = strtoull(data + pos + 33, &length_end, 10);
+        size_t html_start = (size_t)(length_end - data) + 1;
+        if (*length_end != '\n' || html_length > length - html_start || data[html_start + html_length] != '\n') {
+            result = XO_ERROR_INVALID_FORMAT;
+            break;
+        }
+        
+        bool taken;
+        result = cache_add_locked(cache, key, data + html_start, (size_t)html_length, false, &taken);
+        pos = html_start + (size_t)html_length + 1;
+    }
+    
+    mutex_unlock((mutex_t *)cache->lock);
+    
+    return result;
+}
+
+// qsort comparator ordering entries by key
+static int compare_entries(const void *a, const void *b) {
+    const xo_highlight_entry_t *entry_a = *(const xo_highlight_entry_t *const *)a;
+    const xo_highlight_entry_t *entry_b = *(const xo_highlight_entry_t *const *)b;
+    if (entry_a->key[0] != entry_b->key[0]) {
+        return entry_a->key[0] < entry_b->key[0] ? -1 : 1;
+    }
+    
+    return entry_a->key[1] < entry_b->key[1] ? -1 : entry_a->key[1] > entry_b->key[1];
+}
+
+// Save the highlight cache when it changed. With prune set, snippets not used
+// since the cache was loaded are dropped, which is only right after a build
+// that converted every page.
+int xo_highlight_cache_save(xo_highlight_cache_t *cache, const char *cache_path, bool prune) {
+    if (!cache || !cache_path || !cache->lock) {
+        return XO_ERROR_MEMORY_ALLOCATION;
+    }
+    
+    mutex_lock((mutex_t *)cache->lock);
+    
+    const xo_highlight_entry_t **sorted = NULL;
+    size_t sorted_count = 0;
+    if (cache->count > 0) {
+        sorted = malloc(cache->count * sizeof(xo_highlight_entry_t *));
+        if (!sorted) {
+            mutex_unlock((mutex_t *)cache->lock);
+            return XO_ERROR_MEMORY_ALLOCATION;
+        }
+        
+        for (size_t i = 0; i < cache->count; i++) {
+            if (!prune || cache->entries[i].used) {
+                sorted[sorted_count++] = &cache->entries[i];
+            }
+        }
+    }
+    
+    // Nothing to write when no snippet was added or dropped
+    if (!cache->dirty && sorted_count == cache->count) {
+        mutex_unlock((mutex_t *)cache->lock);
+        free(sorted);
+        return XO_SUCCESS;
+    }
+    
+    if (sorted_count > 1) {
+        qsort(sorted, sorted_count, sizeof(xo_highlight_entry_t *), compare_entries);
+    }
+    
+    char *cache_dir = xo_utils_dirname(cache_path);
+    if (!cache_dir || xo_utils_mkdir_p(cache_dir) != 0) {
+        free(cache_dir);
+        mutex_unlock((mutex_t *)cache->lock);
+        free(sorted);
+        return XO_ERROR_FILE_NOT_FOUND;
+    }
+    free(cache_dir);
+    
+    // Write to a temporary file and rename it so a crash never leaves a torn cache
+    char temp_path[XO_MAX_PATH];
+    snprintf(temp_path, sizeof(temp_path), "%s.tmp", cache_path);
+    
+    FILE *file = fopen(temp_path, "wb");
+    if (!file) {
+        mutex_unlock((mutex_t *)cache->lock);
+        free(sorted);
+        return XO_ERROR_FILE_NOT_FOUND;
+    }
+    
+    bool write_ok = fputs(HIGHLIGHT_CACHE_HEADER, file) >= 0;
+    for (size_t i = 0; i < sorted_count && write_ok; i++) {
+        char key[2 * XO_HASH_HEX_LEN + 1];
+        xo_utils_hash_to_hex(sorted[i]->key[0], key);
+        xo_utils_hash_to_hex(sorted[i]->key[1], key + XO_HASH_HEX_LEN);
+        write_ok = fprintf(file, "%s %zu\n", key, sorted[i]->length) > 0 &&
+                   fwrite(sorted[i]->html, 1, sorted[i]->length, file) == sorted[i]->length &&
+                   fputc('\n', file) != EOF;
+    }
+    
+    if (write_ok) {
+        cache->dirty = false;
+    }
+    
+    mutex_unlock((mutex_t *)cache->lock);
+    free(sorted);
+    
+    if (fclose(file) != 0 || !write_ok) {
+        remove(temp_path);
+        return XO_ERROR_FILE_NOT_FOUND;
+    }
+    
+    remove(cache_path);
+    if (rename(temp_path, cache_path) != 0) {
+        remove(temp_path);
+        return XO_ERROR_FILE_NOT_FOUND;
+    }
+    
+    return XO_SUCCESS;
+}
@@ -3,6 +3,7 @@
 #include <string.h>
 #include "xo.h"
 #include "utils.h"
+#include "profile.h"
 
 // Parse command-line arguments and fill the configuration
 static int parse_arguments(int argc, char *argv[], xo_config_t *config) {
@@ -11,10 +12,25 @@ static int parse_arguments(int argc, char *argv[], xo_config_t *config) {
     strcpy(config->content_dir, "content");
     strcpy(config->layouts_dir, "layouts");
     strcpy(config->output_dir, "dist");
+    strcpy(config->cache_dir, ".xo-cache");
     config->server_port = 3000;
+    config->jobs = 0;         // One build worker per CPU
+    config->queue_depth = 0;  // Twice the number of build workers
+    config->max_inflight_mb = 64;
     config->clean_build = false;
+    config->always_write = false;
+    config->profile = false;
+    config->profile_top = XO_PROFILE_TOP_PAGES;
+    config->profile_path[0] = '\0';
     config->running = false;  // Initialize running flag
     config->user_data = NULL; // Initialize user data
+    config->layout_cache = NULL;
+    config->partials = NULL;
+    config->markdown_cache = NULL;
+    config->highlight_cache = NULL;
+    config->dependencies = NULL;
+    config->build_cache = NULL;
+    config->frontmatter_hashes = NULL;
 
     // Parse arguments
     for (int i = 1; i < argc; i++) {
@@ -28,8 +44,26 @@ static int parse_arguments(int argc, char *argv[], xo_config_t *config) {
             config->command = XO_CMD_HELP;
         } else if (strcmp(argv[i], "--port") == 0 && i + 1 < argc) {
             config->server_port = atoi(argv[++i]);
+        } else if ((strcmp(argv[i], "-j") == 0 || strcmp(argv[i], "--jobs") == 0) && i + 1 < argc) {
+            config->jobs = atoi(argv[++i]);
+        } else if (strncmp(argv[i], "-j", 2) == 0 && argv[i][2] != '\0') {
+            config->jobs = atoi(argv[i] + 2);
+        } else if (strcmp(argv[i], "--queue-depth") == 0 && i + 1 < argc) {
+            config->queue_depth = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--max-inflight-mb") == 0 && i + 1 < argc) {
+            config->max_inflight_mb = atoi(argv[++i]);
         } else if (strcmp(argv[i], "--clean") == 0) {
             config->clean_build = true;
+        } else if (strcmp(argv[i], "--always-write") == 0) {
+            config->always_write = true;
+        } else if (strcmp(argv[i], "--profile") == 0) {
+            config->profile = true;
+        } else if (strcmp(argv[i], "--profile-json") == 0 && i + 1 < argc) {
+            config->profile = true;
+            strncpy(config->profile_path, argv[++i], XO_MAX_PATH - 1);
+            config->profile_path[XO_MAX_PATH - 1] = '\0';
+        } else if (strcmp(argv[i], "--profile-top") == 0 && i + 1 < argc) {
+            config->profile_top = atoi(argv[++i]);
         }
     }
 
@@ -48,7 +82,14 @@ void xo_print_help(void) {
     printf("  help      Show this help\n\n");
     printf("Options:\n");
     printf("  --port    Set development server port\n");
-    printf("  --clean   Remove build directory before build\n");
+    printf("  --clean   Rebuild every page, ignoring the build cache\n");
+    printf("  -j N      Build with N render threads, reading and writing scale with it (default: one per CPU)\n");
+    printf("  --queue-depth N      Pages buffered between read, render and write stages\n");
+    printf("  --max-inflight-mb N  Memory budget for pages in the build pipeline (default: 64, 0 for unlimited)\n");
+    printf("  --always-write  Rewrite output files even when their content is unchanged\n");
+    printf("  --profile       Print per-stage build timings and the slowest pages\n");
+    printf("  --profile-json FILE  Also write the profile as JSON to FILE (implies --profile)\n");
+    printf("  --profile-top N      Slowest pages listed in the profile (default: 10)\n");
 }
 
 // Main entry point
@@ -4,6 +4,53 @@
 #include <ctype.h>
 #include "markdown.h"
 #include "utils.h"
+#include "scan.h"
+#include "writer.h"
+
+#ifdef _WIN32
+    #include <windows.h>
+    #include <io.h>
+#else
+    #include <sys/mman.h>
+    #include <unistd.h>
+#endif
+
+// Map length bytes of an open file read-only, NULL when the file can't be mapped
+static const char *map_file(FILE *file, size_t length) {
+#ifdef _WIN32
+    HANDLE handle = (HANDLE)_get_osfhandle(_fileno(file));
+    HANDLE mapping = CreateFileMappingA(handle, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (!mapping) {
+        return NULL;
+    }
+    
+    // The view keeps the file mapped after the mapping handle is closed
+    const char *data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, length);
+    CloseHandle(mapping);
+    
+    return data;
+#else
+    void *data = mmap(NULL, length, PROT_READ, MAP_PRIVATE, fileno(file), 0);
+    if (data == MAP_FAILED) {
+        return NULL;
+    }
+    
+    // Blocks are parsed front to back
+    madvise(data, length, MADV_SEQUENTIAL);
+    
+    return data;
+#endif
+}
+
+// Release a mapping made by map_file
+static void unmap_file(const char *data, size_t length) {
+#ifdef _WIN32
+    (void)length;
+    UnmapViewOfFile(data);
+#else
+    munmap((void *)data, length);
+#endif
+}
 
 // Initialize a markdown structure
 int xo_markdown_init(xo_markdown_t *md) {
@@ -17,7 +64,13 @@ int xo_markdown_init(xo_markdown_t *md) {
     md->frontmatter.capacity = 0;
     
     // Initialize content
-    md->content = NULL;
+    md->content.data = NULL;
+    md->content.length = 0;
+    md->source = NULL;
+    md->source_length = 0;
+    md->mapped = false;
+    md->arena = NULL;
+    md->highlights = NULL;
     
     return XO_SUCCESS;
 }
@@ -28,35 +81,43 @@ void xo_markdown_free(xo_markdown_t *md) {
         return;
     }
     
-    // Free frontmatter items
-    for (size_t i = 0; i < md->frontmatter.count; i++) {
-        free(md->frontmatter.items[i].key);
-        free(md->frontmatter.items[i].value);
+    // A mapping is released even when the rest belongs to an arena
+    if (md->mapped) {
+        unmap_file(md->source, md->source_length);
     }
     
-    // Free frontmatter array
-    free(md->frontmatter.items);
+    // Memory owned by an arena is released with the arena
+    if (md->arena) {
+        xo_markdown_init(md);
+        return;
+    }
     
-    // Free content
-    free(md->content);
+    // Keys, values and content all point into the source
+    free(md->frontmatter.items);
+    if (!md->mapped) {
+        free((char *)md->source);
+    }
     
     // Reset structure
-    md->frontmatter.items = NULL;
-    md->frontmatter.count = 0;
-    md->frontmatter.capacity = 0;
-    md->content = NULL;
+    xo_markdown_init(md);
 }
 
-// Add an item to the frontmatter
-static int xo_frontmatter_add(xo_frontmatter_t *frontmatter, const char *key, const char *value) {
-    if (!frontmatter || !key || !value) {
+// Add an item to the frontmatter, allocating from the arena when one is given
+static int xo_frontmatter_add(xo_frontmatter_t *frontmatter, xo_arena_t *arena, xo_span_t key, xo_span_t value) {
+    if (!frontmatter) {
         return XO_ERROR_MEMORY_ALLOCATION;
     }
     
     // Check if we need to resize the array
     if (frontmatter->count >= frontmatter->capacity) {
         size_t new_capacity = frontmatter->capacity == 0 ? 8 : frontmatter->capacity * 2;
-        xo_frontmatter_item_t *new_items = realloc(frontmatter->items, new_capacity * sizeof(xo_frontmatter_item_t));
+        xo_frontmatter_item_t *new_items;
+        if (arena) {
+            new_items = xo_arena_realloc(arena, frontmatter->items, frontmatter->capacity * sizeof(xo_frontmatter_item_t),
+                                         new_capacity * sizeof(xo_frontmatter_item_t));
+        } else {
+            new_items = realloc(frontmatter->items, new_capacity * sizeof(xo_frontmatter_item_t));
+        }
         
         if (!new_items) {
             return XO_ERROR_MEMORY_ALLOCATION;
@@ -67,315 +128,910 @@ static int xo_frontmatter_add(xo_frontmatter_t *frontmatter, const char *key, co
     }
     
     // Add the new item
-    frontmatter->items[frontmatter->count].key = xo_utils_strdup(key);
-    frontmatter->items[frontmatter->count].value = xo_utils_strdup(value);
+    frontmatter->items[frontmatter->count].key = key;
+    frontmatter->items[frontmatter->count].value = value;
+    frontmatter->count++;
     
-    if (!frontmatter->items[frontmatter->count].key || !frontmatter->items[frontmatter->count].value) {
-        free(frontmatter->items[frontmatter->count].key);
-        free(frontmatter->items[frontmatter->count].value);
-        return XO_ERROR_MEMORY_ALLOCATION;
+    return XO_SUCCESS;
+}
+
+// Read a whole file into arena memory, or into malloc'd memory without an arena.
+// With allow_map, files of XO_MARKDOWN_MAP_THRESHOLD bytes or more are mapped
+// instead, so they are parsed in place without a heap copy.
+static const char *read_file(const char *filepath, xo_arena_t *arena, bool allow_map, size_t *length, bool *mapped) {
+    FILE *file = fopen(filepath, "rb");
+    if (!file) {
+        return NULL;
     }
     
-    frontmatter->count++;
+    // Determine file size
+    fseek(file, 0, SEEK_END);
+    long file_size = ftell(file);
+    rewind(file);
     
-    return XO_SUCCESS;
+    if (file_size < 0) {
+        fclose(file);
+        return NULL;
+    }
+    
+    *mapped = false;
+    if (allow_map && (size_t)file_size >= XO_MARKDOWN_MAP_THRESHOLD) {
+        const char *data = map_file(file, (size_t)file_size);
+        if (data) {
+            fclose(file);
+            *mapped = true;
+            *length = (size_t)file_size;
+            return data;
+        }
+    }
+    
+    char *buffer = arena ? xo_arena_alloc(arena, (size_t)file_size + 1) : malloc((size_t)file_size + 1);
+    if (!buffer) {
+        fclose(file);
+        return NULL;
+    }
+    
+    size_t read_size = fread(buffer, 1, (size_t)file_size, file);
+    buffer[read_size] = '\0';
+    
+    fclose(file);
+    
+    if (read_size != (size_t)file_size) {
+        if (!arena) {
+            free(buffer);
+        }
+        return NULL;
+    }
+    
+    *length = read_size;
+    return buffer;
 }
 
-// Basic implementation of frontmatter parsing
-// This is a simplified version for now
+// Span of [start, end) with surrounding whitespace removed
+static xo_span_t trimmed_span(const char *start, const char *end) {
+    while (start < end && isspace((unsigned char)*start)) {
+        start++;
+    }
+    while (end > start && isspace((unsigned char)*(end - 1))) {
+        end--;
+    }
+    
+    xo_span_t span = { start, (size_t)(end - start) };
+    return span;
+}
+
+// Find the first "---" in [p, end)
+static const char *find_dashes(const char *p, const char *end) {
+    while (end - p >= 3) {
+        p = xo_scan_byte(p, end - 2, '-');
+        if (p == end - 2) {
+            break;
+        }
+        if (p[1] == '-' && p[2] == '-') {
+            return p;
+        }
+        p++;
+    }
+    
+    return NULL;
+}
+
+// Bytes read at a time when only the frontmatter of a file is read
+#define XO_FRONTMATTER_CHUNK 4096
+
+// Read the start of a file up to the dashes closing its frontmatter, or just
+// the first chunk when it has none
+static char *read_file_head(const char *filepath, xo_arena_t *arena, size_t *length) {
+    FILE *file = fopen(filepath, "rb");
+    if (!file) {
+        return NULL;
+    }
+    
+    char *buffer = NULL;
+    size_t capacity = 0;
+    size_t used = 0;
+    
+    for (;;) {
+        if (capacity - used < XO_FRONTMATTER_CHUNK + 1) {
+            size_t new_capacity = capacity == 0 ? XO_FRONTMATTER_CHUNK + 1 : capacity * 2;
+            char *new_buffer = arena ? xo_arena_realloc(arena, buffer, capacity, new_capacity) :
+                                       realloc(buffer, new_capacity);
+            if (!new_buffer) {
+                if (!arena) {
+                    free(buffer);
+                }
+                fclose(file);
+                return NULL;
+            }
+            
+            buffer = new_buffer;
+            capacity = new_capacity;
+        }
+        
+        size_t read_size = fread(buffer + used, 1, XO_FRONTMATTER_CHUNK, file);
+        used += read_size;
+        
+        // Stop at the end of the file, or once the frontmatter is known to be
+        // missing or complete
+        if (read_size < XO_FRONTMATTER_CHUNK || memcmp(buffer, "---", 3) != 0 ||
+            find_dashes(buffer + 3, buffer + used)) {
+            break;
+        }
+    }
+    
+    fclose(file);
+    
+    buffer[used] = '\0';
+    *length = used;
+    return buffer;
+}
+
+// Parse the frontmatter at the start of a source into md, returning where the
+// content starts or NULL when out of memory
+static const char *parse_frontmatter(xo_markdown_t *md, const char *source, const char *end) {
+    size_t source_length = (size_t)(end - source);
+    
+    // Check for frontmatter (delimited by ---)
+    if (source_length < 3 || memcmp(source, "---", 3) != 0) {
+        return source;
+    }
+    
+    // Found frontmatter start
+    const char *frontmatter_end = find_dashes(source + 3, end);
+    if (!frontmatter_end) {
+        return source;
+    }
+    
+    // Simple line-by-line parsing, skipping "---\n"
+    const char *line = source + 4 < frontmatter_end ? source + 4 : frontmatter_end;
+    
+    while (line < frontmatter_end) {
+        // Find the end of the line
+        const char *line_end = xo_scan_byte(line, frontmatter_end, '\n');
+        
+        // Split at the colon separator and add to frontmatter
+        const char *colon = memchr(line, ':', (size_t)(line_end - line));
+        if (colon) {
+            if (xo_frontmatter_add(&md->frontmatter, md->arena, trimmed_span(line, colon),
+                                   trimmed_span(colon + 1, line_end)) != XO_SUCCESS) {
+                return NULL;
+            }
+        }
+        
+        line = line_end + 1;
+    }
+    
+    // Content starts after frontmatter, skipping "---\n"
+    return end - frontmatter_end > 4 ? frontmatter_end + 4 : end;
+}
+
+// Parse a markdown file
 int xo_markdown_parse_file(const char *filepath, xo_markdown_t *md) {
+    return xo_markdown_parse_file_arena(filepath, NULL, md);
+}
+
+// Basic implementation of frontmatter parsing
+// This is a simplified version for now. The source is read once and never
+// modified, frontmatter keys, values and the content are spans into it, so
+// the only memory beyond the file itself is the frontmatter item array. With
+// an arena both come from the arena, except for large sources when allow_map
+// is set, which are mapped.
+static int parse_file(const char *filepath, xo_arena_t *arena, bool allow_map, xo_markdown_t *md) {
     if (!filepath || !md) {
         return XO_ERROR_MEMORY_ALLOCATION;
     }
     
     // Read the file content
-    char *file_content = xo_utils_read_file(filepath);
-    if (!file_content) {
+    size_t source_length;
+    bool mapped;
+    const char *source = read_file(filepath, arena, allow_map, &source_length, &mapped);
+    if (!source) {
         return XO_ERROR_FILE_NOT_FOUND;
     }
     
     // Initialize the markdown structure
     xo_markdown_init(md);
+    md->arena = arena;
+    md->source = source;
+    md->source_length = source_length;
+    md->mapped = mapped;
     
-    // Check for frontmatter (delimited by ---)
-    char *content_start = file_content;
-    if (strncmp(content_start, "---", 3) == 0) {
-        // Found frontmatter start
-        char *frontmatter_end = strstr(content_start + 3, "---");
-        if (frontmatter_end) {
-            // Extract and parse frontmatter
-            *frontmatter_end = '\0';  // Temporarily terminate frontmatter
-            
-            // Simple line-by-line parsing
-            char *line = content_start + 4;  // Skip "---\n"
-            char *next_line;
-            
-            while (line && *line) {
-                // Find the end of the line
-                next_line = strchr(line, '\n');
-                if (next_line) {
-                    *next_line = '\0';  // Temporarily terminate the line
-                }
-                
-                // Process the line if it's not empty
-                if (*line) {
-                    // Find the colon separator
-                    char *colon = strchr(line, ':');
-                    if (colon) {
-                        *colon = '\0';  // Temporarily terminate the key
-                        char *key = line;
-                        char *value = colon + 1;
-                        
-                        // Trim whitespace
-                        xo_utils_str_trim(key);
-                        xo_utils_str_trim(value);
-                        
-                        // Add to frontmatter
-                        xo_frontmatter_add(&md->frontmatter, key, value);
-                        
-                        // Restore the colon
-                        *colon = ':';
-                    }
-                }
-                
-                // Restore the newline and move to the next line
-                if (next_line) {
-                    *next_line = '\n';
-                    line = next_line + 1;
-                } else {
-                    line = NULL;
-                }
-            }
-            
-            // Restore the frontmatter end marker
-            *frontmatter_end = '-';
-            
-            // Set content to start after frontmatter
-            content_start = frontmatter_end + 4;  // Skip "---\n"
-        }
+    const char *end = source + source_length;
+    const char *content_start = parse_frontmatter(md, source, end);
+    if (!content_start) {
+        xo_markdown_free(md);
+        return XO_ERROR_MEMORY_ALLOCATION;
+    }
+    
+    // The content runs to the end of the source, which keeps it NUL-terminated
+    // unless the source is mapped
+    md->content.data = content_start;
+    md->content.length = (size_t)(end - content_start);
+    
+    return XO_SUCCESS;
+}
+
+// Parse a markdown file with its source in the arena, large sources are mapped
+int xo_markdown_parse_file_arena(const char *filepath, xo_arena_t *arena, xo_markdown_t *md) {
+    return parse_file(filepath, arena, true, md);
+}
+
+// Parse a markdown file with its source always read into memory. A mapping
+// faults when the file is truncated while mapped, which an editor saving a
+// page the dev server is rebuilding can do.
+int xo_markdown_parse_file_unmapped(const char *filepath, xo_arena_t *arena, xo_markdown_t *md) {
+    return parse_file(filepath, arena, false, md);
+}
+
+// Parse only the frontmatter of a markdown file. The file is read no further
+// than the dashes closing the frontmatter and the content is left empty, for
+// collecting page metadata without loading whole pages.
+int xo_markdown_parse_frontmatter_file(const char *filepath, xo_arena_t *arena, xo_markdown_t *md) {
+    if (!filepath || !md) {
+        return XO_ERROR_MEMORY_ALLOCATION;
+    }
+    
+    size_t source_length;
+    const char *source = read_file_head(filepath, arena, &source_length);
+    if (!source) {
+        return XO_ERROR_FILE_NOT_FOUND;
     }
     
-    // Set the content
-    md->content = xo_utils_strdup(content_start);
-    if (!md->content) {
+    xo_markdown_init(md);
+    md->arena = arena;
+    md->source = source;
+    md->source_length = source_length;
+    
+    const char *end = source + source_length;
+    if (!parse_frontmatter(md, source, end)) {
         xo_markdown_free(md);
-        free(file_content);
         return XO_ERROR_MEMORY_ALLOCATION;
     }
     
-    free(file_content);
+    md->content.data = end;
+    md->content.length = 0;
+    
     return XO_SUCCESS;
 }
 
 // Get a frontmatter value by key
-const char *xo_markdown_get_frontmatter(const xo_markdown_t *md, const char *key) {
+const xo_span_t *xo_markdown_get_frontmatter(const xo_markdown_t *md, const char *key) {
     if (!md || !key) {
         return NULL;
     }
     
+    size_t key_len = strlen(key);
     for (size_t i = 0; i < md->frontmatter.count; i++) {
-        if (strcmp(md->frontmatter.items[i].key, key) == 0) {
-            return md->frontmatter.items[i].value;
+        const xo_span_t *item_key = &md->frontmatter.items[i].key;
+        if (item_key->length == key_len && memcmp(item_key->data, key, key_len) == 0) {
+            return &md->frontmatter.items[i].value;
         }
     }
     
     return NULL;
 }
 
-// Helper function to check if a line starts with a string
-static bool starts_with(const char *str, const char *prefix) {
-    return strncmp(str, prefix, strlen(prefix)) == 0;
+// Check whether a line of the given length starts with a prefix
+static bool line_starts_with(const char *line, size_t length, const char *prefix, size_t prefix_len) {
+    return length >= prefix_len && memcmp(line, prefix, prefix_len) == 0;
 }
 
-// Helper function to calculate required buffer size for a line
-static size_t html_line_size(const char *line) {
-    size_t line_len = strlen(line);
-    // Add extra space for potential HTML tags (rough estimate)
-    return line_len * 2 + 100;
+// Level of an ATX header line ("# " to "###### "), 0 when it is not one
+static int header_level(const char *line, size_t length) {
+    int level = 0;
+    while (level < 6 && (size_t)level < length && line[level] == '#') {
+        level++;
+    }
+    
+    return level > 0 && (size_t)level < length && line[level] == ' ' ? level : 0;
 }
 
-// Simple markdown to HTML conversion
-// This implements a basic subset of markdown (headers, paragraphs, bold, italic, lists)
-int xo_markdown_to_html(const xo_markdown_t *md, char **html_output) {
-    if (!md || !html_output) {
-        return XO_ERROR_MEMORY_ALLOCATION;
+// Length of the backtick run opening a code fence, 0 when the line doesn't
+// open one. The info string after the run can't contain backticks, a line
+// like ```foo`` is inline code.
+static size_t fence_length(const char *line, size_t length) {
+    size_t run = 0;
+    while (run < length && line[run] == '`') {
+        run++;
     }
     
-    const char *content = md->content ? md->content : "";
+    return run >= 3 && !memchr(line + run, '`', length - run) ? run : 0;
+}
+
+// Find the line closing a code fence opened with fence_len backticks in
+// [p, end): at least as many backticks at the start of the line, followed by
+// nothing but whitespace
+static const char *find_fence(const char *p, const char *end, size_t fence_len) {
+    while (p < end) {
+        const char *line_end = xo_scan_byte(p, end, '\n');
+        
+        size_t run = 0;
+        while (p + run < line_end && p[run] == '`') {
+            run++;
+        }
+        if (run >= fence_len) {
+            const char *rest = p + run;
+            while (rest < line_end && isspace((unsigned char)*rest)) {
+                rest++;
+            }
+            if (rest == line_end) {
+                return p;
+            }
+        }
+        
+        p = line_end < end ? line_end + 1 : end;
+    }
     
-    // Initial allocation - we'll resize as needed
-    size_t content_len = strlen(content);
-    size_t buffer_size = content_len * 2; // Rough estimation
-    char *html = (char *)malloc(buffer_size);
-    if (!html) {
-        return XO_ERROR_MEMORY_ALLOCATION;
+    return NULL;
+}
+
+// Trim a table row to its cells, dropping the outer pipes
+static void table_row_bounds(const char *line, const char *line_end, const char **start, const char **end) {
+    while (line < line_end && (*line == ' ' || *line == '\t')) {
+        line++;
+    }
+    while (line_end > line && isspace((unsigned char)line_end[-1])) {
+        line_end--;
     }
     
-    size_t html_len = 0;
-    html[0] = '\0';
+    if (line < line_end && *line == '|') {
+        line++;
+    }
+    if (line_end > line && line_end[-1] == '|' && (line_end - line < 2 || line_end[-2] != '\\')) {
+        line_end--;
+    }
     
-    // Process the markdown line by line
-    char *line_start = (char *)content;
-    char *next_line;
-    bool in_list = false;
+    *start = line;
+    *end = line_end;
+}
+
+// Split off the next cell of a row at p, trimmed. Cells are separated by
+// pipes that are not escaped with a backslash. Returns where the next cell
+// starts, NULL after the last cell, after which cells are empty.
+static const char *next_cell(const char *p, const char *end, xo_span_t *cell) {
+    if (!p) {
+        cell->data = end;
+        cell->length = 0;
+        return NULL;
+    }
     
-    while (line_start && *line_start) {
-        // Find the end of the line
-        next_line = strchr(line_start, '\n');
-        if (next_line) {
-            *next_line = '\0';  // Temporarily terminate the line
+    const char *pipe = p;
+    while ((pipe = xo_scan_byte(pipe, end, '|')) < end) {
+        const char *escape = pipe;
+        while (escape > p && escape[-1] == '\\') {
+            escape--;
         }
-        
-        // Process the line
-        char line_buffer[1024] = {0};
-        
-        // Trim trailing whitespace
-        char *line_end = line_start + strlen(line_start) - 1;
-        while (line_end >= line_start && isspace(*line_end)) {
-            *line_end = '\0';
-            line_end--;
+        if ((pipe - escape) % 2 == 0) {
+            break;
         }
+        pipe++;
+    }
+    
+    const char *cell_end = pipe;
+    while (p < cell_end && (*p == ' ' || *p == '\t')) {
+        p++;
+    }
+    while (cell_end > p && (cell_end[-1] == ' ' || cell_end[-1] == '\t')) {
+        cell_end--;
+    }
+    cell->data = p;
+    cell->length = (size_t)(cell_end - p);
+    
+    return pipe < end ? pipe + 1 : NULL;
+}
+
+// Number of cells in a table row
+static size_t count_cells(const char *line, const char *line_end) {
+    const char *start;
+    const char *end;
+    table_row_bounds(line, line_end, &start, &end);
+    
+    size_t count = 0;
+    xo_span_t cell;
+    for (const char *p = start; p; count++) {
+        p = next_cell(p, end, &cell);
+    }
+    
+    return count;
+}
+
+// Whether a line is the delimiter row of a table with the given number of
+// columns, made of cells like "---", ":--", "--:" or ":-:"
+static bool is_delimiter_row(const char *line, const char *line_end, size_t columns) {
+    const char *start;
+    const char *end;
+    table_row_bounds(line, line_end, &start, &end);
+    if (start == end) {
+        return false;
+    }
+    
+    size_t count = 0;
+    xo_span_t cell;
+    for (const char *p = start; p; count++) {
+        p = next_cell(p, end, &cell);
         
-        // Skip empty lines
-        if (strlen(line_start) == 0) {
-            if (in_list) {
-                // End the list if we were in one
-                strcpy(line_buffer, "</ul>\n");
-                in_list = false;
-            }
+        size_t i = 0;
+        if (i < cell.length && cell.data[i] == ':') {
+            i++;
         }
-        // Headers
-        else if (starts_with(line_start, "# ")) {
-            sprintf(line_buffer, "<h1>%s</h1>\n", line_start + 2);
+        size_t dashes = i;
+        while (i < cell.length && cell.data[i] == '-') {
+            i++;
         }
-        else if (starts_with(line_start, "## ")) {
-            sprintf(line_buffer, "<h2>%s</h2>\n", line_start + 3);
+        if (i == dashes) {
+            return false;
         }
-        else if (starts_with(line_start, "### ")) {
-            sprintf(line_buffer, "<h3>%s</h3>\n", line_start + 4);
+        if (i < cell.length && cell.data[i] == ':') {
+            i++;
         }
-        else if (starts_with(line_start, "#### ")) {
-            sprintf(line_buffer, "<h4>%s</h4>\n", line_start + 5);
+        if (i != cell.length) {
+            return false;
         }
-        else if (starts_with(line_start, "##### ")) {
-            sprintf(line_buffer, "<h5>%s</h5>\n", line_start + 6);
+    }
+    
+    return count == columns;
+}
+
+// Append one table row, cells beyond the header's columns are dropped and
+// missing ones are left empty. Each cell takes the alignment of the cell of
+// the delimiter row in its column.
+static void write_table_row(xo_writer_t *out, xo_markdown_inline_t *inlines, const char *line, const char *line_end,
+                            const char *delimiter, const char *delimiter_end, size_t columns, bool header) {
+    const char *start;
+    const char *end;
+    const char *align_start;
+    const char *align_end;
+    table_row_bounds(line, line_end, &start, &end);
+    table_row_bounds(delimiter, delimiter_end, &align_start, &align_end);
+    
+    xo_writer_append(out, "<tr>\n", 5);
+    
+    const char *p = start;
+    const char *align = align_start;
+    for (size_t column = 0; column < columns; column++) {
+        xo_span_t cell;
+        xo_span_t align_cell;
+        p = next_cell(p, end, &cell);
+        align = next_cell(align, align_end, &align_cell);
+        
+        bool left = align_cell.data[0] == ':';
+        bool right = align_cell.data[align_cell.length - 1] == ':';
+        xo_writer_append(out, header ? "<th" : "<td", 3);
+        if (left && right) {
+            xo_writer_append(out, " align=\"center\"", 15);
+        } else if (left) {
+            xo_writer_append(out, " align=\"left\"", 13);
+        } else if (right) {
+            xo_writer_append(out, " align=\"right\"", 14);
         }
-        else if (starts_with(line_start, "###### ")) {
-            sprintf(line_buffer, "<h6>%s</h6>\n", line_start + 7);
+        xo_writer_putc(out, '>');
+        xo_markdown_inline_to_html(inlines, cell.data, cell.length, out);
+        xo_writer_append(out, header ? "</th>\n" : "</td>\n", 6);
+    }
+    
+    xo_writer_append(out, "</tr>\n", 6);
+}
+
+// Append a table, its rows are converted one at a time as they are scanned
+static void write_table(xo_writer_t *out, xo_markdown_inline_t *inlines, const char *text, size_t length) {
+    const char *end = text + length;
+    const char *header_end = xo_scan_byte(text, end, '\n');
+    const char *delimiter = header_end + 1;
+    const char *delimiter_end = xo_scan_byte(delimiter, end, '\n');
+    size_t columns = count_cells(text, header_end);
+    
+    xo_writer_append(out, "<table>\n<thead>\n", 16);
+    write_table_row(out, inlines, text, header_end, delimiter, delimiter_end, columns, true);
+    xo_writer_append(out, "</thead>\n", 9);
+    
+    const char *row = delimiter_end < end ? delimiter_end + 1 : end;
+    if (row < end) {
+        xo_writer_append(out, "<tbody>\n", 8);
+        while (row < end) {
+            const char *row_end = xo_scan_byte(row, end, '\n');
+            write_table_row(out, inlines, row, row_end, delimiter, delimiter_end, columns, false);
+            row = row_end < end ? row_end + 1 : end;
         }
-        // List items
-        else if (starts_with(line_start, "- ") || starts_with(line_start, "* ")) {
-            if (!in_list) {
-                // Start a new list
-                strcpy(line_buffer, "<ul>\n");
-                strcat(line_buffer, "<li>");
-                strcat(line_buffer, line_start + 2);
-                strcat(line_buffer, "</li>\n");
-                in_list = true;
-            } else {
-                // Continue the list
-                strcpy(line_buffer, "<li>");
-                strcat(line_buffer, line_start + 2);
-                strcat(line_buffer, "</li>\n");
-            }
+        xo_writer_append(out, "</tbody>\n", 9);
+    }
+    
+    xo_writer_append(out, "</table>\n", 9);
+}
+
+// Whether a line interrupts a table, like a blank line or the start of another block
+static bool ends_table(const char *line, size_t length) {
+    while (length > 0 && isspace((unsigned char)line[length - 1])) {
+        length--;
+    }
+    
+    return length == 0 || header_level(line, length) > 0 || line_starts_with(line, length, "- ", 2) ||
+           line_starts_with(line, length, "* ", 2) || fence_length(line, length) > 0;
+}
+
+// Append an element wrapping one line of inline markdown
+static void write_element(xo_writer_t *out, xo_markdown_inline_t *inlines, const char *open, size_t open_len,
+                          const char *text, size_t text_len, const char *close, size_t close_len) {
+    xo_writer_append(out, open, open_len);
+    xo_markdown_inline_to_html(inlines, text, text_len, out);
+    xo_writer_append(out, close, close_len);
+}
+
+// Split off the block starting at line and return where the next one starts
+static const char *next_block(const char *line, const char *end, xo_markdown_block_t *block) {
+    // Find the end of the line
+    const char *line_end = xo_scan_byte(line, end, '\n');
+    const char *newline = line_end < end ? line_end : NULL;
+    const char *next = newline ? newline + 1 : end;
+    size_t length = (size_t)(line_end - line);
+    
+    // Trim trailing whitespace
+    while (length > 0 && isspace((unsigned char)line[length - 1])) {
+        length--;
+    }
+    
+    block->level = 0;
+    block->text.data = line;
+    block->text.length = length;
+    block->info.data = NULL;
+    block->info.length = 0;
+    
+    int level;
+    size_t fence;
+    
+    if (length == 0) {
+        block->type = XO_MD_BLOCK_BLANK;
+    } else if ((level = header_level(line, length)) > 0) {
+        block->type = XO_MD_BLOCK_HEADER;
+        block->level = level;
+        block->text.data = line + level + 1;
+        block->text.length = length - (size_t)level - 1;
+    } else if (line_starts_with(line, length, "- ", 2) || line_starts_with(line, length, "* ", 2)) {
+        block->type = XO_MD_BLOCK_LIST_ITEM;
+        block->text.data = line + 2;
+        block->text.length = length - 2;
+    } else if ((fence = fence_length(line, length)) > 0) {
+        // Code blocks run to the closing fence, without one to the end of the document
+        block->type = XO_MD_BLOCK_CODE;
+        
+        // The info string names the language of the code
+        size_t info_start = fence;
+        while (info_start < length && (line[info_start] == ' ' || line[info_start] == '\t')) {
+            info_start++;
         }
-        // Code blocks
-        else if (starts_with(line_start, "```")) {
-            // Simple code block support
-            strcpy(line_buffer, "<pre><code>\n");
+        block->info.data = line + info_start;
+        block->info.length = length - info_start;
+        
+        const char *code_start = newline ? newline + 1 : end;
+        const char *code_end = find_fence(code_start, end, fence);
+        block->text.data = code_start;
+        if (code_end) {
+            block->text.length = (size_t)(code_end - code_start);
             
-            // Find the ending ```
-            if (next_line) {
-                *next_line = '\n';  // Restore newline
-                char *code_end = strstr(next_line, "```");
-                if (code_end) {
-                    // Extract code content
-                    char *code_content = next_line + 1;
-                    *code_end = '\0';  // Terminate before closing ```
-                    
-                    // Append code content
-                    strcat(line_buffer, code_content);
-                    strcat(line_buffer, "</code></pre>\n");
-                    
-                    // Skip to after the closing ```
-                    line_start = code_end + 3;
-                    next_line = strchr(line_start, '\n');
-                    if (next_line) {
-                        *next_line = '\0';
-                    }
-                    
-                    // Skip to next iteration
-                    if (next_line) {
-                        *next_line = '\n';
-                        line_start = next_line + 1;
-                    } else {
-                        line_start = NULL;
-                    }
-                    continue;
-                }
+            // Skip the rest of the closing fence line
+            const char *fence_end = xo_scan_byte(code_end + fence, end, '\n');
+            next = fence_end < end ? fence_end + 1 : end;
+        } else {
+            block->text.length = (size_t)(end - code_start);
+            next = end;
+        }
+    } else if (newline && memchr(line, '|', length) &&
+               is_delimiter_row(newline + 1, xo_scan_byte(newline + 1, end, '\n'), count_cells(line, line_end))) {
+        // A row with pipes followed by a delimiter row starts a table, which
+        // runs over the following lines up to one that ends it
+        block->type = XO_MD_BLOCK_TABLE;
+        
+        const char *rows_end = xo_scan_byte(newline + 1, end, '\n');
+        next = rows_end < end ? rows_end + 1 : end;
+        while (next < end) {
+            const char *row_end = xo_scan_byte(next, end, '\n');
+            if (ends_table(next, (size_t)(row_end - next))) {
+                break;
             }
+            rows_end = row_end;
+            next = row_end < end ? row_end + 1 : end;
+        }
+        block->text.length = (size_t)(rows_end - line);
+    } else {
+        block->type = XO_MD_BLOCK_PARAGRAPH;
+    }
+    
+    block->source.data = line;
+    block->source.length = (size_t)(next - line);
+    
+    return next;
+}
+
+// Append the HTML of a block, leaving out list markup
+static void write_block(xo_writer_t *out, xo_markdown_inline_t *inlines, xo_highlight_cache_t *highlights,
+                        const xo_markdown_block_t *block) {
+    const char *text = block->text.data;
+    size_t length = block->text.length;
+    
+    switch (block->type) {
+        case XO_MD_BLOCK_HEADER: {
+            char open[] = "<h0>";
+            char close[] = "</h0>\n";
+            open[2] = (char)('0' + block->level);
+            close[3] = (char)('0' + block->level);
+            write_element(out, inlines, open, 4, text, length, close, 6);
+            break;
         }
-        // Default to paragraph
-        else {
-            if (in_list) {
-                // End the list if it doesn't continue
-                strcpy(line_buffer, "</ul>\n<p>");
-                strcat(line_buffer, line_start);
-                strcat(line_buffer, "</p>\n");
-                in_list = false;
+        case XO_MD_BLOCK_LIST_ITEM:
+            // Task list items start with a checkbox, "[ ]" or "[x]"
+            if (length > 3 && text[0] == '[' && text[2] == ']' && text[3] == ' ' &&
+                (text[1] == ' ' || text[1] == 'x' || text[1] == 'X')) {
+                static const char unchecked[] = "<li><input disabled=\"\" type=\"checkbox\"> ";
+                static const char checked[] = "<li><input checked=\"\" disabled=\"\" type=\"checkbox\"> ";
+                if (text[1] == ' ') {
+                    write_element(out, inlines, unchecked, sizeof(unchecked) - 1, text + 4, length - 4, "</li>\n", 6);
+                } else {
+                    write_element(out, inlines, checked, sizeof(checked) - 1, text + 4, length - 4, "</li>\n", 6);
+                }
             } else {
-                strcpy(line_buffer, "<p>");
-                strcat(line_buffer, line_start);
-                strcat(line_buffer, "</p>\n");
+                write_element(out, inlines, "<li>", 4, text, length, "</li>\n", 6);
             }
-        }
-        
-        // Append the processed line to the HTML
-        size_t line_buffer_len = strlen(line_buffer);
-        
-        // Check if we need to resize the buffer
-        if (html_len + line_buffer_len >= buffer_size) {
-            buffer_size = (html_len + line_buffer_len) * 2;
-            char *new_html = (char *)realloc(html, buffer_size);
-            if (!new_html) {
-                free(html);
-                return XO_ERROR_MEMORY_ALLOCATION;
+            break;
+        case XO_MD_BLOCK_TABLE:
+            write_table(out, inlines, text, length);
+            break;
+        case XO_MD_BLOCK_CODE: {
+            // The first word of the info string is the language, code in a
+            // known language is highlighted and any other code is escaped
+            size_t language_len = 0;
+            while (language_len < block->info.length && !isspace((unsigned char)block->info.data[language_len])) {
+                language_len++;
             }
-            html = new_html;
+            
+            if (language_len > 0) {
+                xo_writer_append(out, "<pre><code class=\"language-", 27);
+                xo_writer_append_escaped(out, block->info.data, language_len, true);
+                xo_writer_append(out, "\">\n", 3);
+            } else {
+                xo_writer_append(out, "<pre><code>\n", 12);
+            }
+            xo_highlight_to_html(highlights, block->info.data, language_len, text, length, out);
+            xo_writer_append(out, "</code></pre>\n", 14);
+            break;
         }
+        case XO_MD_BLOCK_PARAGRAPH:
+            write_element(out, inlines, "<p>", 3, text, length, "</p>\n", 5);
+            break;
+        default:
+            break;
+    }
+}
+
+// Open a list before its first item and close it at an empty line, a
+// paragraph or a table, returning whether a list is open after the block
+static bool write_list_markup(xo_writer_t *out, bool in_list, xo_markdown_block_type_t type) {
+    if (type == XO_MD_BLOCK_LIST_ITEM && !in_list) {
+        xo_writer_append(out, "<ul>\n", 5);
+        return true;
+    }
+    if ((type == XO_MD_BLOCK_BLANK || type == XO_MD_BLOCK_PARAGRAPH || type == XO_MD_BLOCK_TABLE) && in_list) {
+        xo_writer_append(out, "</ul>\n", 6);
+        return false;
+    }
+    
+    return in_list;
+}
+
+// Simple markdown to HTML conversion
+// This implements a basic subset of markdown (headers, paragraphs, lists and task lists,
+// code blocks, pipe tables, and emphasis, code spans, links and images within them).
+// The document is converted in a single pass over the content, which is left
+// untouched, into a growable writer, so conversion is linear in the document size.
+// The output is allocated from the document's arena when it has one.
+int xo_markdown_to_html(const xo_markdown_t *md, char **html_output) {
+    if (!md || !html_output) {
+        return XO_ERROR_MEMORY_ALLOCATION;
+    }
+    
+    const char *content = md->content.data ? md->content.data : "";
+    size_t content_len = md->content.length;
+    const char *end = content + content_len;
+    
+    // Most pages grow by their markup only, start with room for twice the source
+    xo_writer_t out;
+    if (xo_writer_init(&out, md->arena, content_len * 2) != XO_SUCCESS) {
+        return XO_ERROR_MEMORY_ALLOCATION;
+    }
+    
+    xo_markdown_inline_t inlines;
+    xo_markdown_inline_init(&inlines);
+    
+    bool in_list = false;
+    const char *line = content;
+    
+    while (line < end) {
+        xo_markdown_block_t block;
+        line = next_block(line, end, &block);
         
-        // Append the line
-        strcat(html, line_buffer);
-        html_len += line_buffer_len;
-        
-        // Restore the newline and move to the next line
-        if (next_line) {
-            *next_line = '\n';
-            line_start = next_line + 1;
-        } else {
-            line_start = NULL;
-        }
+        in_list = write_list_markup(&out, in_list, block.type);
+        write_block(&out, &inlines, md->highlights, &block);
     }
     
     // Close any open list
     if (in_list) {
-        size_t list_end_len = 6; // Length of "</ul>\n"
-        
-        // Check if we need to resize the buffer
-        if (html_len + list_end_len >= buffer_size) {
-            buffer_size = (html_len + list_end_len) * 2;
-            char *new_html = (char *)realloc(html, buffer_size);
-            if (!new_html) {
-                free(html);
-                return XO_ERROR_MEMORY_ALLOCATION;
-            }
-            html = new_html;
+        xo_writer_append(&out, "</ul>\n", 6);
+    }
+    
+    xo_markdown_inline_free(&inlines);
+    
+    *html_output = xo_writer_finish(&out, NULL);
+    
+    return *html_output ? XO_SUCCESS : XO_ERROR_MEMORY_ALLOCATION;
+}
+
+// Initialize an AST allocating from an arena
+int xo_markdown_ast_init(xo_markdown_ast_t *ast, xo_arena_t *arena) {
+    if (!ast || !arena) {
+        return XO_ERROR_MEMORY_ALLOCATION;
+    }
+    
+    ast->blocks = NULL;
+    ast->count = 0;
+    ast->capacity = 0;
+    ast->html = NULL;
+    ast->html_length = 0;
+    ast->arena = arena;
+    ast->highlights = NULL;
+    
+    return XO_SUCCESS;
+}
+
+// Split content into blocks. Splitting does no inline parsing, it only
+// finds the lines and fences of each block and hashes it.
+int xo_markdown_ast_parse(xo_markdown_ast_t *ast, const char *content, size_t length) {
+    if (!ast || (!content && length > 0)) {
+        return XO_ERROR_MEMORY_ALLOCATION;
+    }
+    
+    const char *line = content;
+    const char *end = content + length;
+    
+    // Every block holds at least one line, so the block array is sized once for all lines
+    size_t lines = 0;
+    for (const char *p = content; p < end; lines++) {
+        const char *newline = xo_scan_byte(p, end, '\n');
+        p = newline < end ? newline + 1 : end;
+    }
+    if (ast->count + lines > ast->capacity) {
+        xo_markdown_block_t *new_blocks = xo_arena_realloc(ast->arena, ast->blocks,
+                                                           ast->capacity * sizeof(xo_markdown_block_t),
+                                                           (ast->count + lines) * sizeof(xo_markdown_block_t));
+        if (!new_blocks) {
+            return XO_ERROR_MEMORY_ALLOCATION;
         }
         
-        strcat(html, "</ul>\n");
-        html_len += list_end_len;
+        ast->blocks = new_blocks;
+        ast->capacity = ast->count + lines;
+    }
+    
+    while (line < end) {
+        xo_markdown_block_t *block = &ast->blocks[ast->count++];
+        line = next_block(line, end, block);
+        block->hash = xo_utils_hash64(block->source.data, block->source.length, (uint64_t)block->type);
+        block->html_offset = 0;
+        block->html_length = 0;
+    }
+    
+    return XO_SUCCESS;
+}
+
+// Whether two blocks render to the same HTML
+static bool same_block(const xo_markdown_block_t *a, const xo_markdown_block_t *b) {
+    return a->hash == b->hash && a->type == b->type && a->source.length == b->source.length;
+}
+
+// Render the HTML of every block. With the AST of a previous version of the
+// document, the blocks before and after the first and last changed block keep
+// their HTML, which is copied in two runs, and only the blocks in between are
+// converted. The number of converted blocks is stored in rendered when given.
+int xo_markdown_ast_render(xo_markdown_ast_t *ast, const xo_markdown_ast_t *previous, size_t *rendered) {
+    if (!ast) {
+        return XO_ERROR_MEMORY_ALLOCATION;
+    }
+    
+    // Diff the block lists by hash from both ends
+    size_t prefix = 0;
+    size_t suffix = 0;
+    if (previous && previous->html) {
+        while (prefix < ast->count && prefix < previous->count &&
+               same_block(&ast->blocks[prefix], &previous->blocks[prefix])) {
+            prefix++;
+        }
+        while (suffix < ast->count - prefix && suffix < previous->count - prefix &&
+               same_block(&ast->blocks[ast->count - 1 - suffix], &previous->blocks[previous->count - 1 - suffix])) {
+            suffix++;
+        }
+    }
+    
+    size_t size_hint = previous && previous->html ? previous->html_length + 64 : 0;
+    for (size_t i = prefix; i < ast->count - suffix; i++) {
+        size_hint += ast->blocks[i].source.length * 2;
+    }
+    
+    xo_writer_t out;
+    if (xo_writer_init(&out, ast->arena, size_hint) != XO_SUCCESS) {
+        return XO_ERROR_MEMORY_ALLOCATION;
+    }
+    
+    // Unchanged leading blocks keep their offsets
+    if (prefix > 0) {
+        const xo_markdown_block_t *last = &previous->blocks[prefix - 1];
+        xo_writer_append(&out, previous->html, last->html_offset + last->html_length);
+        for (size_t i = 0; i < prefix; i++) {
+            ast->blocks[i].html_offset = previous->blocks[i].html_offset;
+            ast->blocks[i].html_length = previous->blocks[i].html_length;
+        }
+    }
+    
+    // Changed blocks are converted
+    xo_markdown_inline_t inlines;
+    xo_markdown_inline_init(&inlines);
+    
+    for (size_t i = prefix; i < ast->count - suffix; i++) {
+        xo_markdown_block_t *block = &ast->blocks[i];
+        block->html_offset = out.length;
+        write_block(&out, &inlines, ast->highlights, block);
+        block->html_length = out.length - block->html_offset;
+    }
+    
+    xo_markdown_inline_free(&inlines);
+    
+    // Unchanged trailing blocks move by the size difference of the changed ones
+    if (suffix > 0) {
+        const xo_markdown_block_t *first = &previous->blocks[previous->count - suffix];
+        size_t start = first->html_offset;
+        size_t base = out.length;
+        xo_writer_append(&out, previous->html + start, previous->html_length - start);
+        for (size_t i = 0; i < suffix; i++) {
+            const xo_markdown_block_t *old_block = &previous->blocks[previous->count - suffix + i];
+            xo_markdown_block_t *block = &ast->blocks[ast->count - suffix + i];
+            block->html_offset = base + (old_block->html_offset - start);
+            block->html_length = old_block->html_length;
+        }
+    }
+    
+    size_t html_length;
+    ast->html = xo_writer_finish(&out, &html_length);
+    if (!ast->html) {
+        return XO_ERROR_MEMORY_ALLOCATION;
+    }
+    ast->html_length = html_length;
+    
+    if (rendered) {
+        *rendered = ast->count - prefix - suffix;
     }
     
-    *html_output = html;
     return XO_SUCCESS;
-} 
\ No newline at end of file
+}
+
+// Write the page HTML of a rendered AST, adding the list markup between its blocks
+int xo_markdown_ast_to_html(const xo_markdown_ast_t *ast, xo_arena_t *arena, char **html_output) {
+    if (!ast || !html_output || (ast->count > 0 && !ast->html)) {
+        return XO_ERROR_MEMORY_ALLOCATION;
+    }
+    
+    xo_writer_t out;
+    if (xo_writer_init(&out, arena, ast->html_length + 64) != XO_SUCCESS) {
+        return XO_ERROR_MEMORY_ALLOCATION;
+    }
+    
+    bool in_list = false;
+    for (size_t i = 0; i < ast->count; i++) {
+        const xo_markdown_block_t *block = &ast->blocks[i];
+        in_list = write_list_markup(&out, in_list, block->type);
+        xo_writer_append(&out, ast->html + block->html_offset, block->html_length);
+    }
+    
+    // Close any open list
+    if (in_list) {
+        xo_writer_append(&out, "</ul>\n", 6);
+    }
+    
+    *html_output = xo_writer_finish(&out, NULL);
+    
+    return *html_output ? XO_SUCCESS : XO_ERROR_MEMORY_ALLOCATION;
+}
@@ -0,0 +1,1085 @@
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include "markdown.h"
+#include "scan.h"
+#include "writer.h"
+
+// Longest backtick run whose positions are remembered while looking for code
+// span closers, longer runs search the rest of the text each time
+#define INLINE_MAX_BACKTICKS 32
+
+// Deepest parenthesis nesting allowed in a link destination
+#define INLINE_MAX_LINK_PARENS 32
+
+// Kinds of inline items, the text of a line is split into a flat list of them
+typedef enum {
+    INLINE_TEXT,            // Literal source text
+    INLINE_CODE,            // Code span, the slice is its content
+    INLINE_DELIM,           // Run of * or _ that may open or close emphasis
+    INLINE_OPEN_BRACKET,    // [ or ![, starts a link or image when matched
+    INLINE_CLOSE_BRACKET,   // ] ending a matched link or image
+    INLINE_HTML,            // Raw HTML tag or entity reference, copied as is
+    INLINE_AUTOLINK,        // <scheme:address>, the slice is the address
+    INLINE_EMAIL            // <user@host>, linked with mailto:
+} inline_type_t;
+
+// Terminators of raw HTML whose failed searches are remembered
+typedef enum {
+    HTML_END_QUOTE,         // " closing an attribute value
+    HTML_END_APOSTROPHE,    // ' closing an attribute value
+    HTML_END_COMMENT,       // -->
+    HTML_END_INSTRUCTION,   // ?>
+    HTML_END_DECLARATION,   // >
+    HTML_END_KINDS
+} html_end_t;
+
+// One inline item
+typedef struct {
+    inline_type_t type;
+    size_t start;           // Source slice of the item
+    size_t length;
+    // Delimiter runs
+    char delim;
+    size_t count;           // Delimiters not used by emphasis, written as text
+    size_t orig_count;
+    bool can_open;
+    bool can_close;
+    int prev_delim;         // Links of the delimiter stack, -1 at the ends
+    int next_delim;
+    int open_tags;          // Emphasis opened after the run, outermost first
+    int close_tags;         // Emphasis closed before the run, innermost first
+    int close_tags_tail;
+    // Brackets
+    bool image;
+    bool matched;
+    int prev_bracket;       // Link of the bracket stack
+    int delim_bottom;       // Top of the delimiter stack when the bracket was pushed
+    int opener;             // Open bracket of a close bracket
+    size_t url_start;
+    size_t url_length;
+    size_t title_start;
+    size_t title_length;
+} inline_item_t;
+
+// Backtick run longer than INLINE_MAX_BACKTICKS
+typedef struct {
+    size_t length;
+    size_t start;
+} inline_run_t;
+
+// Emphasis tag in the list of a delimiter run
+typedef struct {
+    bool strong;
+    int next;
+} inline_tag_t;
+
+// Parser state for one span of text
+typedef struct {
+    xo_markdown_inline_t *state;
+    const char *text;
+    size_t length;
+    size_t count;           // Items in state->items
+    size_t tag_count;       // Tags in state->tags
+    size_t run_count;       // Long backtick runs in state->runs
+    int delim_top;
+    int bracket_top;
+    int link_bottom;        // Opener of the last matched link, [ openers up to it can't start a link
+    bool failed;
+    // Code span closers: once a search reached the end of the text every run
+    // is known, so later openers without a closer fail at once. Longer runs
+    // are kept in state->runs, sorted by length and start after that search.
+    bool backticks_used;    // backticks is cleared when the first code span opener shows up
+    bool backticks_scanned;
+    size_t backticks[INLINE_MAX_BACKTICKS + 1];  // Start of the last run of each length + 1, 0 for none
+    // Link titles whose closing quote was searched for from a position
+    // without being found, later searches from there on fail at once
+    size_t title_failed[3];
+    // Same for the terminators of raw HTML, by html_end_t
+    size_t html_failed[HTML_END_KINDS];
+} inline_parser_t;
+
+// Initialize the scratch memory of the inline parser
+void xo_markdown_inline_init(xo_markdown_inline_t *state) {
+    state->items = NULL;
+    state->item_capacity = 0;
+    state->tags = NULL;
+    state->tag_capacity = 0;
+    state->runs = NULL;
+    state->run_capacity = 0;
+}
+
+// Free the scratch memory of the inline parser
+void xo_markdown_inline_free(xo_markdown_inline_t *state) {
+    free(state->items);
+    free(state->tags);
+    free(state->runs);
+    xo_markdown_inline_init(state);
+}
+
+static bool is_space(char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\f' || c == '\v';
+}
+
+static bool is_punct(char c) {
+    return ispunct((unsigned char)c) != 0;
+}
+
+// Add an item, returning its index or -1 when out of memory
+static int push_item(inline_parser_t *parser, inline_type_t type, size_t start, size_t length) {
+    xo_markdown_inline_t *state = parser->state;
+    
+    if (parser->count >= state->item_capacity) {
+        size_t new_capacity = state->item_capacity == 0 ? 8 : state->item_capacity * 2;
+        inline_item_t *new_items = realloc(state->items, new_capacity * sizeof(inline_item_t));
+        if (!new_items) {
+            parser->failed = true;
+            return -1;
+        }
+        state->items = new_items;
+        state->item_capacity = new_capacity;
+    }
+    
+    // Only the fields every item reads are set, the rest belong to the kind of item
+    inline_item_t *item = &((inline_item_t *)state->items)[parser->count];
+    item->type = type;
+    item->start = start;
+    item->length = length;
+    item->count = 0;
+    item->image = false;
+    item->matched = false;
+    item->prev_delim = -1;
+    item->next_delim = -1;
+    item->open_tags = -1;
+    item->close_tags = -1;
+    item->close_tags_tail = -1;
+    item->prev_bracket = -1;
+    item->opener = -1;
+    
+    return (int)parser->count++;
+}
+
+static inline_item_t *item_at(inline_parser_t *parser, int index) {
+    return &((inline_item_t *)parser->state->items)[index];
+}
+
+// Add an emphasis tag, returning its index or -1 when out of memory
+static int push_tag(inline_parser_t *parser, bool strong) {
+    xo_markdown_inline_t *state = parser->state;
+    
+    if (parser->tag_count >= state->tag_capacity) {
+        size_t new_capacity = state->tag_capacity == 0 ? 8 : state->tag_capacity * 2;
+        inline_tag_t *new_tags = realloc(state->tags, new_capacity * sizeof(inline_tag_t));
+        if (!new_tags) {
+            parser->failed = true;
+            return -1;
+        }
+        state->tags = new_tags;
+        state->tag_capacity = new_capacity;
+    }
+    
+    inline_tag_t *tag = &((inline_tag_t *)state->tags)[parser->tag_count];
+    tag->strong = strong;
+    tag->next = -1;
+    
+    return (int)parser->tag_count++;
+}
+
+static inline_tag_t *tag_at(inline_parser_t *parser, int index) {
+    return &((inline_tag_t *)parser->state->tags)[index];
+}
+
+// Add the text between the last item and end as a text item
+static void flush_text(inline_parser_t *parser, size_t *text_start, size_t end) {
+    if (end > *text_start) {
+        push_item(parser, INLINE_TEXT, *text_start, end - *text_start);
+    }
+    *text_start = end;
+}
+
+static void remove_delim(inline_parser_t *parser, int index) {
+    inline_item_t *item = item_at(parser, index);
+    
+    if (item->prev_delim >= 0) {
+        item_at(parser, item->prev_delim)->next_delim = item->next_delim;
+    }
+    if (item->next_delim >= 0) {
+        item_at(parser, item->next_delim)->prev_delim = item->prev_delim;
+    } else {
+        parser->delim_top = item->prev_delim;
+    }
+}
+
+// Remember a long backtick run
+static void push_long_run(inline_parser_t *parser, size_t start, size_t length) {
+    xo_markdown_inline_t *state = parser->state;
+    
+    if (parser->run_count >= state->run_capacity) {
+        size_t new_capacity = state->run_capacity == 0 ? 8 : state->run_capacity * 2;
+        inline_run_t *new_runs = realloc(state->runs, new_capacity * sizeof(inline_run_t));
+        if (!new_runs) {
+            parser->failed = true;
+            return;
+        }
+        state->runs = new_runs;
+        state->run_capacity = new_capacity;
+    }
+    
+    inline_run_t *run = &((inline_run_t *)state->runs)[parser->run_count++];
+    run->start = start;
+    run->length = length;
+}
+
+static int compare_runs(const void *a, const void *b) {
+    const inline_run_t *ra = (const inline_run_t *)a;
+    const inline_run_t *rb = (const inline_run_t *)b;
+    
+    if (ra->length != rb->length) {
+        return ra->length < rb->length ? -1 : 1;
+    }
+    
+    return ra->start < rb->start ? -1 : ra->start > rb->start;
+}
+
+// Check whether a long run of n backticks starts at or after pos
+static bool long_run_after(const inline_parser_t *parser, size_t pos, size_t n) {
+    const inline_run_t *runs = (const inline_run_t *)parser->state->runs;
+    size_t low = 0;
+    size_t high = parser->run_count;
+    
+    // Find the first run that is longer, or as long and at or after pos
+    while (low < high) {
+        size_t mid = low + (high - low) / 2;
+        if (runs[mid].length < n || (runs[mid].length == n && runs[mid].start < pos)) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    
+    return low < parser->run_count && runs[low].length == n;
+}
+
+// Find the closing run of a code span opened by n backticks ending at pos.
+// Returns the start of the closer or length when there is none.
+static size_t find_code_closer(inline_parser_t *parser, size_t pos, size_t n) {
+    if (!parser->backticks_used) {
+        memset(parser->backticks, 0, sizeof(parser->backticks));
+        parser->backticks_used = true;
+    }
+    
+    if (parser->backticks_scanned) {
+        bool known = n <= INLINE_MAX_BACKTICKS ? parser->backticks[n] > pos : long_run_after(parser, pos, n);
+        if (!known) {
+            return parser->length;
+        }
+    }
+    
+    const char *end = parser->text + parser->length;
+    const char *p = parser->text + pos;
+    
+    while ((p = xo_scan_byte(p, end, '`')) < end) {
+        const char *run = p;
+        while (p < end && *p == '`') {
+            p++;
+        }
+    
+        // Once the whole text was scanned the last run of each length is
+        // known, an earlier run seen by a later search must not replace it
+        size_t run_length = (size_t)(p - run);
+        if (!parser->backticks_scanned) {
+            if (run_length <= INLINE_MAX_BACKTICKS) {
+                parser->backticks[run_length] = (size_t)(run - parser->text) + 1;
+            } else {
+                push_long_run(parser, (size_t)(run - parser->text), run_length);
+            }
+        }
+        if (run_length == n) {
+            return (size_t)(run - parser->text);
+        }
+    }
+    
+    if (!parser->backticks_scanned) {
+        parser->backticks_scanned = true;
+        if (parser->run_count > 1) {
+            qsort(parser->state->runs, parser->run_count, sizeof(inline_run_t), compare_runs);
+        }
+    }
+    
+    return parser->length;
+}
+
+// Parse a link destination and optional title after the ] at pos, "(url)" or
+// "(url "title")". Returns the position after the ) or 0 when there is none.
+static size_t parse_link_tail(inline_parser_t *parser, size_t pos, inline_item_t *opener) {
+    const char *text = parser->text;
+    size_t length = parser->length;
+    size_t i = pos + 1;
+    
+    if (i >= length || text[i] != '(') {
+        return 0;
+    }
+    i++;
+    
+    while (i < length && (text[i] == ' ' || text[i] == '\t')) {
+        i++;
+    }
+    
+    // Destination, either <...> or a run without spaces and with balanced parentheses
+    size_t url_start = i;
+    size_t url_end;
+    if (i < length && text[i] == '<') {
+        url_start = ++i;
+        while (i < length && text[i] != '>' && text[i] != '<') {
+            i += text[i] == '\\' && i + 1 < length ? 2 : 1;
+        }
+        if (i >= length || text[i] != '>') {
+            return 0;
+        }
+        url_end = i++;
+    } else {
+        int depth = 0;
+        while (i < length && !is_space(text[i]) && !iscntrl((unsigned char)text[i])) {
+            if (text[i] == '\\' && i + 1 < length) {
+                i += 2;
+                continue;
+            }
+            if (text[i] == '(') {
+                if (++depth > INLINE_MAX_LINK_PARENS) {
+                    return 0;
+                }
+            } else if (text[i] == ')') {
+                if (depth == 0) {
+                    break;
+                }
+                depth--;
+            }
+            i++;
+        }
+        if (depth != 0) {
+            return 0;
+        }
+        url_end = i;
+    }
+    
+    size_t title_start = 0;
+    size_t title_end = 0;
+    size_t before_spaces = i;
+    while (i < length && (text[i] == ' ' || text[i] == '\t')) {
+        i++;
+    }
+    
+    // Title, separated from the destination by whitespace
+    if (i < length && i > before_spaces && (text[i] == '"' || text[i] == '\'' || text[i] == '(')) {
+        char close = text[i] == '(' ? ')' : text[i];
+        int kind = text[i] == '"' ? 0 : text[i] == '\'' ? 1 : 2;
+    
+        title_start = i + 1;
+        if (parser->title_failed[kind] != 0 && parser->title_failed[kind] <= title_start) {
+            return 0;
+        }
+    
+        size_t j = title_start;
+        while (j < length && text[j] != close) {
+            j += text[j] == '\\' && j + 1 < length ? 2 : 1;
+        }
+        if (j >= length) {
+            parser->title_failed[kind] = title_start;
+            return 0;
+        }
+    
+        title_end = j;
+        i = j + 1;
+        while (i < length && (text[i] == ' ' || text[i] == '\t')) {
+            i++;
+        }
+    }
+    
+    if (i >= length || text[i] != ')') {
+        return 0;
+    }
+    
+    opener->url_start = url_start;
+    opener->url_length = url_end - url_start;
+    opener->title_start = title_start;
+    opener->title_length = title_end - title_start;
+    
+    return i + 1;
+}
+
+// Length of the entity reference at pos, &name; &#123; or &#x1F;, 0 when there is none
+static size_t entity_length(const char *text, size_t pos, size_t length) {
+    size_t i = pos + 1;
+    size_t start;
+    
+    if (i < length && text[i] == '#') {
+        bool hex = ++i < length && (text[i] == 'x' || text[i] == 'X');
+        i += hex ? 1 : 0;
+        start = i;
+        while (i < length && i - start < (hex ? 6 : 7) &&
+               (hex ? isxdigit((unsigned char)text[i]) : isdigit((unsigned char)text[i]))) {
+            i++;
+        }
+    } else {
+        start = i;
+        if (i >= length || !isalpha((unsigned char)text[i])) {
+            return 0;
+        }
+        while (i < length && i - start < 32 && isalnum((unsigned char)text[i])) {
+            i++;
+        }
+    }
+    
+    return i > start && i < length && text[i] == ';' ? i + 1 - pos : 0;
+}
+
+// Characters allowed before the @ of an email autolink
+static bool is_email_char(char c) {
+    return isalnum((unsigned char)c) || (c != '\0' && strchr(".!#$%&'*+/=?^_`{|}~-", c) != NULL);
+}
+
+// Length of the autolink at pos, <scheme:address> or <user@host>, 0 when there is none
+static size_t autolink_length(const char *text, size_t pos, size_t length, bool *email) {
+    size_t i = pos + 1;
+    
+    // Scheme of 2 to 32 characters, then anything but spaces, controls and angle brackets
+    size_t scheme_start = i;
+    if (i < length && isalpha((unsigned char)text[i])) {
+        while (i < length && i - scheme_start < 33 &&
+               (isalnum((unsigned char)text[i]) || text[i] == '+' || text[i] == '.' || text[i] == '-')) {
+            i++;
+        }
+        if (i < length && text[i] == ':' && i - scheme_start >= 2 && i - scheme_start <= 32) {
+            i++;
+            while (i < length && text[i] != '<' && text[i] != '>' && !is_space(text[i]) &&
+                   !iscntrl((unsigned char)text[i])) {
+                i++;
+            }
+            if (i < length && text[i] == '>') {
+                *email = false;
+                return i + 1 - pos;
+            }
+            return 0;
+        }
+    }
+    
+    // Email address, a simplified form of the one HTML forms accept
+    i = pos + 1;
+    while (i < length && is_email_char(text[i])) {
+        i++;
+    }
+    if (i == pos + 1 || i >= length || text[i] != '@') {
+        return 0;
+    }
+    
+    size_t host_start = ++i;
+    while (i < length && (isalnum((unsigned char)text[i]) || text[i] == '.' || text[i] == '-')) {
+        i++;
+    }
+    if (i == host_start || !isalnum((unsigned char)text[host_start]) || !isalnum((unsigned char)text[i - 1]) ||
+        i >= length || text[i] != '>') {
+        return 0;
+    }
+    
+    *email = true;
+    return i + 1 - pos;
+}
+
+// Find the terminator of raw HTML at or after pos, returning its start or the
+// length of the text. A failed search is remembered, so later searches from
+// further on fail at once and unterminated tags stay linear.
+static size_t find_html_end(inline_parser_t *parser, size_t pos, html_end_t kind) {
+    static const char *const terminators[HTML_END_KINDS] = { "\"", "'", "-->", "?>", ">" };
+    
+    if (parser->html_failed[kind] != 0 && parser->html_failed[kind] <= pos) {
+        return parser->length;
+    }
+    
+    const char *needle = terminators[kind];
+    size_t needle_length = strlen(needle);
+    const char *end = parser->text + parser->length;
+    const char *p = parser->text + pos;
+    
+    while ((p = xo_scan_byte(p, end, needle[0])) < end) {
+        if ((size_t)(end - p) >= needle_length && memcmp(p, needle, needle_length) == 0) {
+            return (size_t)(p - parser->text);
+        }
+        p++;
+    }
+    
+    parser->html_failed[kind] = pos;
+    return parser->length;
+}
+
+static bool is_tag_name_char(char c) {
+    return isalnum((unsigned char)c) || c == '-';
+}
+
+static bool is_attribute_name_char(char c) {
+    return isalnum((unsigned char)c) || c == '_' || c == '.' || c == ':' || c == '-';
+}
+
+// Length of the raw HTML at pos, an open or closing tag, a comment, a
+// processing instruction or a declaration, 0 when there is none
+static size_t raw_html_length(inline_parser_t *parser, size_t pos) {
+    const char *text = parser->text;
+    size_t length = parser->length;
+    size_t i = pos + 1;
+    
+    if (i >= length) {
+        return 0;
+    }
+    
+    // Closing tag
+    if (text[i] == '/') {
+        if (++i >= length || !isalpha((unsigned char)text[i])) {
+            return 0;
+        }
+        while (i < length && is_tag_name_char(text[i])) {
+            i++;
+        }
+        while (i < length && is_space(text[i])) {
+            i++;
+        }
+        return i < length && text[i] == '>' ? i + 1 - pos : 0;
+    }
+    
+    // Comment, processing instruction or declaration
+    if (text[i] == '!' || text[i] == '?') {
+        html_end_t kind;
+        if (text[i] == '?') {
+            kind = HTML_END_INSTRUCTION;
+            i++;
+        } else if (length - i >= 3 && text[i + 1] == '-' && text[i + 2] == '-') {
+            kind = HTML_END_COMMENT;
+            i += 3;
+        } else if (i + 1 < length && isalpha((unsigned char)text[i + 1])) {
+            kind = HTML_END_DECLARATION;
+            i++;
+        } else {
+            return 0;
+        }
+    
+        size_t close = find_html_end(parser, i, kind);
+        size_t close_length = kind == HTML_END_COMMENT ? 3 : kind == HTML_END_INSTRUCTION ? 2 : 1;
+        return close < length ? close + close_length - pos : 0;
+    }
+    
+    // Open tag with attributes, each preceded by whitespace
+    if (!isalpha((unsigned char)text[i])) {
+        return 0;
+    }
+    while (i < length && is_tag_name_char(text[i])) {
+        i++;
+    }
+    
+    for (;;) {
+        size_t spaces = i;
+        while (i < length && is_space(text[i])) {
+            i++;
+        }
+        if (i >= length) {
+            return 0;
+        }
+        if (text[i] == '>') {
+            return i + 1 - pos;
+        }
+        if (text[i] == '/') {
+            return i + 1 < length && text[i + 1] == '>' ? i + 2 - pos : 0;
+        }
+        if (i == spaces || !(isalpha((unsigned char)text[i]) || text[i] == '_' || text[i] == ':')) {
+            return 0;
+        }
+        while (i < length && is_attribute_name_char(text[i])) {
+            i++;
+        }
+    
+        // Optional value, quoted or a run without spaces and quotes
+        size_t name_end = i;
+        while (i < length && is_space(text[i])) {
+            i++;
+        }
+        if (i >= length || text[i] != '=') {
+            i = name_end;
+            continue;
+        }
+        i++;
+        while (i < length && is_space(text[i])) {
+            i++;
+        }
+        if (i >= length) {
+            return 0;
+        }
+    
+        if (text[i] == '"' || text[i] == '\'') {
+            size_t close = find_html_end(parser, i + 1, text[i] == '"' ? HTML_END_QUOTE : HTML_END_APOSTROPHE);
+            if (close >= length) {
+                return 0;
+            }
+            i = close + 1;
+        } else {
+            size_t value_start = i;
+            while (i < length && !is_space(text[i]) && text[i] != '"' && text[i] != '\'' && text[i] != '=' &&
+                   text[i] != '<' && text[i] != '>' && text[i] != '`') {
+                i++;
+            }
+            if (i == value_start) {
+                return 0;
+            }
+        }
+    }
+}
+
+// Index of the openers_bottom slot for a closer, openers below it are known
+// not to match closers of the same kind
+static int bottom_slot(const inline_item_t *closer) {
+    return (closer->delim == '_' ? 6 : 0) + (closer->can_open ? 3 : 0) + (int)(closer->orig_count % 3);
+}
+
+// Match emphasis among the delimiters above stack_bottom, then remove them.
+// Every closer searches down the stack only once per kind of closer, so this
+// stays linear in the number of delimiters however many of them go unmatched.
+static void process_emphasis(inline_parser_t *parser, int stack_bottom) {
+    int openers_bottom[12];
+    for (int i = 0; i < 12; i++) {
+        openers_bottom[i] = stack_bottom;
+    }
+    
+    // Find the first delimiter above the bottom
+    int closer = parser->delim_top != stack_bottom ? parser->delim_top : -1;
+    while (closer >= 0 && item_at(parser, closer)->prev_delim != stack_bottom) {
+        closer = item_at(parser, closer)->prev_delim;
+    }
+    
+    while (closer >= 0) {
+        inline_item_t *c = item_at(parser, closer);
+        if (!c->can_close) {
+            closer = c->next_delim;
+            continue;
+        }
+    
+        // Look back for the nearest opener of the same kind
+        int opener = c->prev_delim;
+        bool found = false;
+        while (opener >= 0 && opener != stack_bottom && opener != openers_bottom[bottom_slot(c)]) {
+            inline_item_t *o = item_at(parser, opener);
+            if (o->can_open && o->delim == c->delim) {
+                // A run that can both open and close only pairs up when the
+                // lengths aren't multiples of 3 adding up to one
+                bool odd_match = (c->can_open || o->can_close) && c->orig_count % 3 != 0 &&
+                                 (o->orig_count + c->orig_count) % 3 == 0;
+                if (!odd_match) {
+                    found = true;
+                    break;
+                }
+            }
+            opener = o->prev_delim;
+        }
+    
+        if (!found) {
+            int next = c->next_delim;
+            openers_bottom[bottom_slot(c)] = c->prev_delim;
+            if (!c->can_open) {
+                remove_delim(parser, closer);
+            }
+            closer = next;
+            continue;
+        }
+    
+        inline_item_t *o = item_at(parser, opener);
+        bool strong = o->count >= 2 && c->count >= 2;
+        size_t used = strong ? 2 : 1;
+        o->count -= used;
+        c->count -= used;
+    
+        // Each match of an opener wraps the ones before it, each match of a
+        // closer closes outside the ones before it
+        int open_tag = push_tag(parser, strong);
+        int close_tag = push_tag(parser, strong);
+        if (open_tag < 0 || close_tag < 0) {
+            return;
+        }
+        o = item_at(parser, opener);
+        c = item_at(parser, closer);
+    
+        tag_at(parser, open_tag)->next = o->open_tags;
+        o->open_tags = open_tag;
+        if (c->close_tags_tail >= 0) {
+            tag_at(parser, c->close_tags_tail)->next = close_tag;
+        } else {
+            c->close_tags = close_tag;
+        }
+        c->close_tags_tail = close_tag;
+    
+        // Delimiters between the pair can no longer match anything
+        int between = c->prev_delim;
+        while (between >= 0 && between != opener) {
+            int prev = item_at(parser, between)->prev_delim;
+            remove_delim(parser, between);
+            between = prev;
+        }
+    
+        if (o->count == 0) {
+            remove_delim(parser, opener);
+        }
+        if (c->count == 0) {
+            int next = c->next_delim;
+            remove_delim(parser, closer);
+            closer = next;
+        }
+    }
+    
+    // Whatever is left above the bottom stays literal text
+    while (parser->delim_top >= 0 && parser->delim_top != stack_bottom) {
+        remove_delim(parser, parser->delim_top);
+    }
+}
+
+// Handle a ] at pos. Returns the position to continue from, or pos + 1 with
+// the ] left as text when it doesn't end a link or image.
+static size_t close_bracket(inline_parser_t *parser, size_t *text_start, size_t pos) {
+    int opener = parser->bracket_top;
+    if (opener < 0) {
+        return pos + 1;
+    }
+    
+    // Links can't contain links, so a [ pushed before a matched link is inactive
+    inline_item_t *o = item_at(parser, opener);
+    if (!o->image && opener <= parser->link_bottom) {
+        parser->bracket_top = o->prev_bracket;
+        return pos + 1;
+    }
+    
+    size_t next = parse_link_tail(parser, pos, o);
+    if (next == 0) {
+        parser->bracket_top = o->prev_bracket;
+        return pos + 1;
+    }
+    
+    flush_text(parser, text_start, pos);
+    int closer = push_item(parser, INLINE_CLOSE_BRACKET, pos, next - pos);
+    if (closer < 0) {
+        return pos + 1;
+    }
+    
+    o = item_at(parser, opener);
+    o->matched = true;
+    item_at(parser, closer)->opener = opener;
+    
+    process_emphasis(parser, o->delim_bottom);
+    parser->bracket_top = o->prev_bracket;
+    if (!o->image && opener > parser->link_bottom) {
+        parser->link_bottom = opener;
+    }
+    
+    *text_start = next;
+    return next;
+}
+
+// Split the text into items, resolving code spans and links as they close
+static void parse_items(inline_parser_t *parser) {
+    const char *text = parser->text;
+    const char *end = text + parser->length;
+    size_t length = parser->length;
+    size_t text_start = 0;
+    size_t i = 0;
+    
+    while (i < length && !parser->failed) {
+        i = (size_t)(xo_scan_special(text + i, end) - text);
+        if (i >= length) {
+            break;
+        }
+    
+        char c = text[i];
+    
+        if (c == '\\') {
+            // Escaped punctuation is literal, the backslash is dropped
+            if (i + 1 < length && is_punct(text[i + 1])) {
+                flush_text(parser, &text_start, i);
+                text_start = i + 1;
+                i += 2;
+            } else {
+                i++;
+            }
+        } else if (c == '`') {
+            size_t run_start = i;
+            while (i < length && text[i] == '`') {
+                i++;
+            }
+    
+            size_t n = i - run_start;
+            size_t closer = find_code_closer(parser, i, n);
+            if (closer < length) {
+                flush_text(parser, &text_start, run_start);
+                push_item(parser, INLINE_CODE, i, closer - i);
+                i = closer + n;
+                text_start = i;
+            }
+        } else if (c == '*' || c == '_') {
+            size_t run_start = i;
+            while (i < length && text[i] == c) {
+                i++;
+            }
+    
+            // Flanking rules, the ends of the text count as whitespace
+            char before = run_start > 0 ? text[run_start - 1] : ' ';
+            char after = i < length ? text[i] : ' ';
+            bool left = !is_space(after) && (!is_punct(after) || is_space(before) || is_punct(before));
+            bool right = !is_space(before) && (!is_punct(before) || is_space(after) || is_punct(after));
+    
+            flush_text(parser, &text_start, run_start);
+            int index = push_item(parser, INLINE_DELIM, run_start, i - run_start);
+            if (index < 0) {
+                break;
+            }
+    
+            inline_item_t *item = item_at(parser, index);
+            item->delim = c;
+            item->count = i - run_start;
+            item->orig_count = item->count;
+            item->can_open = c == '*' ? left : left && (!right || is_punct(before));
+            item->can_close = c == '*' ? right : right && (!left || is_punct(after));
+            item->prev_delim = parser->delim_top;
+            if (parser->delim_top >= 0) {
+                item_at(parser, parser->delim_top)->next_delim = index;
+            }
+            parser->delim_top = index;
+            text_start = i;
+        } else if (c == '[' || (c == '!' && i + 1 < length && text[i + 1] == '[')) {
+            size_t bracket_length = c == '!' ? 2 : 1;
+    
+            flush_text(parser, &text_start, i);
+            int index = push_item(parser, INLINE_OPEN_BRACKET, i, bracket_length);
+            if (index < 0) {
+                break;
+            }
+    
+            inline_item_t *item = item_at(parser, index);
+            item->image = c == '!';
+            item->prev_bracket = parser->bracket_top;
+            item->delim_bottom = parser->delim_top;
+            parser->bracket_top = index;
+            i += bracket_length;
+            text_start = i;
+        } else if (c == ']') {
+            i = close_bracket(parser, &text_start, i);
+        } else if (c == '<' || c == '&') {
+            // Autolinks, raw HTML and entity references are kept whole, so
+            // the text inside them is neither parsed nor escaped
+            bool email = false;
+            size_t n;
+            inline_type_t type = INLINE_HTML;
+            if (c == '&') {
+                n = entity_length(text, i, length);
+            } else if ((n = autolink_length(text, i, length, &email)) > 0) {
+                type = email ? INLINE_EMAIL : INLINE_AUTOLINK;
+            } else {
+                n = raw_html_length(parser, i);
+            }
+    
+            if (n > 0) {
+                // The slice of an autolink is the address inside the angle brackets
+                bool link = type != INLINE_HTML;
+                flush_text(parser, &text_start, i);
+                push_item(parser, type, link ? i + 1 : i, link ? n - 2 : n);
+                i += n;
+                text_start = i;
+            } else {
+                i++;
+            }
+        } else {
+            i++;
+        }
+    }
+    
+    flush_text(parser, &text_start, length);
+    process_emphasis(parser, -1);
+}
+
+// Write text escaping the characters HTML treats specially. Apostrophes are
+// left alone, as CommonMark does, since attributes are always double-quoted.
+static void write_escaped(xo_writer_t *out, const char *text, size_t length) {
+    xo_writer_append_escaped(out, text, length, false);
+}
+
+// Write a link destination or title, escaped. Backslash escapes are
+// processed as in text: the backslash before punctuation is dropped.
+static void write_link_part(xo_writer_t *out, const char *text, size_t length) {
+    const char *p = text;
+    const char *end = text + length;
+    const char *slash;
+    while ((slash = memchr(p, '\\', (size_t)(end - p))) != NULL) {
+        if (slash + 1 < end && is_punct(slash[1])) {
+            write_escaped(out, p, (size_t)(slash - p));
+            write_escaped(out, slash + 1, 1);
+            p = slash + 2;
+        } else {
+            write_escaped(out, p, (size_t)(slash + 1 - p));
+            p = slash + 1;
+        }
+    }
+    write_escaped(out, p, (size_t)(end - p));
+}
+
+static void write_tags(inline_parser_t *parser, xo_writer_t *out, int tag, bool closing) {
+    for (; tag >= 0; tag = tag_at(parser, tag)->next) {
+        if (tag_at(parser, tag)->strong) {
+            xo_writer_append_str(out, closing ? "</strong>" : "<strong>");
+        } else {
+            xo_writer_append_str(out, closing ? "</em>" : "<em>");
+        }
+    }
+}
+
+// Write the items as HTML. Inside an image everything is written as plain
+// text for its alt attribute.
+static void write_items(inline_parser_t *parser, xo_writer_t *out) {
+    const char *text = parser->text;
+    int plain = 0;
+    
+    for (size_t i = 0; i < parser->count; i++) {
+        const inline_item_t *item = item_at(parser, (int)i);
+    
+        switch (item->type) {
+            case INLINE_TEXT:
+                write_escaped(out, text + item->start, item->length);
+                break;
+    
+            case INLINE_HTML:
+                if (plain) {
+                    write_escaped(out, text + item->start, item->length);
+                } else {
+                    xo_writer_append(out, text + item->start, item->length);
+                }
+                break;
+    
+            case INLINE_AUTOLINK:
+            case INLINE_EMAIL:
+                if (!plain) {
+                    xo_writer_append_str(out, item->type == INLINE_EMAIL ? "<a href=\"mailto:" : "<a href=\"");
+                    write_escaped(out, text + item->start, item->length);
+                    xo_writer_append(out, "\">", 2);
+                }
+                write_escaped(out, text + item->start, item->length);
+                if (!plain) {
+                    xo_writer_append(out, "</a>", 4);
+                }
+                break;
+    
+            case INLINE_CODE: {
+                // One space on each side is dropped, so code can start or end with a backtick
+                size_t start = item->start;
+                size_t length = item->length;
+                if (length >= 2 && text[start] == ' ' && text[start + length - 1] == ' ' &&
+                    strspn(text + start, " ") < length) {
+                    start++;
+                    length -= 2;
+                }
+    
+                if (!plain) {
+                    xo_writer_append(out, "<code>", 6);
+                }
+                write_escaped(out, text + start, length);
+                if (!plain) {
+                    xo_writer_append(out, "</code>", 7);
+                }
+                break;
+            }
+    
+            case INLINE_DELIM:
+                if (!plain) {
+                    write_tags(parser, out, item->close_tags, true);
+                }
+                for (size_t n = 0; n < item->count; n++) {
+                    xo_writer_putc(out, item->delim);
+                }
+                if (!plain) {
+                    write_tags(parser, out, item->open_tags, false);
+                }
+                break;
+    
+            case INLINE_OPEN_BRACKET:
+                if (!item->matched) {
+                    xo_writer_append(out, text + item->start, item->length);
+                } else if (item->image) {
+                    if (plain++ == 0) {
+                        xo_writer_append_str(out, "<img src=\"");
+                        write_link_part(out, text + item->url_start, item->url_length);
+                        xo_writer_append_str(out, "\" alt=\"");
+                    }
+                } else if (!plain) {
+                    xo_writer_append_str(out, "<a href=\"");
+                    write_link_part(out, text + item->url_start, item->url_length);
+                    if (item->title_length > 0) {
+                        xo_writer_append_str(out, "\" title=\"");
+                        write_link_part(out, text + item->title_start, item->title_length);
+                    }
+                    xo_writer_append_str(out, "\">");
+                }
+                break;
+    
+            case INLINE_CLOSE_BRACKET: {
+                const inline_item_t *opener = item_at(parser, item->opener);
+                if (opener->image) {
+                    if (--plain == 0) {
+                        xo_writer_putc(out, '"');
+                        if (opener->title_length > 0) {
+                            xo_writer_append_str(out, " title=\"");
+                            write_link_part(out, text + opener->title_start, opener->title_length);
+                            xo_writer_putc(out, '"');
+                        }
+                        xo_writer_putc(out, '>');
+                    }
+                } else if (!plain) {
+                    xo_writer_append(out, "</a>", 4);
+                }
+                break;
+            }
+        }
+    }
+}
+
+// Render the inline markdown of a span of text: emphasis, code spans, links,
+// images, autolinks and backslash escapes. Raw HTML and entity references are
+// copied as is, other text is escaped. Parsing uses a delimiter stack and never backtracks, so it is linear
+// in the length of the text even when most delimiters go unmatched.
+int xo_markdown_inline_to_html(xo_markdown_inline_t *state, const char *text, size_t length, xo_writer_t *out) {
+    if (!state || !text || !out) {
+        return XO_ERROR_MEMORY_ALLOCATION;
+    }
+    
+    // Plain text needs no parsing, only escaping
+    const char *end = text + length;
+    const char *p = text;
+    while ((p = xo_scan_special(p, end)) < end && !strchr("*_`[]\\<&", *p)) {
+        p++;
+    }
+    if (p >= end) {
+        return xo_writer_append_escaped(out, text, length, false);
+    }
+    
+    inline_parser_t parser;
+    parser.state = state;
+    parser.text = text;
+    parser.length = length;
+    parser.count = 0;
+    parser.tag_count = 0;
+    parser.run_count = 0;
+    parser.delim_top = -1;
+    parser.bracket_top = -1;
+    parser.link_bottom = -1;
+    parser.failed = false;
+    parser.backticks_used = false;
+    parser.backticks_scanned = false;
+    memset(parser.title_failed, 0, sizeof(parser.title_failed));
+    memset(parser.html_failed, 0, sizeof(parser.html_failed));
+    
+    parse_items(&parser);
+    if (parser.failed) {
+        return XO_ERROR_MEMORY_ALLOCATION;
+    }
+    
+    write_items(&parser, out);
+    
+    return out->failed ? XO_ERROR_MEMORY_ALLOCATION : XO_SUCCESS;
+}
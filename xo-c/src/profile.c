@@ -0,0 +1,251 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "profile.h"
+#include "utils.h"
+#include "mutex.h"
+
+// Names used in the printed and JSON reports
+static const char *stage_names[XO_PROFILE_STAGE_COUNT] = {
+    "parse",
+    "to_html",
+    "render",
+    "mkdir",
+    "write"
+};
+
+const char *xo_profile_stage_name(xo_profile_stage_t stage) {
+    return stage < XO_PROFILE_STAGE_COUNT ? stage_names[stage] : "unknown";
+}
+
+// Initialize a profile and start its clock
+int xo_profile_init(xo_profile_t *profile) {
+    if (!profile) {
+        return XO_ERROR_MEMORY_ALLOCATION;
+    }
+    
+    profile->pages = NULL;
+    profile->count = 0;
+    profile->capacity = 0;
+    profile->start_ns = xo_utils_time_ns();
+    profile->wall_ns = 0;
+    
+    mutex_t *lock = malloc(sizeof(mutex_t));
+    if (!lock) {
+        profile->lock = NULL;
+        return XO_ERROR_MEMORY_ALLOCATION;
+    }
+    mutex_init(lock);
+    profile->lock = lock;
+    
+    return XO_SUCCESS;
+}
+
+// Free resources used by a profile
+void xo_profile_free(xo_profile_t *profile) {
+    if (!profile) {
+        return;
+    }
+    
+    for (size_t i = 0; i < profile->count; i++) {
+        free(profile->pages[i].filepath);
+    }
+    free(profile->pages);
+    
+    if (profile->lock) {
+        mutex_destroy((mutex_t *)profile->lock);
+        free(profile->lock);
+    }
+    
+    profile->pages = NULL;
+    profile->count = 0;
+    profile->capacity = 0;
+    profile->lock = NULL;
+}
+
+// Record the stage timings of a built page
+int xo_profile_add_page(xo_profile_t *profile, const char *filepath, const uint64_t stage_ns[XO_PROFILE_STAGE_COUNT]) {
+    if (!profile || !filepath || !stage_ns) {
+        return XO_ERROR_MEMORY_ALLOCATION;
+    }
+    
+    char *path_copy = xo_utils_strdup(filepath);
+    if (!path_copy) {
+        return XO_ERROR_MEMORY_ALLOCATION;
+    }
+    
+    mutex_lock((mutex_t *)profile->lock);
+    
+    if (profile->count >= profile->capacity) {
+        size_t new_capacity = profile->capacity == 0 ? 8 : profile->capacity * 2;
+        xo_profile_page_t *new_pages = realloc(profile->pages, new_capacity * sizeof(xo_profile_page_t));
+        
+        if (!new_pages) {
+            mutex_unlock((mutex_t *)profile->lock);
+            free(path_copy);
+            return XO_ERROR_MEMORY_ALLOCATION;
+        }
+        
+        profile->pages = new_pages;
+        profile->capacity = new_capacity;
+    }
+    
+    xo_profile_page_t *page = &profile->pages[profile->count++];
+    page->filepath = path_copy;
+    page->total_ns = 0;
+    for (int i = 0; i < XO_PROFILE_STAGE_COUNT; i++) {
+        page->stage_ns[i] = stage_ns[i];
+        page->total_ns += stage_ns[i];
+    }
+    
+    mutex_unlock((mutex_t *)profile->lock);
+    
+    return XO_SUCCESS;
+}
+
+// Stop the build clock
+void xo_profile_finish(xo_profile_t *profile) {
+    if (profile) {
+        profile->wall_ns = xo_utils_time_ns() - profile->start_ns;
+    }
+}
+
+static double to_ms(uint64_t ns) {
+    return (double)ns / 1e6;
+}
+
+// qsort comparator ordering pages slowest first, by path on ties
+static int compare_pages_slowest(const void *a, const void *b) {
+    const xo_profile_page_t *pa = (const xo_profile_page_t *)a;
+    const xo_profile_page_t *pb = (const xo_profile_page_t *)b;
+    
+    if (pa->total_ns != pb->total_ns) {
+        return pa->total_ns < pb->total_ns ? 1 : -1;
+    }
+    
+    return strcmp(pa->filepath, pb->filepath);
+}
+
+// qsort comparator ordering pages by path, so reports diff cleanly
+static int compare_pages_path(const void *a, const void *b) {
+    return strcmp(((const xo_profile_page_t *)a)->filepath, ((const xo_profile_page_t *)b)->filepath);
+}
+
+static void stage_totals(const xo_profile_t *profile, uint64_t totals[XO_PROFILE_STAGE_COUNT], uint64_t *sum) {
+    *sum = 0;
+    for (int s = 0; s < XO_PROFILE_STAGE_COUNT; s++) {
+        totals[s] = 0;
+        for (size_t i = 0; i < profile->count; i++) {
+            totals[s] += profile->pages[i].stage_ns[s];
+        }
+        *sum += totals[s];
+    }
+}
+
+// Print stage totals and the slowest pages. Stage times are summed over all
+// workers, so with several workers they can add up to more than the wall time.
+void xo_profile_print(xo_profile_t *profile, size_t top_pages) {
+    if (!profile) {
+        return;
+    }
+    
+    uint64_t totals[XO_PROFILE_STAGE_COUNT];
+    uint64_t sum;
+    stage_totals(profile, totals, &sum);
+    
+    xo_utils_console_info("Profile: %zu pages built in %.1f ms", profile->count, to_ms(profile->wall_ns));
+    
+    printf("  %-10s %12s %8s %12s\n", "stage", "total ms", "share", "ms/page");
+    for (int s = 0; s < XO_PROFILE_STAGE_COUNT; s++) {
+        printf("  %-10s %12.2f %7.1f%% %12.4f\n", stage_names[s], to_ms(totals[s]),
+               sum > 0 ? 100.0 * (double)totals[s] / (double)sum : 0.0,
+               profile->count > 0 ? to_ms(totals[s]) / (double)profile->count : 0.0);
+    }
+    printf("  %-10s %12.2f\n", "all", to_ms(sum));
+    
+    if (profile->count == 0 || top_pages == 0) {
+        return;
+    }
+    
+    qsort(profile->pages, profile->count, sizeof(xo_profile_page_t), compare_pages_slowest);
+    
+    size_t shown = top_pages < profile->count ? top_pages : profile->count;
+    printf("\n  Slowest %zu pages (ms):\n", shown);
+    for (size_t i = 0; i < shown; i++) {
+        const xo_profile_page_t *page = &profile->pages[i];
+        printf("  %10.3f  %s (", to_ms(page->total_ns), page->filepath);
+        for (int s = 0; s < XO_PROFILE_STAGE_COUNT; s++) {
+            printf("%s%s %.3f", s > 0 ? ", " : "", stage_names[s], to_ms(page->stage_ns[s]));
+        }
+        printf(")\n");
+    }
+}
+
+// Write a string as a JSON string literal
+static void write_json_string(FILE *file, const char *str) {
+    fputc('"', file);
+    for (const unsigned char *c = (const unsigned char *)str; *c; c++) {
+        if (*c == '"' || *c == '\\') {
+            fprintf(file, "\\%c", *c);
+        } else if (*c < 0x20) {
+            fprintf(file, "\\u%04x", *c);
+        } else {
+            fputc(*c, file);
+        }
+    }
+    fputc('"', file);
+}
+
+static void write_json_stages(FILE *file, const uint64_t stage_ns[XO_PROFILE_STAGE_COUNT]) {
+    fputc('{', file);
+    for (int s = 0; s < XO_PROFILE_STAGE_COUNT; s++) {
+        fprintf(file, "%s\"%s\": %.4f", s > 0 ? ", " : "", stage_names[s], to_ms(stage_ns[s]));
+    }
+    fputc('}', file);
+}
+
+// Write the profile as JSON. Pages are sorted by path so reports from
+// different releases can be diffed; all times are in milliseconds.
+int xo_profile_write_json(xo_profile_t *profile, const char *filepath) {
+    if (!profile || !filepath) {
+        return XO_ERROR_MEMORY_ALLOCATION;
+    }
+    
+    FILE *file = fopen(filepath, "w");
+    if (!file) {
+        return XO_ERROR_FILE_NOT_FOUND;
+    }
+    
+    uint64_t totals[XO_PROFILE_STAGE_COUNT];
+    uint64_t sum;
+    stage_totals(profile, totals, &sum);
+    
+    qsort(profile->pages, profile->count, sizeof(xo_profile_page_t), compare_pages_path);
+    
+    fprintf(file, "{\n");
+    fprintf(file, "  \"version\": \"%s\",\n", XO_VERSION);
+    fprintf(file, "  \"pages_built\": %zu,\n", profile->count);
+    fprintf(file, "  \"wall_ms\": %.4f,\n", to_ms(profile->wall_ns));
+    fprintf(file, "  \"total_ms\": %.4f,\n", to_ms(sum));
+    fprintf(file, "  \"stages_ms\": ");
+    write_json_stages(file, totals);
+    fprintf(file, ",\n  \"pages\": [");
+    
+    for (size_t i = 0; i < profile->count; i++) {
+        const xo_profile_page_t *page = &profile->pages[i];
+        fprintf(file, "%s\n    {\"path\": ", i > 0 ? "," : "");
+        write_json_string(file, page->filepath);
+        fprintf(file, ", \"total_ms\": %.4f, \"stages_ms\": ", to_ms(page->total_ns));
+        write_json_stages(file, page->stage_ns);
+        fputc('}', file);
+    }
+    
+    fprintf(file, "%s]\n}\n", profile->count > 0 ? "\n  " : "");
+    
+    int result = ferror(file) ? XO_ERROR_FILE_NOT_FOUND : XO_SUCCESS;
+    if (fclose(file) != 0) {
+        result = XO_ERROR_FILE_NOT_FOUND;
+    }
+    
+    return result;
+}
@@ -0,0 +1,281 @@
+#include <string.h>
+#include "scan.h"
+
+// SSE2 is part of every x86-64 CPU, AVX2 is picked at runtime where the
+// compiler can build it and ask the CPU for it
+#if defined(__x86_64__) || defined(_M_X64) || (defined(__i386__) && defined(__SSE2__))
+    #include <emmintrin.h>
+    #define XO_SCAN_SSE2 1
+
+    #if defined(__GNUC__) || defined(__clang__)
+        #include <immintrin.h>
+        #define XO_SCAN_AVX2 1
+        #define XO_SCAN_TARGET_AVX2 __attribute__((target("avx2")))
+        // Helpers are inlined into the AVX2 scanners so they get VEX encoded,
+        // a call to legacy SSE code there stalls on the AVX/SSE transition
+        #define XO_SCAN_INLINE static inline __attribute__((always_inline))
+    #else
+        #define XO_SCAN_INLINE static __forceinline
+    #endif
+#endif
+
+// Bytes that can start markdown syntax, besides the newline ending a line and
+// the backslash escaping them. The vector scanners compare against the same set.
+static const bool special_table[256] = {
+    ['\n'] = true, ['#'] = true, ['*'] = true, ['-'] = true, ['_'] = true, ['`'] = true,
+    ['['] = true, [']'] = true, ['!'] = true, ['<'] = true, ['&'] = true, ['\\'] = true
+};
+
+bool xo_scan_is_special(unsigned char c) {
+    return special_table[c];
+}
+
+// Bytes HTML escaping replaces
+static const bool html_table[256] = {
+    ['&'] = true, ['<'] = true, ['>'] = true, ['"'] = true, ['\''] = true
+};
+
+static const char *scan_special_scalar(const char *p, const char *end) {
+    while (p < end && !special_table[(unsigned char)*p]) {
+        p++;
+    }
+
+    return p;
+}
+
+static const char *scan_html_scalar(const char *p, const char *end) {
+    while (p < end && !html_table[(unsigned char)*p]) {
+        p++;
+    }
+
+    return p;
+}
+
+static const char *scan_byte_scalar(const char *p, const char *end, char c) {
+    const char *found = memchr(p, c, (size_t)(end - p));
+    return found ? found : end;
+}
+
+#ifdef XO_SCAN_SSE2
+
+// Index of the lowest set bit of a non-zero mask
+XO_SCAN_INLINE unsigned lowest_bit(unsigned mask) {
+#if defined(__GNUC__) || defined(__clang__)
+    return (unsigned)__builtin_ctz(mask);
+#else
+    unsigned long index;
+    _BitScanForward(&index, mask);
+    return (unsigned)index;
+#endif
+}
+
+// Mask of the special bytes among the 16 at p
+XO_SCAN_INLINE unsigned special_mask_16(const char *p) {
+    __m128i chunk = _mm_loadu_si128((const __m128i *)p);
+    __m128i hits = _mm_cmpeq_epi8(chunk, _mm_set1_epi8('\n'));
+    hits = _mm_or_si128(hits, _mm_cmpeq_epi8(chunk, _mm_set1_epi8('#')));
+    hits = _mm_or_si128(hits, _mm_cmpeq_epi8(chunk, _mm_set1_epi8('*')));
+    hits = _mm_or_si128(hits, _mm_cmpeq_epi8(chunk, _mm_set1_epi8('-')));
+    hits = _mm_or_si128(hits, _mm_cmpeq_epi8(chunk, _mm_set1_epi8('_')));
+    hits = _mm_or_si128(hits, _mm_cmpeq_epi8(chunk, _mm_set1_epi8('`')));
+    hits = _mm_or_si128(hits, _mm_cmpeq_epi8(chunk, _mm_set1_epi8('[')));
+    hits = _mm_or_si128(hits, _mm_cmpeq_epi8(chunk, _mm_set1_epi8(']')));
+    hits = _mm_or_si128(hits, _mm_cmpeq_epi8(chunk, _mm_set1_epi8('!')));
+    hits = _mm_or_si128(hits, _mm_cmpeq_epi8(chunk, _mm_set1_epi8('<')));
+    hits = _mm_or_si128(hits, _mm_cmpeq_epi8(chunk, _mm_set1_epi8('&')));
+    hits = _mm_or_si128(hits, _mm_cmpeq_epi8(chunk, _mm_set1_epi8('\\')));
+    return (unsigned)_mm_movemask_epi8(hits);
+}
+
+// Mask of the bytes HTML escaping replaces among the 16 at p
+XO_SCAN_INLINE unsigned html_mask_16(const char *p) {
+    __m128i chunk = _mm_loadu_si128((const __m128i *)p);
+    __m128i hits = _mm_cmpeq_epi8(chunk, _mm_set1_epi8('&'));
+    hits = _mm_or_si128(hits, _mm_cmpeq_epi8(chunk, _mm_set1_epi8('<')));
+    hits = _mm_or_si128(hits, _mm_cmpeq_epi8(chunk, _mm_set1_epi8('>')));
+    hits = _mm_or_si128(hits, _mm_cmpeq_epi8(chunk, _mm_set1_epi8('"')));
+    hits = _mm_or_si128(hits, _mm_cmpeq_epi8(chunk, _mm_set1_epi8('\'')));
+    return (unsigned)_mm_movemask_epi8(hits);
+}
+
+// Mask of the bytes equal to c among the 16 at p
+XO_SCAN_INLINE unsigned byte_mask_16(const char *p, char c) {
+    __m128i chunk = _mm_loadu_si128((const __m128i *)p);
+    return (unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, _mm_set1_epi8(c)));
+}
+
+// Finish a scan of [p, end) that started at start. Ranges of 16 bytes or more
+// end with a single load of their last 16 bytes, overlapping what was already
+// scanned, instead of a byte loop.
+#define SCAN_TAIL_16(start, p, end, mask_16)                                \
+    do {                                                                    \
+        while ((end) - (p) >= 16) {                                         \
+            unsigned mask = mask_16(p);                                     \
+            if (mask) {                                                     \
+                return (p) + lowest_bit(mask);                              \
+            }                                                               \
+            (p) += 16;                                                      \
+        }                                                                   \
+        if ((p) < (end) && (end) - (start) >= 16) {                         \
+            const char *last = (end) - 16;                                  \
+            unsigned mask = mask_16(last) >> ((p) - last);                  \
+            return mask ? (p) + lowest_bit(mask) : (end);                   \
+        }                                                                   \
+    } while (0)
+
+static const char *scan_byte_sse2(const char *p, const char *end, char c) {
+    const char *start = p;
+    #define BYTE_MASK_16(q) byte_mask_16((q), c)
+    SCAN_TAIL_16(start, p, end, BYTE_MASK_16);
+    #undef BYTE_MASK_16
+
+    return scan_byte_scalar(p, end, c);
+}
+
+static const char *scan_special_sse2(const char *p, const char *end) {
+    const char *start = p;
+    SCAN_TAIL_16(start, p, end, special_mask_16);
+
+    return scan_special_scalar(p, end);
+}
+
+static const char *scan_html_sse2(const char *p, const char *end) {
+    const char *start = p;
+    SCAN_TAIL_16(start, p, end, html_mask_16);
+
+    return scan_html_scalar(p, end);
+}
+
+#endif
+
+#ifdef XO_SCAN_AVX2
+
+XO_SCAN_TARGET_AVX2
+static const char *scan_byte_avx2(const char *p, const char *end, char c) {
+    const char *start = p;
+    const __m256i needle = _mm256_set1_epi8(c);
+
+    for (; end - p >= 32; p += 32) {
+        __m256i chunk = _mm256_loadu_si256((const __m256i *)p);
+        unsigned mask = (unsigned)_mm256_movemask_epi8(_mm256_cmpeq_epi8(chunk, needle));
+        if (mask) {
+            return p + lowest_bit(mask);
+        }
+    }
+
+    #define BYTE_MASK_16(q) byte_mask_16((q), c)
+    SCAN_TAIL_16(start, p, end, BYTE_MASK_16);
+    #undef BYTE_MASK_16
+
+    return scan_byte_scalar(p, end, c);
+}
+
+XO_SCAN_TARGET_AVX2
+static const char *scan_special_avx2(const char *p, const char *end) {
+    const char *start = p;
+
+    for (; end - p >= 32; p += 32) {
+        __m256i chunk = _mm256_loadu_si256((const __m256i *)p);
+        __m256i hits = _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('\n'));
+        hits = _mm256_or_si256(hits, _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('#')));
+        hits = _mm256_or_si256(hits, _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('*')));
+        hits = _mm256_or_si256(hits, _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('-')));
+        hits = _mm256_or_si256(hits, _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('_')));
+        hits = _mm256_or_si256(hits, _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('`')));
+        hits = _mm256_or_si256(hits, _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('[')));
+        hits = _mm256_or_si256(hits, _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8(']')));
+        hits = _mm256_or_si256(hits, _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('!')));
+        hits = _mm256_or_si256(hits, _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('<')));
+        hits = _mm256_or_si256(hits, _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('&')));
+        hits = _mm256_or_si256(hits, _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('\\')));
+
+        unsigned mask = (unsigned)_mm256_movemask_epi8(hits);
+        if (mask) {
+            return p + lowest_bit(mask);
+        }
+    }
+
+    SCAN_TAIL_16(start, p, end, special_mask_16);
+
+    return scan_special_scalar(p, end);
+}
+
+XO_SCAN_TARGET_AVX2
+static const char *scan_html_avx2(const char *p, const char *end) {
+    const char *start = p;
+
+    for (; end - p >= 32; p += 32) {
+        __m256i chunk = _mm256_loadu_si256((const __m256i *)p);
+        __m256i hits = _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('&'));
+        hits = _mm256_or_si256(hits, _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('<')));
+        hits = _mm256_or_si256(hits, _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('>')));
+        hits = _mm256_or_si256(hits, _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('"')));
+        hits = _mm256_or_si256(hits, _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('\'')));
+
+        unsigned mask = (unsigned)_mm256_movemask_epi8(hits);
+        if (mask) {
+            return p + lowest_bit(mask);
+        }
+    }
+
+    SCAN_TAIL_16(start, p, end, html_mask_16);
+
+    return scan_html_scalar(p, end);
+}
+
+// The CPU model is filled in by a libgcc constructor before main, so this is
+// a plain read that is safe from any thread
+static bool cpu_has_avx2(void) {
+    return __builtin_cpu_supports("avx2");
+}
+
+#endif
+
+// Find the next occurrence of c in [p, end)
+const char *xo_scan_byte(const char *p, const char *end, char c) {
+#if defined(XO_SCAN_AVX2)
+    return cpu_has_avx2() ? scan_byte_avx2(p, end, c) : scan_byte_sse2(p, end, c);
+#elif defined(XO_SCAN_SSE2)
+    return scan_byte_sse2(p, end, c);
+#else
+    return scan_byte_scalar(p, end, c);
+#endif
+}
+
+// Find the next newline, backslash or byte that can start markdown syntax in [p, end)
+const char *xo_scan_special(const char *p, const char *end) {
+#if defined(XO_SCAN_AVX2)
+    return cpu_has_avx2() ? scan_special_avx2(p, end) : scan_special_sse2(p, end);
+#elif defined(XO_SCAN_SSE2)
+    return scan_special_sse2(p, end);
+#else
+    return scan_special_scalar(p, end);
+#endif
+}
+
+// Find the next byte HTML escaping replaces (& < > " ') in [p, end)
+const char *xo_scan_html(const char *p, const char *end) {
+    // Short runs, like most link destinations, aren't worth a vector load
+    if (end - p < 16) {
+        return scan_html_scalar(p, end);
+    }
+
+#if defined(XO_SCAN_AVX2)
+    return cpu_has_avx2() ? scan_html_avx2(p, end) : scan_html_sse2(p, end);
+#elif defined(XO_SCAN_SSE2)
+    return scan_html_sse2(p, end);
+#else
+    return scan_html_scalar(p, end);
+#endif
+}
+
+// Name of the scanner used on this CPU
+const char *xo_scan_impl(void) {
+#if defined(XO_SCAN_AVX2)
+    return cpu_has_avx2() ? "avx2" : "sse2";
+#elif defined(XO_SCAN_SSE2)
+    return "sse2";
+#else
+    return "scalar";
+#endif
+}
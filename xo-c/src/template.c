@@ -3,6 +3,9 @@
 #include <string.h>
 #include <ctype.h>
 #include "template.h"
+#include "utils.h"
+#include "scan.h"
+#include "writer.h"
 
 // Initialize a template context
 int xo_template_context_init(xo_template_context_t *ctx) {
@@ -14,6 +17,22 @@ int xo_template_context_init(xo_template_context_t *ctx) {
     ctx->values = NULL;
     ctx->count = 0;
     ctx->capacity = 0;
+    ctx->index = NULL;
+    ctx->index_capacity = 0;
+    ctx->shape = 0;
+    ctx->arena = NULL;
+    
+    return XO_SUCCESS;
+}
+
+// Initialize a template context allocating from an arena. Keys, values and
+// rendered output then live until the arena is reset.
+int xo_template_context_init_arena(xo_template_context_t *ctx, xo_arena_t *arena) {
+    if (xo_template_context_init(ctx) != XO_SUCCESS) {
+        return XO_ERROR_MEMORY_ALLOCATION;
+    }
+    
+    ctx->arena = arena;
     
     return XO_SUCCESS;
 }
@@ -24,9 +43,15 @@ void xo_template_context_free(xo_template_context_t *ctx) {
         return;
     }
     
+    // Memory owned by an arena is released with the arena
+    if (ctx->arena) {
+        xo_template_context_init(ctx);
+        return;
+    }
+    
     // Free keys
     for (size_t i = 0; i < ctx->count; i++) {
-        free(ctx->keys[i]);
+        free(ctx->keys[i].name);
         
         // Free string values
         if (ctx->values[i].type == XO_TPLVAL_STRING) {
@@ -37,95 +62,213 @@ void xo_template_context_free(xo_template_context_t *ctx) {
     // Free arrays
     free(ctx->keys);
     free(ctx->values);
+    free(ctx->index);
     
     // Reset structure
-    ctx->keys = NULL;
-    ctx->values = NULL;
-    ctx->count = 0;
-    ctx->capacity = 0;
+    xo_template_context_init(ctx);
 }
 
-// Add a string value to the context
-int xo_template_context_add_string(xo_template_context_t *ctx, const char *key, const char *value) {
-    if (!ctx || !key || !value) {
+// Find the entry of a key, or -1 when the context doesn't have it
+static long context_find(const xo_template_context_t *ctx, const char *key, size_t key_len, uint64_t hash) {
+    if (ctx->index_capacity == 0) {
+        return -1;
+    }
+    
+    size_t mask = ctx->index_capacity - 1;
+    size_t slot = (size_t)hash & mask;
+    
+    while (ctx->index[slot] != 0) {
+        const xo_template_key_t *entry = &ctx->keys[ctx->index[slot] - 1];
+        if (entry->hash == hash && entry->length == key_len && memcmp(entry->name, key, key_len) == 0) {
+            return (long)(ctx->index[slot] - 1);
+        }
+        slot = (slot + 1) & mask;
+    }
+    
+    return -1;
+}
+
+// Double the hash index and reinsert every key
+static int context_grow_index(xo_template_context_t *ctx) {
+    size_t new_capacity = ctx->index_capacity == 0 ? 16 : ctx->index_capacity * 2;
+    size_t *new_index;
+    if (ctx->arena) {
+        new_index = xo_arena_alloc(ctx->arena, new_capacity * sizeof(size_t));
+        if (new_index) {
+            memset(new_index, 0, new_capacity * sizeof(size_t));
+        }
+    } else {
+        new_index = calloc(new_capacity, sizeof(size_t));
+    }
+    if (!new_index) {
         return XO_ERROR_MEMORY_ALLOCATION;
     }
     
-    // Check if we need to resize the arrays
-    if (ctx->count >= ctx->capacity) {
-        size_t new_capacity = ctx->capacity == 0 ? 8 : ctx->capacity * 2;
-        
-        char **new_keys = realloc(ctx->keys, new_capacity * sizeof(char *));
-        if (!new_keys) {
-            return XO_ERROR_MEMORY_ALLOCATION;
+    size_t mask = new_capacity - 1;
+    for (size_t i = 0; i < ctx->count; i++) {
+        size_t slot = (size_t)ctx->keys[i].hash & mask;
+        while (new_index[slot] != 0) {
+            slot = (slot + 1) & mask;
         }
-        
-        xo_template_value_t *new_values = realloc(ctx->values, new_capacity * sizeof(xo_template_value_t));
-        if (!new_values) {
-            free(new_keys);
+        new_index[slot] = i + 1;
+    }
+    
+    if (!ctx->arena) {
+        free(ctx->index);
+    }
+    ctx->index = new_index;
+    ctx->index_capacity = new_capacity;
+    
+    return XO_SUCCESS;
+}
+
+// Make room for one more context entry
+static int context_grow(xo_template_context_t *ctx) {
+    if ((ctx->count + 1) * 2 > ctx->index_capacity && context_grow_index(ctx) != XO_SUCCESS) {
+        return XO_ERROR_MEMORY_ALLOCATION;
+    }
+    
+    if (ctx->count < ctx->capacity) {
+        return XO_SUCCESS;
+    }
+    
+    size_t new_capacity = ctx->capacity == 0 ? 8 : ctx->capacity * 2;
+    
+    if (ctx->arena) {
+        xo_template_key_t *new_keys = xo_arena_realloc(ctx->arena, ctx->keys,
+                                                       ctx->capacity * sizeof(xo_template_key_t),
+                                                       new_capacity * sizeof(xo_template_key_t));
+        xo_template_value_t *new_values = xo_arena_realloc(ctx->arena, ctx->values,
+                                                           ctx->capacity * sizeof(xo_template_value_t),
+                                                           new_capacity * sizeof(xo_template_value_t));
+        if (!new_keys || !new_values) {
             return XO_ERROR_MEMORY_ALLOCATION;
         }
         
         ctx->keys = new_keys;
         ctx->values = new_values;
         ctx->capacity = new_capacity;
+        
+        return XO_SUCCESS;
     }
     
-    // Add the new item
-    ctx->keys[ctx->count] = strdup(key);
-    if (!ctx->keys[ctx->count]) {
+    xo_template_key_t *new_keys = realloc(ctx->keys, new_capacity * sizeof(xo_template_key_t));
+    if (!new_keys) {
         return XO_ERROR_MEMORY_ALLOCATION;
     }
+    ctx->keys = new_keys;
     
-    ctx->values[ctx->count].type = XO_TPLVAL_STRING;
-    ctx->values[ctx->count].value.string_val = strdup(value);
-    
-    if (!ctx->values[ctx->count].value.string_val) {
-        free(ctx->keys[ctx->count]);
+    xo_template_value_t *new_values = realloc(ctx->values, new_capacity * sizeof(xo_template_value_t));
+    if (!new_values) {
         return XO_ERROR_MEMORY_ALLOCATION;
     }
     
-    ctx->count++;
+    ctx->values = new_values;
+    ctx->capacity = new_capacity;
     
     return XO_SUCCESS;
 }
 
-// Add an integer value to the context
-int xo_template_context_add_int(xo_template_context_t *ctx, const char *key, int value) {
-    if (!ctx || !key) {
-        return XO_ERROR_MEMORY_ALLOCATION;
+// Copy a length-delimited string into the context's memory
+static char *context_strndup(const xo_template_context_t *ctx, const char *str, size_t length) {
+    return ctx->arena ? xo_arena_strndup(ctx->arena, str, length) : xo_utils_strndup(str, length);
+}
+
+// Add a key to the context and return its entry, whose value the caller sets.
+// A key the context already has keeps its first value, as lookups always
+// returned the first match, and NULL is returned with *result set to XO_SUCCESS.
+static xo_template_value_t *context_add(xo_template_context_t *ctx, const char *key, size_t key_len, int *result) {
+    *result = XO_ERROR_MEMORY_ALLOCATION;
+    
+    uint64_t hash = xo_utils_hash64(key, key_len, 0);
+    if (context_find(ctx, key, key_len, hash) >= 0) {
+        *result = XO_SUCCESS;
+        return NULL;
     }
     
     // Check if we need to resize the arrays
-    if (ctx->count >= ctx->capacity) {
-        size_t new_capacity = ctx->capacity == 0 ? 8 : ctx->capacity * 2;
-        
-        char **new_keys = realloc(ctx->keys, new_capacity * sizeof(char *));
-        if (!new_keys) {
-            return XO_ERROR_MEMORY_ALLOCATION;
-        }
-        
-        xo_template_value_t *new_values = realloc(ctx->values, new_capacity * sizeof(xo_template_value_t));
-        if (!new_values) {
-            free(new_keys);
-            return XO_ERROR_MEMORY_ALLOCATION;
+    if (context_grow(ctx) != XO_SUCCESS) {
+        return NULL;
+    }
+    
+    xo_template_key_t *entry = &ctx->keys[ctx->count];
+    entry->name = context_strndup(ctx, key, key_len);
+    if (!entry->name) {
+        return NULL;
+    }
+    entry->length = key_len;
+    entry->hash = hash;
+    
+    *result = XO_SUCCESS;
+    return &ctx->values[ctx->count];
+}
+
+// Index the entry added last, once its value is set
+static void context_commit(xo_template_context_t *ctx) {
+    size_t mask = ctx->index_capacity - 1;
+    size_t slot = (size_t)ctx->keys[ctx->count].hash & mask;
+    while (ctx->index[slot] != 0) {
+        slot = (slot + 1) & mask;
+    }
+    ctx->index[slot] = ctx->count + 1;
+    
+    ctx->shape = xo_utils_hash64(&ctx->keys[ctx->count].hash, sizeof(uint64_t), ctx->shape);
+    ctx->count++;
+}
+
+// Add a string value to the context
+int xo_template_context_add_string(xo_template_context_t *ctx, const char *key, const char *value) {
+    if (!key || !value) {
+        return XO_ERROR_MEMORY_ALLOCATION;
+    }
+    
+    return xo_template_context_add_string_n(ctx, key, strlen(key), value, strlen(value));
+}
+
+// Add a string value given as length-delimited key and value to the context
+int xo_template_context_add_string_n(xo_template_context_t *ctx, const char *key, size_t key_len,
+                                     const char *value, size_t value_len) {
+    if (!ctx || !key || !value) {
+        return XO_ERROR_MEMORY_ALLOCATION;
+    }
+    
+    int result;
+    xo_template_value_t *entry = context_add(ctx, key, key_len, &result);
+    if (!entry) {
+        return result;
+    }
+    
+    entry->type = XO_TPLVAL_STRING;
+    entry->value.string_val = context_strndup(ctx, value, value_len);
+    
+    if (!entry->value.string_val) {
+        if (!ctx->arena) {
+            free(ctx->keys[ctx->count].name);
         }
-        
-        ctx->keys = new_keys;
-        ctx->values = new_values;
-        ctx->capacity = new_capacity;
+        return XO_ERROR_MEMORY_ALLOCATION;
     }
     
-    // Add the new item
-    ctx->keys[ctx->count] = strdup(key);
-    if (!ctx->keys[ctx->count]) {
+    context_commit(ctx);
+    
+    return XO_SUCCESS;
+}
+
+// Add an integer value to the context
+int xo_template_context_add_int(xo_template_context_t *ctx, const char *key, int value) {
+    if (!ctx || !key) {
         return XO_ERROR_MEMORY_ALLOCATION;
     }
     
-    ctx->values[ctx->count].type = XO_TPLVAL_INT;
-    ctx->values[ctx->count].value.int_val = value;
+    int result;
+    xo_template_value_t *entry = context_add(ctx, key, strlen(key), &result);
+    if (!entry) {
+        return result;
+    }
+    
+    entry->type = XO_TPLVAL_INT;
+    entry->value.int_val = value;
     
-    ctx->count++;
+    context_commit(ctx);
     
     return XO_SUCCESS;
 }
@@ -136,36 +279,129 @@ int xo_template_context_add_bool(xo_template_context_t *ctx, const char *key, bo
         return XO_ERROR_MEMORY_ALLOCATION;
     }
     
-    // Check if we need to resize the arrays
-    if (ctx->count >= ctx->capacity) {
-        size_t new_capacity = ctx->capacity == 0 ? 8 : ctx->capacity * 2;
-        
-        char **new_keys = realloc(ctx->keys, new_capacity * sizeof(char *));
-        if (!new_keys) {
-            return XO_ERROR_MEMORY_ALLOCATION;
-        }
-        
-        xo_template_value_t *new_values = realloc(ctx->values, new_capacity * sizeof(xo_template_value_t));
-        if (!new_values) {
-            free(new_keys);
-            return XO_ERROR_MEMORY_ALLOCATION;
+    int result;
+    xo_template_value_t *entry = context_add(ctx, key, strlen(key), &result);
+    if (!entry) {
+        return result;
+    }
+    
+    entry->type = XO_TPLVAL_BOOL;
+    entry->value.bool_val = value;
+    
+    context_commit(ctx);
+    
+    return XO_SUCCESS;
+}
+
+// Add a list to the context by reference, the list must outlive the context
+int xo_template_context_add_list(xo_template_context_t *ctx, const char *key, const xo_template_list_t *list) {
+    if (!ctx || !key || !list) {
+        return XO_ERROR_MEMORY_ALLOCATION;
+    }
+    
+    int result;
+    xo_template_value_t *entry = context_add(ctx, key, strlen(key), &result);
+    if (!entry) {
+        return result;
+    }
+    
+    entry->type = XO_TPLVAL_LIST;
+    entry->value.list_val = list;
+    
+    context_commit(ctx);
+    
+    return XO_SUCCESS;
+}
+
+// Add a map to the context by reference, the map must outlive the context
+int xo_template_context_add_map(xo_template_context_t *ctx, const char *key, const xo_template_context_t *map) {
+    if (!ctx || !key || !map) {
+        return XO_ERROR_MEMORY_ALLOCATION;
+    }
+    
+    int result;
+    xo_template_value_t *entry = context_add(ctx, key, strlen(key), &result);
+    if (!entry) {
+        return result;
+    }
+    
+    entry->type = XO_TPLVAL_MAP;
+    entry->value.map_val = map;
+    
+    context_commit(ctx);
+    
+    return XO_SUCCESS;
+}
+
+// Initialize a list allocating from an arena. The items and their strings
+// live until the arena is reset.
+int xo_template_list_init(xo_template_list_t *list, xo_arena_t *arena) {
+    if (!list || !arena) {
+        return XO_ERROR_MEMORY_ALLOCATION;
+    }
+    
+    list->items = NULL;
+    list->count = 0;
+    list->capacity = 0;
+    list->arena = arena;
+    
+    return XO_SUCCESS;
+}
+
+// Make room for one more item, keeping the items contiguous
+static xo_template_value_t *list_grow(xo_template_list_t *list) {
+    if (list->count >= list->capacity) {
+        size_t new_capacity = list->capacity == 0 ? 8 : list->capacity * 2;
+        xo_template_value_t *new_items = xo_arena_realloc(list->arena, list->items,
+                                                          list->capacity * sizeof(xo_template_value_t),
+                                                          new_capacity * sizeof(xo_template_value_t));
+        if (!new_items) {
+            return NULL;
         }
         
-        ctx->keys = new_keys;
-        ctx->values = new_values;
-        ctx->capacity = new_capacity;
+        list->items = new_items;
+        list->capacity = new_capacity;
     }
     
-    // Add the new item
-    ctx->keys[ctx->count] = strdup(key);
-    if (!ctx->keys[ctx->count]) {
+    return &list->items[list->count];
+}
+
+// Append a string to a list
+int xo_template_list_add_string(xo_template_list_t *list, const char *value) {
+    if (!list || !value) {
         return XO_ERROR_MEMORY_ALLOCATION;
     }
     
-    ctx->values[ctx->count].type = XO_TPLVAL_BOOL;
-    ctx->values[ctx->count].value.bool_val = value;
+    xo_template_value_t *item = list_grow(list);
+    if (!item) {
+        return XO_ERROR_MEMORY_ALLOCATION;
+    }
     
-    ctx->count++;
+    item->type = XO_TPLVAL_STRING;
+    item->value.string_val = xo_arena_strdup(list->arena, value);
+    if (!item->value.string_val) {
+        return XO_ERROR_MEMORY_ALLOCATION;
+    }
+    
+    list->count++;
+    
+    return XO_SUCCESS;
+}
+
+// Append a map to a list by reference, the map must outlive the list
+int xo_template_list_add_map(xo_template_list_t *list, const xo_template_context_t *map) {
+    if (!list || !map) {
+        return XO_ERROR_MEMORY_ALLOCATION;
+    }
+    
+    xo_template_value_t *item = list_grow(list);
+    if (!item) {
+        return XO_ERROR_MEMORY_ALLOCATION;
+    }
+    
+    item->type = XO_TPLVAL_MAP;
+    item->value.map_val = map;
+    list->count++;
     
     return XO_SUCCESS;
 }
@@ -181,7 +417,8 @@ int xo_template_context_from_frontmatter(xo_template_context_t *ctx, const xo_fr
     
     // Copy frontmatter items to context
     for (size_t i = 0; i < frontmatter->count; i++) {
-        xo_template_context_add_string(ctx, frontmatter->items[i].key, frontmatter->items[i].value);
+        const xo_frontmatter_item_t *item = &frontmatter->items[i];
+        xo_template_context_add_string_n(ctx, item->key.data, item->key.length, item->value.data, item->value.length);
     }
     
     return XO_SUCCESS;
@@ -194,13 +431,45 @@ int xo_template_partials_init(xo_template_partials_t *partials) {
     }
     
     partials->names = NULL;
-    partials->contents = NULL;
+    partials->templates = NULL;
+    partials->paths = NULL;
     partials->count = 0;
     partials->capacity = 0;
+    partials->index = NULL;
+    partials->index_capacity = 0;
+    partials->retired = NULL;
+    partials->retired_count = 0;
+    partials->retired_capacity = 0;
     
     return XO_SUCCESS;
 }
 
+// Compile a partial's content into a template of its own, NULL with the
+// error in result when it doesn't compile
+static xo_template_t *partial_compile(const char *content, int *result) {
+    xo_template_t *tpl = malloc(sizeof(xo_template_t));
+    if (!tpl) {
+        *result = XO_ERROR_MEMORY_ALLOCATION;
+        return NULL;
+    }
+    
+    *result = xo_template_compile(content, strlen(content), tpl);
+    if (*result != XO_SUCCESS) {
+        free(tpl);
+        return NULL;
+    }
+    
+    return tpl;
+}
+
+// Free a partial compiled by partial_compile
+static void partial_destroy(xo_template_t *tpl) {
+    if (tpl) {
+        xo_template_free(tpl);
+        free(tpl);
+    }
+}
+
 // Free resources used by template partials
 void xo_template_partials_free(xo_template_partials_t *partials) {
     if (!partials) {
@@ -209,23 +478,131 @@ void xo_template_partials_free(xo_template_partials_t *partials) {
     
     for (size_t i = 0; i < partials->count; i++) {
         free(partials->names[i]);
-        free(partials->contents[i]);
+        partial_destroy(partials->templates[i]);
+        free(partials->paths[i]);
+    }
+    
+    for (size_t i = 0; i < partials->retired_count; i++) {
+        partial_destroy(partials->retired[i]);
     }
     
     free(partials->names);
-    free(partials->contents);
+    free(partials->templates);
+    free(partials->paths);
+    free(partials->index);
+    free(partials->retired);
     
-    partials->names = NULL;
-    partials->contents = NULL;
-    partials->count = 0;
-    partials->capacity = 0;
+    xo_template_partials_init(partials);
 }
 
-// Add a partial to the collection
-int xo_template_partials_add(xo_template_partials_t *partials, const char *name, const char *content) {
-    if (!partials || !name || !content) {
+// Find the index of a partial by name, or -1 when there is none
+static long partials_find(const xo_template_partials_t *partials, const char *name, size_t name_len) {
+    if (partials->index_capacity == 0) {
+        return -1;
+    }
+    
+    size_t mask = partials->index_capacity - 1;
+    size_t slot = (size_t)xo_utils_hash64(name, name_len, 0) & mask;
+    
+    while (partials->index[slot] != 0) {
+        size_t i = partials->index[slot] - 1;
+        if (strncmp(partials->names[i], name, name_len) == 0 && partials->names[i][name_len] == '\0') {
+            return (long)i;
+        }
+        slot = (slot + 1) & mask;
+    }
+    
+    return -1;
+}
+
+// Rebuild the hash index at the given capacity and reinsert every partial
+static int partials_rebuild_index(xo_template_partials_t *partials, size_t new_capacity) {
+    size_t *new_index = calloc(new_capacity, sizeof(size_t));
+    if (!new_index) {
+        return XO_ERROR_MEMORY_ALLOCATION;
+    }
+    
+    size_t mask = new_capacity - 1;
+    for (size_t i = 0; i < partials->count; i++) {
+        size_t slot = (size_t)xo_utils_hash64(partials->names[i], strlen(partials->names[i]), 0) & mask;
+        while (new_index[slot] != 0) {
+            slot = (slot + 1) & mask;
+        }
+        new_index[slot] = i + 1;
+    }
+    
+    free(partials->index);
+    partials->index = new_index;
+    partials->index_capacity = new_capacity;
+    
+    return XO_SUCCESS;
+}
+
+// Double the hash index
+static int partials_grow_index(xo_template_partials_t *partials) {
+    return partials_rebuild_index(partials, partials->index_capacity == 0 ? 16 : partials->index_capacity * 2);
+}
+
+// Keep a template pages being rendered may still point into until the registry is freed
+static int partials_retire(xo_template_partials_t *partials, xo_template_t *tpl) {
+    if (partials->retired_count >= partials->retired_capacity) {
+        size_t new_capacity = partials->retired_capacity == 0 ? 8 : partials->retired_capacity * 2;
+        xo_template_t **new_retired = realloc(partials->retired, new_capacity * sizeof(xo_template_t *));
+        if (!new_retired) {
+            return XO_ERROR_MEMORY_ALLOCATION;
+        }
+        
+        partials->retired = new_retired;
+        partials->retired_capacity = new_capacity;
+    }
+    
+    partials->retired[partials->retired_count++] = tpl;
+    
+    return XO_SUCCESS;
+}
+
+// Replace the content of an existing partial. The old template is kept until
+// the registry is freed, as pages being rendered may still point into it.
+static int partials_replace(xo_template_partials_t *partials, size_t i, const char *content) {
+    int result;
+    xo_template_t *new_template = partial_compile(content, &result);
+    if (!new_template) {
+        return result;
+    }
+    
+    if (partials_retire(partials, partials->templates[i]) != XO_SUCCESS) {
+        partial_destroy(new_template);
+        return XO_ERROR_MEMORY_ALLOCATION;
+    }
+    partials->templates[i] = new_template;
+    
+    return XO_SUCCESS;
+}
+
+// Remove a partial, the last one takes its place. Its template is retired,
+// as pages being rendered may still point into it.
+static int partials_remove(xo_template_partials_t *partials, size_t i) {
+    if (partials_retire(partials, partials->templates[i]) != XO_SUCCESS) {
         return XO_ERROR_MEMORY_ALLOCATION;
     }
+    free(partials->names[i]);
+    free(partials->paths[i]);
+    
+    size_t last = --partials->count;
+    partials->names[i] = partials->names[last];
+    partials->templates[i] = partials->templates[last];
+    partials->paths[i] = partials->paths[last];
+    
+    // Open addressing can't clear a slot in place, removals are rare so the index is rebuilt
+    return partials_rebuild_index(partials, partials->index_capacity);
+}
+
+// Add a partial with the file it was loaded from, replacing one with the same name
+static int partials_add(xo_template_partials_t *partials, const char *name, const char *content, const char *path) {
+    long existing = partials_find(partials, name, strlen(name));
+    if (existing >= 0) {
+        return partials_replace(partials, (size_t)existing, content);
+    }
     
     // Check if we need to resize the arrays
     if (partials->count >= partials->capacity) {
@@ -235,235 +612,734 @@ int xo_template_partials_add(xo_template_partials_t *partials, const char *name,
         if (!new_names) {
             return XO_ERROR_MEMORY_ALLOCATION;
         }
+        partials->names = new_names;
         
-        char **new_contents = realloc(partials->contents, new_capacity * sizeof(char *));
-        if (!new_contents) {
-            free(new_names);
+        xo_template_t **new_templates = realloc(partials->templates, new_capacity * sizeof(xo_template_t *));
+        if (!new_templates) {
             return XO_ERROR_MEMORY_ALLOCATION;
         }
+        partials->templates = new_templates;
+        
+        char **new_paths = realloc(partials->paths, new_capacity * sizeof(char *));
+        if (!new_paths) {
+            return XO_ERROR_MEMORY_ALLOCATION;
+        }
+        partials->paths = new_paths;
         
-        partials->names = new_names;
-        partials->contents = new_contents;
         partials->capacity = new_capacity;
     }
     
-    // Add the new partial
-    partials->names[partials->count] = strdup(name);
-    if (!partials->names[partials->count]) {
+    // Keep the hash index at most half full
+    if ((partials->count + 1) * 2 > partials->index_capacity && partials_grow_index(partials) != XO_SUCCESS) {
         return XO_ERROR_MEMORY_ALLOCATION;
     }
     
-    partials->contents[partials->count] = strdup(content);
-    if (!partials->contents[partials->count]) {
+    // Add the new partial
+    int result;
+    partials->templates[partials->count] = partial_compile(content, &result);
+    if (!partials->templates[partials->count]) {
+        return result;
+    }
+    partials->names[partials->count] = strdup(name);
+    partials->paths[partials->count] = path ? strdup(path) : NULL;
+    
+    if (!partials->names[partials->count] || (path && !partials->paths[partials->count])) {
         free(partials->names[partials->count]);
+        partial_destroy(partials->templates[partials->count]);
+        free(partials->paths[partials->count]);
         return XO_ERROR_MEMORY_ALLOCATION;
     }
     
+    size_t mask = partials->index_capacity - 1;
+    size_t slot = (size_t)xo_utils_hash64(name, strlen(name), 0) & mask;
+    while (partials->index[slot] != 0) {
+        slot = (slot + 1) & mask;
+    }
+    partials->index[slot] = partials->count + 1;
+    
     partials->count++;
     
     return XO_SUCCESS;
 }
 
-// Find a value in the context by key
-static const char *get_context_value(const xo_template_context_t *ctx, const char *key) {
-    if (!ctx || !key) {
-        return NULL;
-    }
-    
-    // Search for the key
-    for (size_t i = 0; i < ctx->count; i++) {
-        if (strcmp(ctx->keys[i], key) == 0) {
-            // Convert the value to string based on its type
-            switch (ctx->values[i].type) {
-                case XO_TPLVAL_STRING:
-                    return ctx->values[i].value.string_val;
-                
-                case XO_TPLVAL_INT: {
-                    // Convert int to string using a static buffer
-                    // This is not thread-safe but sufficient for our needs
-                    static char int_buffer[32];
-                    sprintf(int_buffer, "%d", ctx->values[i].value.int_val);
-                    return int_buffer;
-                }
-                
-                case XO_TPLVAL_BOOL:
-                    return ctx->values[i].value.bool_val ? "true" : "false";
-                
-                default:
-                    return NULL;
-            }
-        }
+// Add a partial to the collection, replacing one with the same name
+int xo_template_partials_add(xo_template_partials_t *partials, const char *name, const char *content) {
+    if (!partials || !name || !content) {
+        return XO_ERROR_MEMORY_ALLOCATION;
     }
     
-    return NULL;
+    return partials_add(partials, name, content, NULL);
 }
 
-// Find a partial by name
-static const char *get_partial(const xo_template_partials_t *partials, const char *name) {
-    if (!partials || !name) {
-        return NULL;
+// Name of a partial file, the path relative to the partials directory
+// without the extension, so dir/blog/card.md is "blog/card"
+static void partial_file_name(const char *dir_path, const char *filepath, char name[XO_MAX_PATH]) {
+    size_t dir_len = strlen(dir_path);
+    const char *relative = filepath;
+    if (strncmp(filepath, dir_path, dir_len) == 0 && (filepath[dir_len] == '/' || filepath[dir_len] == '\\')) {
+        relative = filepath + dir_len + 1;
     }
     
-    // Search for the partial
-    for (size_t i = 0; i < partials->count; i++) {
-        if (strcmp(partials->names[i], name) == 0) {
-            return partials->contents[i];
+    snprintf(name, XO_MAX_PATH, "%s", relative);
+    
+    char *dot = strrchr(name, '.');
+    if (dot) {
+        *dot = '\0';
+    }
+    for (char *c = name; *c; c++) {
+        if (*c == '\\') {
+            *c = '/';
         }
     }
+}
+
+// Load or reload a single partial file
+int xo_template_partials_load_file(xo_template_partials_t *partials, const char *dir_path, const char *filepath) {
+    if (!partials || !dir_path || !filepath) {
+        return XO_ERROR_MEMORY_ALLOCATION;
+    }
     
-    return NULL;
+    char name[XO_MAX_PATH];
+    partial_file_name(dir_path, filepath, name);
+    
+    char *content = xo_utils_read_file(filepath);
+    if (!content) {
+        return XO_ERROR_FILE_NOT_FOUND;
+    }
+    
+    int result = partials_add(partials, name, content, filepath);
+    
+    free(content);
+    
+    return result;
 }
 
-// Simple template rendering implementation with variable substitution and partials
-int xo_template_render(const char *template_str, const xo_template_context_t *ctx, 
-                      const xo_template_partials_t *partials, char **output) {
-    if (!template_str || !ctx || !output) {
+// Remove the partial loaded from a deleted file, pages including it render nothing in its place
+int xo_template_partials_remove_file(xo_template_partials_t *partials, const char *dir_path, const char *filepath) {
+    if (!partials || !dir_path || !filepath) {
         return XO_ERROR_MEMORY_ALLOCATION;
     }
     
-    size_t template_len = strlen(template_str);
+    char name[XO_MAX_PATH];
+    partial_file_name(dir_path, filepath, name);
+    
+    // A partial of the same name loaded from another file stays
+    long i = partials_find(partials, name, strlen(name));
+    if (i < 0 || !partials->paths[i] || strcmp(partials->paths[i], filepath) != 0) {
+        return XO_ERROR_FILE_NOT_FOUND;
+    }
     
-    // Initial allocation - we'll resize as needed
-    size_t buffer_size = template_len * 2; // Start with double the template size
-    char *result = (char *)malloc(buffer_size);
-    if (!result) {
+    return partials_remove(partials, (size_t)i);
+}
+
+// Directory traversal state for loading partials
+typedef struct {
+    xo_template_partials_t *partials;
+    const char *dir_path;
+} xo_partials_loader_t;
+
+// Directory traversal callback, loads markdown and HTML partials
+static int load_partial_callback(const char *filepath, void *user_data) {
+    xo_partials_loader_t *loader = (xo_partials_loader_t *)user_data;
+    
+    char *ext = xo_utils_get_extension(filepath);
+    bool is_partial = ext && (strcmp(ext, "md") == 0 || strcmp(ext, "html") == 0);
+    free(ext);
+    
+    if (!is_partial) {
+        return XO_SUCCESS;
+    }
+    
+    // A broken partial doesn't keep the others from loading
+    if (xo_template_partials_load_file(loader->partials, loader->dir_path, filepath) == XO_ERROR_INVALID_FORMAT) {
+        xo_utils_console_warning("Skipping partial with unbalanced sections: %s", filepath);
+    }
+    
+    return XO_SUCCESS;
+}
+
+// Load every partial in a directory tree
+int xo_template_partials_load_dir(xo_template_partials_t *partials, const char *dir_path) {
+    if (!partials || !dir_path) {
         return XO_ERROR_MEMORY_ALLOCATION;
     }
     
-    size_t result_len = 0;
-    result[0] = '\0';
+    if (!xo_utils_dir_exists(dir_path)) {
+        return XO_ERROR_FILE_NOT_FOUND;
+    }
+    
+    xo_partials_loader_t loader = { partials, dir_path };
+    
+    return xo_utils_traverse_directory(dir_path, load_partial_callback, &loader);
+}
+
+// Find a partial's content by name
+const char *xo_template_partials_get(const xo_template_partials_t *partials, const char *name, size_t name_len) {
+    if (!partials || !name) {
+        return NULL;
+    }
+    
+    long i = partials_find(partials, name, name_len);
+    
+    return i >= 0 ? partials->templates[i]->source : NULL;
+}
+
+// Find the file a partial was loaded from
+const char *xo_template_partials_get_path(const xo_template_partials_t *partials, const char *name, size_t name_len) {
+    if (!partials || !name) {
+        return NULL;
+    }
+    
+    long i = partials_find(partials, name, name_len);
+    
+    return i >= 0 ? partials->paths[i] : NULL;
+}
+
+// Find a partial's compiled template by name
+const xo_template_t *xo_template_partials_get_template(const xo_template_partials_t *partials, const char *name,
+                                                       size_t name_len) {
+    if (!partials || !name) {
+        return NULL;
+    }
+    
+    long i = partials_find(partials, name, name_len);
+    
+    return i >= 0 ? partials->templates[i] : NULL;
+}
+
+// Write a context value. Numbers and booleans are formatted straight into
+// the output and never need escaping, so rendering shares no state between
+// threads. Lists and maps only render through sections.
+static void write_value(xo_writer_t *out, const xo_template_value_t *value, bool escaped) {
+    switch (value->type) {
+        case XO_TPLVAL_STRING:
+            if (escaped) {
+                xo_writer_append_escaped(out, value->value.string_val, strlen(value->value.string_val), true);
+            } else {
+                xo_writer_append_str(out, value->value.string_val);
+            }
+            break;
+        
+        case XO_TPLVAL_INT:
+            xo_writer_append_int(out, value->value.int_val);
+            break;
+        
+        case XO_TPLVAL_BOOL:
+            if (value->value.bool_val) {
+                xo_writer_append(out, "true", 4);
+            } else {
+                xo_writer_append(out, "false", 5);
+            }
+            break;
+        
+        default:
+            break;
+    }
+}
+
+// Find the }} or }}} closing a tag in [p, end)
+static const char *find_tag_end(const char *p, const char *end, size_t braces) {
+    while ((p = xo_scan_byte(p, end, '}')) < end) {
+        if ((size_t)(end - p) >= braces && memcmp(p, "}}}", braces) == 0) {
+            return p;
+        }
+        p++;
+    }
+    
+    return NULL;
+}
+
+// Append an op to a template being compiled
+static int add_op(xo_template_t *tpl, size_t *capacity, xo_template_op_type_t type, size_t offset, size_t length) {
+    if (tpl->op_count >= *capacity) {
+        size_t new_capacity = *capacity == 0 ? 8 : *capacity * 2;
+        xo_template_op_t *new_ops = realloc(tpl->ops, new_capacity * sizeof(xo_template_op_t));
+        if (!new_ops) {
+            return XO_ERROR_MEMORY_ALLOCATION;
+        }
+        
+        tpl->ops = new_ops;
+        *capacity = new_capacity;
+    }
+    
+    xo_template_op_t *op = &tpl->ops[tpl->op_count++];
+    op->type = type;
+    op->offset = offset;
+    op->length = length;
+    op->var = 0;
+    op->jump = 0;
     
-    // Process the template
-    const char *p = template_str;
-    while (*p) {
-        // Check for variable or partial tag
-        if (*p == '{' && *(p + 1) == '{') {
-            // Found the start of a tag
-            const char *tag_start = p + 2;
-            bool is_triple = false;
+    return XO_SUCCESS;
+}
+
+// Find or add the name of an op in a list of distinct names, every use of a
+// name shares one entry. Returns the entry's index in index.
+static int add_name(const xo_template_t *tpl, xo_template_var_t **names, size_t *count, size_t *capacity,
+                    const xo_template_op_t *op, size_t *index) {
+    const char *name = tpl->source + op->offset;
+    uint64_t hash = xo_utils_hash64(name, op->length, 0);
+    
+    for (size_t i = 0; i < *count; i++) {
+        const xo_template_var_t *var = &(*names)[i];
+        if (var->hash == hash && var->length == op->length && memcmp(tpl->source + var->offset, name, op->length) == 0) {
+            *index = i;
+            return XO_SUCCESS;
+        }
+    }
+    
+    if (*count >= *capacity) {
+        size_t new_capacity = *capacity == 0 ? 8 : *capacity * 2;
+        xo_template_var_t *new_names = realloc(*names, new_capacity * sizeof(xo_template_var_t));
+        if (!new_names) {
+            return XO_ERROR_MEMORY_ALLOCATION;
+        }
+        
+        *names = new_names;
+        *capacity = new_capacity;
+    }
+    
+    xo_template_var_t *var = &(*names)[*count];
+    var->offset = op->offset;
+    var->length = op->length;
+    var->hash = hash;
+    *index = (*count)++;
+    
+    return XO_SUCCESS;
+}
+
+// Free the ops, variables and partials of a template that failed to compile
+static int compile_failed(xo_template_t *tpl, int result) {
+    free(tpl->ops);
+    free(tpl->vars);
+    free(tpl->partials);
+    tpl->ops = NULL;
+    tpl->op_count = 0;
+    tpl->vars = NULL;
+    tpl->var_count = 0;
+    tpl->partials = NULL;
+    tpl->partial_count = 0;
+    
+    return result;
+}
+
+// Split a template's source into ops. Text between tags becomes one literal
+// op, braces that don't open a complete tag stay part of the literal. Every
+// distinct variable name gets a variable, hashed here once. Sections are
+// matched with their ends here, so rendering jumps over a skipped section
+// without looking for its end. A section without an end, an end closing
+// another section or sections nested too deep are an error.
+static int compile_ops(xo_template_t *tpl) {
+    const char *source = tpl->source;
+    const char *end = source + tpl->length;
+    const char *literal = source;
+    const char *p = source;
+    size_t capacity = 0;
+    size_t var_capacity = 0;
+    size_t partial_capacity = 0;
+    size_t open = SIZE_MAX;  // Innermost open section, each open section's jump holds the one around it
+    size_t open_count = 0;
+    
+    tpl->ops = NULL;
+    tpl->op_count = 0;
+    tpl->vars = NULL;
+    tpl->var_count = 0;
+    tpl->partials = NULL;
+    tpl->partial_count = 0;
+    
+    while ((p = xo_scan_byte(p, end, '{')) < end) {
+        if (end - p < 2 || p[1] != '{') {
+            p++;
+            continue;
+        }
+        
+        // Found the start of a tag, {{{ and {{& are written unescaped
+        const char *tag_start = p + 2;
+        bool is_triple = tag_start < end && *tag_start == '{';
+        bool is_unescaped = is_triple || (tag_start < end && *tag_start == '&');
+        if (is_unescaped) {
+            tag_start++;
+        }
+        
+        // Check if it's a partial or a section tag
+        char sigil = tag_start < end && !is_unescaped && strchr("#^/", *tag_start) ? *tag_start : 0;
+        bool is_partial = tag_start < end && !sigil && *tag_start == '>';
+        if (is_partial || sigil) {
+            tag_start++;
+        }
+        
+        // Look for the end of the tag, }}} for triple braces and }} otherwise
+        const char *tag_end = find_tag_end(tag_start, end, is_triple ? 3 : 2);
+        if (!tag_end) {
+            p++;
+            continue;
+        }
+        
+        // Trim whitespace around the tag name
+        const char *name = tag_start;
+        const char *name_end = tag_end;
+        while (name < name_end && isspace((unsigned char)*name)) {
+            name++;
+        }
+        while (name_end > name && isspace((unsigned char)*(name_end - 1))) {
+            name_end--;
+        }
+        
+        // A section, end, comment or partial tag alone on its line takes the
+        // line with it, its indentation and newline are not written
+        bool is_comment = name < name_end && *name == '!';
+        const char *after = tag_end + (is_triple ? 3 : 2);
+        const char *literal_end = p;
+        if (sigil || is_partial || is_comment) {
+            const char *line_start = p;
+            while (line_start > literal && (line_start[-1] == ' ' || line_start[-1] == '\t')) {
+                line_start--;
+            }
+            const char *line_end = after;
+            while (line_end < end && (*line_end == ' ' || *line_end == '\t')) {
+                line_end++;
+            }
+            if (line_end < end && *line_end == '\r' && line_end + 1 < end && line_end[1] == '\n') {
+                line_end++;
+            }
             
-            // Check if it's a triple brace tag {{{ for unescaped HTML
-            if (*tag_start == '{') {
-                is_triple = true;
-                tag_start++;
+            if ((line_start == source || line_start[-1] == '\n') && (line_end == end || *line_end == '\n')) {
+                literal_end = line_start;
+                after = line_end < end ? line_end + 1 : end;
             }
+        }
+        
+        int result = XO_SUCCESS;
+        if (literal_end > literal) {
+            result = add_op(tpl, &capacity, XO_TPLOP_LITERAL, (size_t)(literal - source),
+                            (size_t)(literal_end - literal));
+        }
+        
+        // Comments compile to nothing
+        if (result == XO_SUCCESS && !is_comment) {
+            xo_template_op_type_t type = sigil == '#' ? XO_TPLOP_SECTION :
+                                         sigil == '^' ? XO_TPLOP_INVERTED :
+                                         sigil == '/' ? XO_TPLOP_END :
+                                         is_partial ? XO_TPLOP_PARTIAL :
+                                         is_unescaped ? XO_TPLOP_UNESCAPED : XO_TPLOP_VAR;
+            result = add_op(tpl, &capacity, type, (size_t)(name - source), (size_t)(name_end - name));
+            
+            size_t index = tpl->op_count - 1;
+            xo_template_op_t *op = &tpl->ops[index];
+            if (result == XO_SUCCESS && type == XO_TPLOP_PARTIAL) {
+                result = add_name(tpl, &tpl->partials, &tpl->partial_count, &partial_capacity, op, &op->var);
+            } else if (result == XO_SUCCESS && type != XO_TPLOP_END) {
+                result = add_name(tpl, &tpl->vars, &tpl->var_count, &var_capacity, op, &op->var);
+            }
+            
+            if (result == XO_SUCCESS && (type == XO_TPLOP_SECTION || type == XO_TPLOP_INVERTED)) {
+                if (++open_count > XO_TEMPLATE_MAX_SECTION_DEPTH) {
+                    return compile_failed(tpl, XO_ERROR_INVALID_FORMAT);
+                }
+                tpl->ops[index].jump = open;
+                open = index;
+            } else if (result == XO_SUCCESS && type == XO_TPLOP_END) {
+                xo_template_op_t *section = open != SIZE_MAX ? &tpl->ops[open] : NULL;
+                if (!section || section->length != tpl->ops[index].length ||
+                    memcmp(source + section->offset, name, section->length) != 0) {
+                    return compile_failed(tpl, XO_ERROR_INVALID_FORMAT);
+                }
+                
+                tpl->ops[index].jump = open;
+                open = section->jump;
+                open_count--;
+                section->jump = index + 1;
+            }
+        }
+        
+        if (result != XO_SUCCESS) {
+            return compile_failed(tpl, result);
+        }
+        
+        // Move past the end of the tag
+        p = after;
+        literal = p;
+    }
+    
+    if (end > literal &&
+        add_op(tpl, &capacity, XO_TPLOP_LITERAL, (size_t)(literal - source), (size_t)(end - literal)) != XO_SUCCESS) {
+        return compile_failed(tpl, XO_ERROR_MEMORY_ALLOCATION);
+    }
+    
+    if (open != SIZE_MAX) {
+        return compile_failed(tpl, XO_ERROR_INVALID_FORMAT);
+    }
+    
+    return XO_SUCCESS;
+}
+
+// Item of a list or map section being rendered, linked to the items of the
+// sections around it. Partials rendered inside the section see it too.
+typedef struct xo_template_scope {
+    const xo_template_value_t *item;
+    const struct xo_template_scope *parent;
+} xo_template_scope_t;
+
+// Section being rendered by render_ops
+typedef struct {
+    xo_template_scope_t scope;
+    size_t section;                    // Op index of the section
+    const xo_template_value_t *items;  // Items the section renders for, NULL when it renders once as is
+    size_t count;
+    size_t position;
+} xo_template_frame_t;
+
+static int render_partial(const xo_template_t *tpl, const xo_template_binding_t *binding,
+                          const xo_template_context_t *ctx, const xo_template_scope_t *scope,
+                          const xo_template_partials_t *partials, int depth, xo_writer_t *out);
+
+// Whether a value counts as set for sections: true, non-zero, non-empty or a map
+static bool value_is_set(const xo_template_value_t *value) {
+    switch (value->type) {
+        case XO_TPLVAL_STRING:
+            return value->value.string_val[0] != '\0';
+        case XO_TPLVAL_INT:
+            return value->value.int_val != 0;
+        case XO_TPLVAL_BOOL:
+            return value->value.bool_val;
+        case XO_TPLVAL_LIST:
+            return value->value.list_val->count > 0;
+        case XO_TPLVAL_MAP:
+            return true;
+        default:
+            return false;
+    }
+}
+
+// Find the value of an op's variable. The maps of the sections being rendered
+// come first, innermost first, then the context through the bound slot.
+// {{.}} is the item of the innermost list section.
+static const xo_template_value_t *lookup_value(const xo_template_t *tpl, const xo_template_op_t *op, const size_t *slots,
+                                              const xo_template_context_t *ctx, const xo_template_scope_t *scope) {
+    if (scope) {
+        const xo_template_var_t *var = &tpl->vars[op->var];
+        const char *name = tpl->source + var->offset;
+        if (var->length == 1 && name[0] == '.') {
+            return scope->item;
+        }
+        
+        for (; scope; scope = scope->parent) {
+            if (scope->item->type == XO_TPLVAL_MAP) {
+                const xo_template_context_t *map = scope->item->value.map_val;
+                long entry = context_find(map, name, var->length, var->hash);
+                if (entry >= 0) {
+                    return &map->values[entry];
+                }
+            }
+        }
+    }
+    
+    size_t slot = slots[op->var];
+    
+    return slot ? &ctx->values[slot - 1] : NULL;
+}
+
+// Context entry of each variable of a template, + 1 and 0 when missing
+static void resolve_slots(const xo_template_t *tpl, const xo_template_context_t *ctx, size_t *slots) {
+    for (size_t i = 0; i < tpl->var_count; i++) {
+        const xo_template_var_t *var = &tpl->vars[i];
+        slots[i] = (size_t)(context_find(ctx, tpl->source + var->offset, var->length, var->hash) + 1);
+    }
+}
+
+// Render a compiled template into out, depth counts the partials it is nested
+// in. Variables are looked up in scope, the sections around a partial, and in
+// slots, which the template is bound to. Partials take their slots from
+// binding when it has them. A list section renders once per item: its end
+// jumps back to the op after the section until the items run out.
+static int render_ops(const xo_template_t *tpl, const size_t *slots, const xo_template_binding_t *binding,
+                      const xo_template_context_t *ctx, const xo_template_scope_t *scope,
+                      const xo_template_partials_t *partials, int depth, xo_writer_t *out) {
+    xo_template_frame_t frames[XO_TEMPLATE_MAX_SECTION_DEPTH];
+    size_t frame_count = 0;
+    
+    size_t i = 0;
+    while (i < tpl->op_count) {
+        const xo_template_op_t *op = &tpl->ops[i];
+        const char *text = tpl->source + op->offset;
+        size_t next = i + 1;
+        
+        switch (op->type) {
+            case XO_TPLOP_LITERAL:
+                xo_writer_append(out, text, op->length);
+                break;
             
-            // Check if it's a partial
-            bool is_partial = false;
-            if (*tag_start == '>') {
-                is_partial = true;
-                tag_start++;
-                // Skip whitespace
-                while (isspace((unsigned char)*tag_start)) {
-                    tag_start++;
+            case XO_TPLOP_VAR:
+            case XO_TPLOP_UNESCAPED: {
+                const xo_template_value_t *value = lookup_value(tpl, op, slots, ctx, scope);
+                if (value) {
+                    write_value(out, value, op->type == XO_TPLOP_VAR);
                 }
+                break;
             }
             
-            // Look for the end of the tag
-            const char *tag_end;
-            if (is_triple) {
-                // For triple braces, look for }}}
-                tag_end = strstr(tag_start, "}}}");
-            } else {
-                // For double braces, look for }}
-                tag_end = strstr(tag_start, "}}");
+            case XO_TPLOP_PARTIAL: {
+                // Partials are templates themselves, rendered with the same context
+                long partial = partials ? partials_find(partials, text, op->length) : -1;
+                if (partial >= 0 && depth < XO_TEMPLATE_MAX_PARTIAL_DEPTH) {
+                    render_partial(partials->templates[partial], binding, ctx, scope, partials, depth + 1, out);
+                } else if (partial >= 0) {
+                    // A partial including itself renders nothing past the limit
+                    xo_utils_console_warning("Partial %.*s nested deeper than %d levels, skipping it",
+                                             (int)op->length, text, XO_TEMPLATE_MAX_PARTIAL_DEPTH);
+                }
+                break;
             }
             
-            if (tag_end) {
-                // Extract the tag name
-                size_t tag_len = tag_end - tag_start;
-                char *tag_name = (char *)malloc(tag_len + 1);
-                if (!tag_name) {
-                    free(result);
-                    return XO_ERROR_MEMORY_ALLOCATION;
+            case XO_TPLOP_SECTION:
+            case XO_TPLOP_INVERTED: {
+                // A section that doesn't render continues after its end
+                const xo_template_value_t *value = lookup_value(tpl, op, slots, ctx, scope);
+                bool set = value && value_is_set(value);
+                if (set != (op->type == XO_TPLOP_SECTION)) {
+                    next = op->jump;
+                    break;
                 }
-                
-                strncpy(tag_name, tag_start, tag_len);
-                tag_name[tag_len] = '\0';
-                
-                // Trim whitespace
-                char *tag_ptr = tag_name;
-                while (isspace((unsigned char)*tag_ptr)) {
-                    tag_ptr++;
+                if (op->type == XO_TPLOP_INVERTED) {
+                    break;
                 }
                 
-                char *tag_end_ptr = tag_name + strlen(tag_ptr) - 1;
-                while (tag_end_ptr > tag_ptr && isspace((unsigned char)*tag_end_ptr)) {
-                    *tag_end_ptr = '\0';
-                    tag_end_ptr--;
+                // Compiling limits the nesting, so the frames can't run out
+                xo_template_frame_t *frame = &frames[frame_count++];
+                frame->section = i;
+                frame->position = 0;
+                frame->count = 1;
+                frame->items = NULL;
+                if (value->type == XO_TPLVAL_LIST) {
+                    frame->items = value->value.list_val->items;
+                    frame->count = value->value.list_val->count;
+                } else if (value->type == XO_TPLVAL_MAP) {
+                    frame->items = value;
                 }
                 
-                // Get the value or partial
-                const char *value = NULL;
-                if (is_partial) {
-                    value = get_partial(partials, tag_ptr);
-                } else {
-                    value = get_context_value(ctx, tag_ptr);
+                if (frame->items) {
+                    frame->scope.item = &frame->items[0];
+                    frame->scope.parent = scope;
+                    scope = &frame->scope;
                 }
-                
-                if (value) {
-                    // Check if we need to resize the result buffer
-                    size_t value_len = strlen(value);
-                    if (result_len + value_len >= buffer_size) {
-                        buffer_size = (result_len + value_len) * 2;
-                        char *new_result = (char *)realloc(result, buffer_size);
-                        if (!new_result) {
-                            free(tag_name);
-                            free(result);
-                            return XO_ERROR_MEMORY_ALLOCATION;
-                        }
-                        result = new_result;
-                    }
-                    
-                    // Append the value
-                    strcat(result, value);
-                    result_len += value_len;
+                break;
+            }
+            
+            case XO_TPLOP_END: {
+                // Ends of inverted sections have no frame
+                if (frame_count == 0 || frames[frame_count - 1].section != op->jump) {
+                    break;
                 }
                 
-                free(tag_name);
-                
-                // Move past the end of the tag
-                if (is_triple) {
-                    p = tag_end + 3; // Skip past }}}
+                xo_template_frame_t *frame = &frames[frame_count - 1];
+                if (++frame->position < frame->count) {
+                    frame->scope.item = &frame->items[frame->position];
+                    next = op->jump + 1;
                 } else {
-                    p = tag_end + 2; // Skip past }}
-                }
-            } else {
-                // No end tag found, just output the character
-                if (result_len + 1 >= buffer_size) {
-                    buffer_size *= 2;
-                    char *new_result = (char *)realloc(result, buffer_size);
-                    if (!new_result) {
-                        free(result);
-                        return XO_ERROR_MEMORY_ALLOCATION;
+                    if (frame->items) {
+                        scope = frame->scope.parent;
                     }
-                    result = new_result;
+                    frame_count--;
                 }
-                
-                result[result_len++] = *p;
-                result[result_len] = '\0';
-                p++;
+                break;
             }
-        } else {
-            // Regular character, just copy it
-            if (result_len + 1 >= buffer_size) {
-                buffer_size *= 2;
-                char *new_result = (char *)realloc(result, buffer_size);
-                if (!new_result) {
-                    free(result);
-                    return XO_ERROR_MEMORY_ALLOCATION;
-                }
-                result = new_result;
-            }
-            
-            result[result_len++] = *p;
-            result[result_len] = '\0';
-            p++;
         }
+        
+        i = next;
     }
     
-    *output = result;
-    return XO_SUCCESS;
+    return out->failed ? XO_ERROR_MEMORY_ALLOCATION : XO_SUCCESS;
+}
+
+// Slots of a partial bound along with the template including it, NULL when
+// the binding doesn't have them
+static const size_t *binding_partial_slots(const xo_template_binding_t *binding, const xo_template_t *tpl) {
+    if (!binding) {
+        return NULL;
+    }
+    
+    for (size_t i = 0; i < binding->partial_count; i++) {
+        if (binding->partials[i] == tpl) {
+            return binding->partial_slots[i];
+        }
+    }
+    
+    return NULL;
+}
+
+// Render a partial with the context and sections of the template including it,
+// through its bound slots or binding its variables first. Partials have few
+// variables, their slots live on the stack.
+static int render_partial(const xo_template_t *tpl, const xo_template_binding_t *binding,
+                          const xo_template_context_t *ctx, const xo_template_scope_t *scope,
+                          const xo_template_partials_t *partials, int depth, xo_writer_t *out) {
+    const size_t *bound = binding_partial_slots(binding, tpl);
+    if (bound) {
+        return render_ops(tpl, bound, binding, ctx, scope, partials, depth, out);
+    }
+    
+    size_t stack_slots[32] = { 0 };
+    size_t *slots = tpl->var_count <= 32 ? stack_slots : malloc(tpl->var_count * sizeof(size_t));
+    if (!slots) {
+        return XO_ERROR_MEMORY_ALLOCATION;
+    }
+    
+    resolve_slots(tpl, ctx, slots);
+    int result = render_ops(tpl, slots, binding, ctx, scope, partials, depth, out);
+    
+    if (slots != stack_slots) {
+        free(slots);
+    }
+    
+    return result;
+}
+
+// Render compiled ops into a new string, allocated from the context's arena when it has one.
+// {{name}} is escaped for HTML, {{{name}}} and {{& name}} are written as is.
+static int render_to_string(const xo_template_t *tpl, const xo_template_binding_t *binding,
+                            const xo_template_context_t *ctx, const xo_template_partials_t *partials, char **output) {
+    // Start with double the template size, the writer grows as needed
+    xo_writer_t out;
+    if (xo_writer_init(&out, ctx->arena, tpl->length * 2) != XO_SUCCESS) {
+        return XO_ERROR_MEMORY_ALLOCATION;
+    }
+    
+    int result = binding ? render_ops(tpl, binding->slots, binding, ctx, NULL, partials, 0, &out) :
+                           render_partial(tpl, NULL, ctx, NULL, partials, 0, &out);
+    if (result != XO_SUCCESS) {
+        xo_writer_free(&out);
+        return XO_ERROR_MEMORY_ALLOCATION;
+    }
+    
+    *output = xo_writer_finish(&out, NULL);
+    
+    return *output ? XO_SUCCESS : XO_ERROR_MEMORY_ALLOCATION;
+}
+
+// Simple template rendering implementation with variable substitution and partials.
+// The template is compiled for this render only, templates rendered more than
+// once are compiled with xo_template_compile instead.
+int xo_template_render(const char *template_str, const xo_template_context_t *ctx, 
+                      const xo_template_partials_t *partials, char **output) {
+    if (!template_str || !ctx || !output) {
+        return XO_ERROR_MEMORY_ALLOCATION;
+    }
+    
+    // The ops point into the caller's string, which outlives the render
+    xo_template_t tpl;
+    tpl.source = (char *)template_str;
+    tpl.length = strlen(template_str);
+    int result = compile_ops(&tpl);
+    if (result != XO_SUCCESS) {
+        return result;
+    }
+    
+    result = render_to_string(&tpl, NULL, ctx, partials, output);
+    
+    free(tpl.ops);
+    free(tpl.vars);
+    free(tpl.partials);
+    
+    return result;
 }
 
 // Render a template file
@@ -481,11 +1357,16 @@ int xo_template_render_file(const char *template_path, const xo_template_context
     
     // Determine file size
     fseek(file, 0, SEEK_END);
-    long file_size = ftell(file);
+    long end = ftell(file);
     rewind(file);
+    if (end < 0) {
+        fclose(file);
+        return XO_ERROR_FILE_NOT_FOUND;
+    }
+    size_t file_size = (size_t)end;
     
     // Allocate buffer for template content
-    char *template_str = malloc(file_size + 1);
+    char *template_str = ctx->arena ? xo_arena_alloc(ctx->arena, file_size + 1) : malloc(file_size + 1);
     if (!template_str) {
         fclose(file);
         return XO_ERROR_MEMORY_ALLOCATION;
@@ -499,14 +1380,238 @@ int xo_template_render_file(const char *template_path, const xo_template_context
     
     // Check if we read the whole file
     if (read_size != file_size) {
-        free(template_str);
+        if (!ctx->arena) {
+            free(template_str);
+        }
         return XO_ERROR_FILE_NOT_FOUND;
     }
     
     // Render the template
     int result = xo_template_render(template_str, ctx, partials, output);
     
-    free(template_str);
+    if (!ctx->arena) {
+        free(template_str);
+    }
+    
+    return result;
+}
+
+// Compile a template from its source into ops
+int xo_template_compile(const char *source, size_t length, xo_template_t *tpl) {
+    if (!source || !tpl) {
+        return XO_ERROR_MEMORY_ALLOCATION;
+    }
+    
+    tpl->source = xo_utils_strndup(source, length);
+    if (!tpl->source) {
+        return XO_ERROR_MEMORY_ALLOCATION;
+    }
+    
+    tpl->length = strlen(tpl->source);
+    tpl->hash = xo_utils_hash64(tpl->source, tpl->length, 0);
+    
+    int result = compile_ops(tpl);
+    if (result != XO_SUCCESS) {
+        free(tpl->source);
+        tpl->source = NULL;
+        return result;
+    }
+    
+    return XO_SUCCESS;
+}
+
+// Compile a template file
+int xo_template_compile_file(const char *template_path, xo_template_t *tpl) {
+    if (!template_path || !tpl) {
+        return XO_ERROR_MEMORY_ALLOCATION;
+    }
+    
+    char *source = xo_utils_read_file(template_path);
+    if (!source) {
+        return XO_ERROR_FILE_NOT_FOUND;
+    }
+    
+    int result = xo_template_compile(source, strlen(source), tpl);
+    
+    free(source);
     
     return result;
-} 
\ No newline at end of file
+}
+
+// Free a compiled template
+void xo_template_free(xo_template_t *tpl) {
+    if (!tpl) {
+        return;
+    }
+    
+    free(tpl->source);
+    free(tpl->ops);
+    free(tpl->vars);
+    free(tpl->partials);
+    
+    tpl->source = NULL;
+    tpl->length = 0;
+    tpl->hash = 0;
+    tpl->ops = NULL;
+    tpl->op_count = 0;
+    tpl->vars = NULL;
+    tpl->var_count = 0;
+    tpl->partials = NULL;
+    tpl->partial_count = 0;
+}
+
+// Whether a template names a variable in a tag or section
+bool xo_template_uses_var(const xo_template_t *tpl, const char *name) {
+    if (!tpl || !name) {
+        return false;
+    }
+    
+    size_t length = strlen(name);
+    uint64_t hash = xo_utils_hash64(name, length, 0);
+    for (size_t i = 0; i < tpl->var_count; i++) {
+        const xo_template_var_t *var = &tpl->vars[i];
+        if (var->hash == hash && var->length == length && memcmp(tpl->source + var->offset, name, length) == 0) {
+            return true;
+        }
+    }
+    
+    return false;
+}
+
+// Render a compiled template
+int xo_template_render_compiled(const xo_template_t *tpl, const xo_template_context_t *ctx,
+                                const xo_template_partials_t *partials, char **output) {
+    if (!tpl || !tpl->source || !ctx || !output) {
+        return XO_ERROR_MEMORY_ALLOCATION;
+    }
+    
+    return render_to_string(tpl, NULL, ctx, partials, output);
+}
+
+// Add the partials a template includes to a binding's list, and the partials
+// those include, each partial once
+static int collect_partials(const xo_template_t *tpl, const xo_template_partials_t *partials, int depth,
+                            const xo_template_t ***list, size_t *count, size_t *capacity) {
+    if (depth >= XO_TEMPLATE_MAX_PARTIAL_DEPTH) {
+        return XO_SUCCESS;
+    }
+    
+    for (size_t i = 0; i < tpl->partial_count; i++) {
+        long partial = partials_find(partials, tpl->source + tpl->partials[i].offset, tpl->partials[i].length);
+        if (partial < 0) {
+            continue;
+        }
+        
+        const xo_template_t *found = partials->templates[partial];
+        bool seen = false;
+        for (size_t j = 0; j < *count && !seen; j++) {
+            seen = (*list)[j] == found;
+        }
+        if (seen) {
+            continue;
+        }
+        
+        if (*count >= *capacity) {
+            size_t new_capacity = *capacity == 0 ? 8 : *capacity * 2;
+            const xo_template_t **new_list = realloc(*list, new_capacity * sizeof(xo_template_t *));
+            if (!new_list) {
+                return XO_ERROR_MEMORY_ALLOCATION;
+            }
+            *list = new_list;
+            *capacity = new_capacity;
+        }
+        (*list)[(*count)++] = found;
+        
+        int result = collect_partials(found, partials, depth + 1, list, count, capacity);
+        if (result != XO_SUCCESS) {
+            return result;
+        }
+    }
+    
+    return XO_SUCCESS;
+}
+
+// Bind a template's variables, and those of the partials it includes, to the
+// entries of a context. The binding can render the template with any context
+// of the same shape while the partials stay loaded; a partial reloaded since
+// binds its variables when it renders. The slots are not taken from the
+// context's arena, a binding outlives the context it was made with.
+int xo_template_bind(const xo_template_t *tpl, const xo_template_context_t *ctx,
+                     const xo_template_partials_t *partials, xo_template_binding_t *binding) {
+    if (!tpl || !ctx || !binding) {
+        return XO_ERROR_MEMORY_ALLOCATION;
+    }
+    
+    const xo_template_t **found = NULL;
+    size_t found_count = 0;
+    size_t found_capacity = 0;
+    if (partials && collect_partials(tpl, partials, 0, &found, &found_count, &found_capacity) != XO_SUCCESS) {
+        free(found);
+        return XO_ERROR_MEMORY_ALLOCATION;
+    }
+    
+    // The partial lists and every slot share one block
+    size_t slot_count = tpl->var_count;
+    for (size_t i = 0; i < found_count; i++) {
+        slot_count += found[i]->var_count;
+    }
+    size_t size = found_count * (sizeof(xo_template_t *) + sizeof(size_t *)) +
+                  (slot_count > 0 ? slot_count : 1) * sizeof(size_t);
+    void *block = malloc(size);
+    if (!block) {
+        free(found);
+        return XO_ERROR_MEMORY_ALLOCATION;
+    }
+    
+    binding->partials = (const xo_template_t **)block;
+    binding->partial_slots = (size_t **)(binding->partials + found_count);
+    binding->slots = (size_t *)(binding->partial_slots + found_count);
+    binding->partial_count = found_count;
+    binding->count = tpl->var_count;
+    binding->shape = ctx->shape;
+    
+    resolve_slots(tpl, ctx, binding->slots);
+    
+    size_t *next = binding->slots + tpl->var_count;
+    for (size_t i = 0; i < found_count; i++) {
+        binding->partials[i] = found[i];
+        binding->partial_slots[i] = next;
+        resolve_slots(found[i], ctx, next);
+        next += found[i]->var_count;
+    }
+    
+    free(found);
+    
+    return XO_SUCCESS;
+}
+
+// Free a binding's slots
+void xo_template_binding_free(xo_template_binding_t *binding) {
+    if (!binding) {
+        return;
+    }
+    
+    free(binding->partials);
+    
+    binding->partials = NULL;
+    binding->partial_slots = NULL;
+    binding->partial_count = 0;
+    binding->slots = NULL;
+    binding->count = 0;
+}
+
+// Render a template through a binding made for a context of the same shape
+int xo_template_render_bound(const xo_template_t *tpl, const xo_template_binding_t *binding,
+                             const xo_template_context_t *ctx, const xo_template_partials_t *partials,
+                             char **output) {
+    if (!tpl || !tpl->source || !binding || !ctx || !output) {
+        return XO_ERROR_MEMORY_ALLOCATION;
+    }
+    
+    // A binding for another shape would read the wrong entries
+    if (binding->count != tpl->var_count || binding->shape != ctx->shape) {
+        return XO_ERROR_INVALID_FORMAT;
+    }
+    
+    return render_to_string(tpl, binding, ctx, partials, output);
+}
@@ -2,8 +2,10 @@
 #include <stdlib.h>
 #include <string.h>
 #include <stdarg.h>
+#include <ctype.h>
 #include <sys/stat.h>
 #include <errno.h>
+#include <time.h>
 #include "utils.h"
 
 #ifdef _WIN32
@@ -309,6 +311,12 @@ void xo_utils_str_trim(char *str) {
 // ===============================
 
 char *xo_utils_read_file(const char *path) {
+    return xo_utils_read_file_length(path, NULL);
+}
+
+// Read a whole file, NUL-terminated, storing the number of bytes read in
+// length when given. The file may contain NUL bytes of its own.
+char *xo_utils_read_file_length(const char *path, size_t *length) {
     if (!path) {
         return NULL;
     }
@@ -342,6 +350,10 @@ char *xo_utils_read_file(const char *path) {
         return NULL;
     }
     
+    if (length) {
+        *length = read_size;
+    }
+    
     return buffer;
 }
 
@@ -397,54 +409,219 @@ int xo_utils_copy_file(const char *src, const char *dest) {
     return result;
 }
 
+// ===============================
+// Hash utilities
+// ===============================
+
+// 64-bit non-cryptographic content hash following the XXH64 construction:
+// four independent lanes over 32-byte stripes, then a final avalanche
+#define XO_HASH_PRIME1 0x9E3779B185EBCA87ULL
+#define XO_HASH_PRIME2 0xC2B2AE3D27D4EB4FULL
+#define XO_HASH_PRIME3 0x165667B19E3779F9ULL
+#define XO_HASH_PRIME4 0x85EBCA77C2B2AE63ULL
+#define XO_HASH_PRIME5 0x27D4EB2F165667C5ULL
+
+static uint64_t hash_rotl(uint64_t x, int r) {
+    return (x << r) | (x >> (64 - r));
+}
+
+static uint64_t hash_read64(const unsigned char *p) {
+    uint64_t value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+static uint32_t hash_read32(const unsigned char *p) {
+    uint32_t value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+static uint64_t hash_round(uint64_t acc, uint64_t input) {
+    acc += input * XO_HASH_PRIME2;
+    acc = hash_rotl(acc, 31);
+    return acc * XO_HASH_PRIME1;
+}
+
+static uint64_t hash_merge(uint64_t acc, uint64_t lane) {
+    acc ^= hash_round(0, lane);
+    return acc * XO_HASH_PRIME1 + XO_HASH_PRIME4;
+}
+
+uint64_t xo_utils_hash64(const void *data, size_t length, uint64_t seed) {
+    const unsigned char *p = (const unsigned char *)data;
+    const unsigned char *end = p + length;
+    uint64_t hash;
+    
+    if (length >= 32) {
+        uint64_t v1 = seed + XO_HASH_PRIME1 + XO_HASH_PRIME2;
+        uint64_t v2 = seed + XO_HASH_PRIME2;
+        uint64_t v3 = seed;
+        uint64_t v4 = seed - XO_HASH_PRIME1;
+        const unsigned char *limit = end - 32;
+        
+        do {
+            v1 = hash_round(v1, hash_read64(p));
+            v2 = hash_round(v2, hash_read64(p + 8));
+            v3 = hash_round(v3, hash_read64(p + 16));
+            v4 = hash_round(v4, hash_read64(p + 24));
+            p += 32;
+        } while (p <= limit);
+        
+        hash = hash_rotl(v1, 1) + hash_rotl(v2, 7) + hash_rotl(v3, 12) + hash_rotl(v4, 18);
+        hash = hash_merge(hash, v1);
+        hash = hash_merge(hash, v2);
+        hash = hash_merge(hash, v3);
+        hash = hash_merge(hash, v4);
+    } else {
+        hash = seed + XO_HASH_PRIME5;
+    }
+    
+    hash += (uint64_t)length;
+    
+    // Consume the tail
+    while (p + 8 <= end) {
+        hash ^= hash_round(0, hash_read64(p));
+        hash = hash_rotl(hash, 27) * XO_HASH_PRIME1 + XO_HASH_PRIME4;
+        p += 8;
+    }
+    
+    if (p + 4 <= end) {
+        hash ^= (uint64_t)hash_read32(p) * XO_HASH_PRIME1;
+        hash = hash_rotl(hash, 23) * XO_HASH_PRIME2 + XO_HASH_PRIME3;
+        p += 4;
+    }
+    
+    while (p < end) {
+        hash ^= (*p) * XO_HASH_PRIME5;
+        hash = hash_rotl(hash, 11) * XO_HASH_PRIME1;
+        p++;
+    }
+    
+    // Final avalanche
+    hash ^= hash >> 33;
+    hash *= XO_HASH_PRIME2;
+    hash ^= hash >> 29;
+    hash *= XO_HASH_PRIME3;
+    hash ^= hash >> 32;
+    
+    return hash;
+}
+
+void xo_utils_hash_to_hex(uint64_t hash, char hex[XO_HASH_HEX_LEN + 1]) {
+    static const char digits[] = "0123456789abcdef";
+    
+    for (int i = XO_HASH_HEX_LEN - 1; i >= 0; i--) {
+        hex[i] = digits[hash & 0xF];
+        hash >>= 4;
+    }
+    hex[XO_HASH_HEX_LEN] = '\0';
+}
+
+char *xo_utils_hash_string(const char *str) {
+    if (!str) {
+        return NULL;
+    }
+    
+    char *hex = (char *)malloc(XO_HASH_HEX_LEN + 1);
+    if (!hex) {
+        return NULL;
+    }
+    
+    xo_utils_hash_to_hex(xo_utils_hash64(str, strlen(str), 0), hex);
+    return hex;
+}
+
+char *xo_utils_hash_file(const char *path) {
+    if (!path) {
+        return NULL;
+    }
+    
+    // Hash every byte read, a NUL in the file doesn't end its content
+    size_t length;
+    char *content = xo_utils_read_file_length(path, &length);
+    if (!content) {
+        return NULL;
+    }
+    
+    char *hex = (char *)malloc(XO_HASH_HEX_LEN + 1);
+    if (hex) {
+        xo_utils_hash_to_hex(xo_utils_hash64(content, length, 0), hex);
+    }
+    free(content);
+    
+    return hex;
+}
+
 // ===============================
 // Console utilities
 // ===============================
 
+// Print one console line with a single write so lines from
+// concurrent build workers do not interleave
+static void console_print(const char *color, const char *fmt, va_list args) {
+    char message[2048];
+    vsnprintf(message, sizeof(message), fmt, args);
+    printf("[xo] %s%s%s\n", color, message, ANSI_RESET);
+}
+
 void xo_utils_console_info(const char *fmt, ...) {
     va_list args;
     va_start(args, fmt);
-    
-    printf("[xo] %s", ANSI_CYAN);
-    vprintf(fmt, args);
-    printf("%s\n", ANSI_RESET);
-    
+    console_print(ANSI_CYAN, fmt, args);
     va_end(args);
 }
 
 void xo_utils_console_success(const char *fmt, ...) {
     va_list args;
     va_start(args, fmt);
-    
-    printf("[xo] %s", ANSI_GREEN);
-    vprintf(fmt, args);
-    printf("%s\n", ANSI_RESET);
-    
+    console_print(ANSI_GREEN, fmt, args);
     va_end(args);
 }
 
 void xo_utils_console_warning(const char *fmt, ...) {
     va_list args;
     va_start(args, fmt);
-    
-    printf("[xo] %s", ANSI_YELLOW);
-    vprintf(fmt, args);
-    printf("%s\n", ANSI_RESET);
-    
+    console_print(ANSI_YELLOW, fmt, args);
     va_end(args);
 }
 
 void xo_utils_console_error(const char *fmt, ...) {
     va_list args;
     va_start(args, fmt);
-    
-    printf("[xo] %s", ANSI_RED);
-    vprintf(fmt, args);
-    printf("%s\n", ANSI_RESET);
-    
+    console_print(ANSI_RED, fmt, args);
     va_end(args);
 }
 
+// ===============================
+// System utilities
+// ===============================
+
+int xo_utils_cpu_count(void) {
+#ifdef _WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return info.dwNumberOfProcessors > 0 ? (int)info.dwNumberOfProcessors : 1;
+#else
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+    return count > 0 ? (int)count : 1;
+#endif
+}
+
+// Monotonic time in nanoseconds, for measuring durations
+uint64_t xo_utils_time_ns(void) {
+#ifdef _WIN32
+    LARGE_INTEGER frequency, counter;
+    QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&counter);
+    return (uint64_t)((double)counter.QuadPart * 1e9 / (double)frequency.QuadPart);
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+#endif
+}
+
 // Traverse a directory recursively and call a callback for each file
 int xo_utils_traverse_directory(const char *dirpath, xo_file_callback_t callback, void *user_data) {
     if (!dirpath || !callback) {
@@ -524,15 +701,26 @@ int xo_utils_traverse_directory(const char *dirpath, xo_file_callback_t callback
         // Construct full path
         snprintf(path, sizeof(path), "%s/%s", dirpath, entry->d_name);
         
-        // Get file status
-        struct stat st;
-        if (stat(path, &st) != 0) {
-            xo_utils_console_error("Failed to stat file: %s", path);
-            closedir(dir);
-            return XO_ERROR_FILE_NOT_FOUND;
+        // Use the entry type from readdir when the filesystem reports it,
+        // so walking a large tree does not cost a stat per file
+        bool is_dir;
+#ifdef _DIRENT_HAVE_D_TYPE
+        if (entry->d_type != DT_UNKNOWN && entry->d_type != DT_LNK) {
+            is_dir = entry->d_type == DT_DIR;
+        } else
+#endif
+        {
+            // Get file status
+            struct stat st;
+            if (stat(path, &st) != 0) {
+                xo_utils_console_error("Failed to stat file: %s", path);
+                closedir(dir);
+                return XO_ERROR_FILE_NOT_FOUND;
+            }
+            is_dir = S_ISDIR(st.st_mode);
         }
         
-        if (S_ISDIR(st.st_mode)) {
+        if (is_dir) {
             // Recurse into subdirectory
             int result = xo_utils_traverse_directory(path, callback, user_data);
             if (result != XO_SUCCESS) {
@@ -942,6 +942,26 @@ int xo_watcher_stop(xo_watcher_t *watcher) {
     return result;
 }
 
+// Rebuild every page, or one page when filepath is given, recording the
+// dependencies into the dev server's graph when it keeps one
+static int rebuild_pages(const xo_config_t *config, const char *filepath) {
+    xo_dependency_tracker_t own_tracker;
+    xo_dependency_tracker_t *tracker = (xo_dependency_tracker_t *)config->dependencies;
+    if (!tracker) {
+        xo_dependency_tracker_init(&own_tracker);
+        tracker = &own_tracker;
+    }
+    
+    int result = filepath ? xo_build_file(config, filepath, tracker) :
+                            xo_build_directory(config, config->content_dir, tracker);
+    
+    if (tracker == &own_tracker) {
+        xo_dependency_tracker_free(&own_tracker);
+    }
+    
+    return result;
+}
+
 // Handle a file event
 void xo_handle_file_event(const xo_file_event_t *event, void *user_data) {
     if (!event || !user_data) {
@@ -972,14 +992,58 @@ void xo_handle_file_event(const xo_file_event_t *event, void *user_data) {
     xo_config_t *config = (xo_config_t *)user_data; // Cast user_data to xo_config_t
     xo_server_t *server = (xo_server_t *)config->user_data; // Assuming config->user_data holds the server pointer
     
+    // Check for partials directory: config->content_dir + "_partials"
+    // Example: "content/_partials"
+    char partials_dir[XO_MAX_PATH];
+    snprintf(partials_dir, sizeof(partials_dir), "%s%c%s", config->content_dir, PATH_SEPARATOR, XO_PARTIALS_DIR);
+    size_t partials_dir_len = strlen(partials_dir);
+    bool is_partial_file = strncmp(event->filepath, partials_dir, partials_dir_len) == 0 &&
+                           event->filepath[partials_dir_len] == PATH_SEPARATOR &&
+                           ext && (strcmp(ext, "md") == 0 || strcmp(ext, "html") == 0);
+    
+    // Partials are included by pages, reload or drop the changed one before rebuilding its pages
+    if (is_partial_file && config->partials && event->type == XO_FILE_DELETED) {
+        xo_template_partials_remove_file((xo_template_partials_t *)config->partials, partials_dir, event->filepath);
+    } else if (is_partial_file && config->partials) {
+        if (xo_template_partials_load_file((xo_template_partials_t *)config->partials, partials_dir,
+                                           event->filepath) != XO_SUCCESS) {
+            xo_utils_console_warning("Failed to reload partial: %s", event->filepath);
+        }
+    }
+    
+    // Layout bindings point at the partials they were made with
+    if (is_partial_file && config->layout_cache) {
+        xo_layout_cache_drop_bindings((xo_layout_cache_t *)config->layout_cache);
+    }
+    
     // Check if we should rebuild
-    if (ext && (strcmp(ext, "md") == 0 || strcmp(ext, "markdown") == 0)) {
+    bool rebuilt = false;
+    if (is_partial_file) {
+        rebuilt = true;
+        xo_utils_console_info("Partial changed, rebuilding the pages using it: %s", event->filepath);
+        
+        if (xo_build_dependents(config, event->filepath) != XO_SUCCESS &&
+            rebuild_pages(config, NULL) != XO_SUCCESS) {
+            xo_utils_console_error("Error during full content rebuild triggered by partial change: %s", event->filepath);
+        }
+        
+        if (server) {
+            xo_server_broadcast_ws(server, "reload", 6);
+        }
+    } else if (ext && (strcmp(ext, "md") == 0 || strcmp(ext, "markdown") == 0)) {
         printf("[XO DEBUG] Watcher callback: Markdown file detected. Action: %s\n", (event->type == XO_FILE_DELETED ? "delete" : "build"));
         // This is a markdown file, rebuild it
         xo_utils_console_info("Rebuilding: %s", event->filepath);
+        rebuilt = true;
+        bool listing_changed = true;
         // config is already defined
         
         if (event->type == XO_FILE_DELETED) {
+            if (config->markdown_cache) {
+                xo_markdown_cache_remove((xo_markdown_cache_t *)config->markdown_cache, event->filepath);
+            }
+            xo_dependency_tracker_remove((xo_dependency_tracker_t *)config->dependencies, event->filepath);
+            
             // If the file was deleted, we need to remove the corresponding HTML file
             char *html_path = xo_utils_str_replace(event->filepath, 
                 config->content_dir, config->output_dir);
@@ -993,11 +1057,18 @@ void xo_handle_file_event(const xo_file_event_t *event, void *user_data) {
                 free(html_path);
             }
         } else {
-            // Otherwise rebuild the file
-            xo_dependency_tracker_t tracker;
-            xo_dependency_tracker_init(&tracker);
-            xo_build_file(config, event->filepath, &tracker);
-            xo_dependency_tracker_free(&tracker);
+            // Otherwise rebuild the file, comparing its frontmatter first as
+            // rebuilding a page that lists the site's pages records it again
+            listing_changed = event->type == XO_FILE_CREATED ||
+                              xo_build_frontmatter_changed(config, event->filepath);
+            rebuild_pages(config, event->filepath);
+        }
+        
+        // Pages listing the site's pages only change when a page is added or
+        // deleted or its frontmatter changed. No pages depending on the
+        // content directory is not an error here.
+        if (listing_changed) {
+            xo_build_dependents(config, config->content_dir);
         }
     } else if (ext && (strcmp(ext, "html") == 0 || strcmp(ext, "htm") == 0)) {
         bool is_layout_file = false;
@@ -1009,23 +1080,6 @@ void xo_handle_file_event(const xo_file_event_t *event, void *user_data) {
             }
         }
 
-        // Check for partials directory: config->content_dir + "_partials"
-        // Example: "content/_partials"
-        if (!is_layout_file) {
-            char partials_path_check[XO_MAX_PATH];
-            // Ensure content_dir ends with a path separator for clean concatenation, or handle if it doesn't.
-            // For simplicity, assuming content_dir does not end with a separator for this construction.
-            // A more robust solution would use xo_utils_join_path or similar.
-            snprintf(partials_path_check, sizeof(partials_path_check), "%s%c_partials", config->content_dir, PATH_SEPARATOR);
-            size_t partials_dir_len = strlen(partials_path_check);
-            if (strncmp(event->filepath, partials_path_check, partials_dir_len) == 0) {
-                 char char_after_prefix_partial = event->filepath[partials_dir_len];
-                 if (char_after_prefix_partial == PATH_SEPARATOR || char_after_prefix_partial == '\0') {
-                    is_layout_file = true; // Treat partials like layout files for rebuild purposes
-                    printf("[XO DEBUG] Watcher callback: Partial HTML file '%s' changed. Treating as layout file.\n", event->filepath);
-                 }
-            }
-        }
 
         if (is_layout_file) {
             printf("[XO DEBUG] Watcher callback: Layout file '%s' changed. Triggering full content rebuild.\n", event->filepath);
@@ -1033,13 +1087,21 @@ void xo_handle_file_event(const xo_file_event_t *event, void *user_data) {
             // The xo_build_directory function should handle non-existent files gracefully during its traversal.
             // No special handling for XO_FILE_DELETED here for layouts, as the impact is on all files using it.
 
-            xo_dependency_tracker_t tracker;
-            xo_dependency_tracker_init(&tracker);
-            printf("[XO DEBUG] Watcher callback: Calling xo_build_directory for content_dir: %s\n", config->content_dir);
-            if (xo_build_directory(config, config->content_dir, &tracker) != XO_SUCCESS) {
-                xo_utils_console_error("Error during full content rebuild triggered by layout change: %s", event->filepath);
+            rebuilt = true;
+            
+            // Drop the stale compiled layout before rebuilding its pages
+            if (config->layout_cache) {
+                xo_layout_cache_invalidate((xo_layout_cache_t *)config->layout_cache, event->filepath);
+            }
+            
+            // Rebuild only the pages recorded as using this file, falling back
+            // to a full rebuild when the dependency graph does not know it
+            if (xo_build_dependents(config, event->filepath) != XO_SUCCESS) {
+                printf("[XO DEBUG] Watcher callback: Calling xo_build_directory for content_dir: %s\n", config->content_dir);
+                if (rebuild_pages(config, NULL) != XO_SUCCESS) {
+                    xo_utils_console_error("Error during full content rebuild triggered by layout change: %s", event->filepath);
+                }
             }
-            xo_dependency_tracker_free(&tracker);
 
             printf("[XO DEBUG] Watcher callback: Triggering browser reload for layout change.\n");
             // server is already defined
@@ -1065,4 +1127,10 @@ void xo_handle_file_event(const xo_file_event_t *event, void *user_data) {
     } else {
         printf("[XO DEBUG] Watcher callback: File type not specifically handled by rebuild/reload logic: %s (ext: %s)\n", event->filepath, ext ? ext : "N/A");
     }
+    
+    // Keep the saved graph and page keys in step with the rebuilds, after
+    // the reload so saving never delays the browser
+    if (rebuilt && config->dependencies) {
+        xo_build_save_cache(config);
+    }
 } 
\ No newline at end of file
@@ -0,0 +1,156 @@
+#include <stdlib.h>
+#include <string.h>
+#include "writer.h"
+#include "scan.h"
+
+// Initialize a writer with room for capacity bytes, allocating from the arena
+// when one is given
+int xo_writer_init(xo_writer_t *writer, xo_arena_t *arena, size_t capacity) {
+    if (!writer) {
+        return XO_ERROR_MEMORY_ALLOCATION;
+    }
+    
+    writer->length = 0;
+    writer->capacity = capacity < 8 ? 8 : capacity + 1;
+    writer->arena = arena;
+    writer->failed = false;
+    writer->data = arena ? xo_arena_alloc(arena, writer->capacity) : malloc(writer->capacity);
+    
+    if (!writer->data) {
+        writer->capacity = 0;
+        writer->failed = true;
+        return XO_ERROR_MEMORY_ALLOCATION;
+    }
+    
+    return XO_SUCCESS;
+}
+
+// Free a writer's buffer unless its arena owns it
+void xo_writer_free(xo_writer_t *writer) {
+    if (!writer) {
+        return;
+    }
+    
+    if (!writer->arena) {
+        free(writer->data);
+    }
+    
+    writer->data = NULL;
+    writer->length = 0;
+    writer->capacity = 0;
+}
+
+// Make room for extra more bytes plus the terminating NUL, doubling the buffer
+int xo_writer_reserve(xo_writer_t *writer, size_t extra) {
+    if (writer->failed) {
+        return XO_ERROR_MEMORY_ALLOCATION;
+    }
+    
+    if (writer->capacity - writer->length > extra) {
+        return XO_SUCCESS;
+    }
+    
+    size_t new_capacity = writer->capacity == 0 ? 8 : writer->capacity;
+    while (new_capacity - writer->length <= extra) {
+        new_capacity *= 2;
+    }
+    
+    char *new_data;
+    if (writer->arena) {
+        new_data = xo_arena_realloc(writer->arena, writer->data, writer->capacity, new_capacity);
+    } else {
+        new_data = realloc(writer->data, new_capacity);
+    }
+    
+    if (!new_data) {
+        writer->failed = true;
+        return XO_ERROR_MEMORY_ALLOCATION;
+    }
+    
+    writer->data = new_data;
+    writer->capacity = new_capacity;
+    
+    return XO_SUCCESS;
+}
+
+// Terminate the output and hand it over to the caller. Returns NULL, freeing
+// the buffer, when any append failed.
+char *xo_writer_finish(xo_writer_t *writer, size_t *length) {
+    if (!writer || writer->failed || !writer->data) {
+        if (writer) {
+            xo_writer_free(writer);
+        }
+        return NULL;
+    }
+    
+    writer->data[writer->length] = '\0';
+    if (length) {
+        *length = writer->length;
+    }
+    
+    char *data = writer->data;
+    writer->data = NULL;
+    writer->capacity = 0;
+    
+    return data;
+}
+
+// Append text escaped for HTML. Clean runs found by the vector scanner are
+// copied whole, only & < > " and, when apostrophe is set, ' are replaced.
+// Values that may end up in a single-quoted attribute need the apostrophe.
+int xo_writer_append_escaped(xo_writer_t *writer, const char *data, size_t length, bool apostrophe) {
+    const char *p = data;
+    const char *end = data + length;
+    
+    // Clean text, the common case, needs a single reservation
+    if (writer->capacity - writer->length <= length && xo_writer_reserve(writer, length) != XO_SUCCESS) {
+        return XO_ERROR_MEMORY_ALLOCATION;
+    }
+    
+    while (p < end) {
+        const char *special = xo_scan_html(p, end);
+        xo_writer_append(writer, p, (size_t)(special - p));
+        if (special == end) {
+            break;
+        }
+    
+        switch (*special) {
+            case '&': xo_writer_append(writer, "&amp;", 5); break;
+            case '<': xo_writer_append(writer, "&lt;", 4); break;
+            case '>': xo_writer_append(writer, "&gt;", 4); break;
+            case '"': xo_writer_append(writer, "&quot;", 6); break;
+            default: xo_writer_append(writer, apostrophe ? "&#39;" : "'", apostrophe ? 5 : 1); break;
+        }
+        p = special + 1;
+    }
+    
+    return writer->failed ? XO_ERROR_MEMORY_ALLOCATION : XO_SUCCESS;
+}
+
+// Append an integer in decimal. The digits are written straight into the
+// buffer, from the last one back, so no temporary string is needed.
+int xo_writer_append_int(xo_writer_t *writer, long long value) {
+    unsigned long long magnitude = value < 0 ? 0ULL - (unsigned long long)value : (unsigned long long)value;
+    
+    size_t digits = 1;
+    for (unsigned long long rest = magnitude / 10; rest > 0; rest /= 10) {
+        digits++;
+    }
+    size_t length = digits + (value < 0 ? 1 : 0);
+    
+    if (writer->capacity - writer->length <= length && xo_writer_reserve(writer, length) != XO_SUCCESS) {
+        return XO_ERROR_MEMORY_ALLOCATION;
+    }
+    
+    char *p = writer->data + writer->length + length;
+    do {
+        *--p = (char)('0' + magnitude % 10);
+        magnitude /= 10;
+    } while (magnitude > 0);
+    if (value < 0) {
+        *--p = '-';
+    }
+    writer->length += length;
+    
+    return XO_SUCCESS;
+}